@@ -1,11 +1,33 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <chrono>
-#include <map>
 #include <functional>
 #include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <omp.h>
 #include "../include/matrix_utils.h"
+#include "../include/cpu_dispatch.h"
+#include "../include/sgemm.h"
+#include "../include/tuning.h"
+#include "../include/numa.h"
+#include "../include/perf_counters.h"
+#include "../include/verify.h"
+#include "../include/mixed_precision.h"
+#include "../include/out_of_core.h"
+#include "../include/matmul_auto.h"
+#include "../include/packed_matrix.h"
+#include "../include/matmul_fixed.h"
+#include "../include/matmul_async.h"
+#include "../include/sparse_gemm.h"
+#include "../include/thread_pool.h"
+#include <cstdio>
 
 // Forward declarations of matmul functions
 void matmul_naive(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
@@ -14,74 +36,1508 @@ void matmul_tiled(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int
 void matmul_simd(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
 void matmul_parallel_omp(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
 void matmul_parallel_threads(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
+void matmul_parallel_threads_n(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p,
+                               int num_threads); // 0 = whole pool
 void matmul_strassen(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
-    Matrix A, B, C_ref, C_test;
+void matmul_strassen_parallel(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
+void set_strassen_task_depth(int depth); // -1 = automatic
+void matmul_optimized_sgemm(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
+
+// Registered methods, in the order they are reported.
+// max_flops skips a method on shapes where it would take minutes (naive & co.).
+struct Method {
+    std::string name;
+    MatMulFunc func;
+    double max_flops;
+};
+
+static const double NO_LIMIT = 1e30;
+
+std::vector<Method> methods = {
+    {"Naive", matmul_naive, 2.0 * 512 * 512 * 512},
+    {"Loop Reorder", matmul_loop_reorder, 2.0 * 1024 * 1024 * 1024},
+    {"Tiled", matmul_tiled, 2.0 * 1024 * 1024 * 1024},
+    {"SIMD", matmul_simd, NO_LIMIT},
+    {"Parallel OMP", matmul_parallel_omp, NO_LIMIT},
+    {"Parallel Threads", matmul_parallel_threads, NO_LIMIT},
+    {"Strassen", matmul_strassen, NO_LIMIT},
+    {"Strassen Parallel", matmul_strassen_parallel, NO_LIMIT},
+    {"Optimized SGEMM", matmul_optimized_sgemm, NO_LIMIT},
+    {"SGEMM NUMA", matmul_sgemm_numa, NO_LIMIT},
+    {"Auto", matmul_auto, NO_LIMIT},
+    {"Fixed", matmul_fixed_dispatch, 2.0 * 64 * 64 * 64},
+};
+
+// Shapes
+// Square sizes plus the shapes where blocking usually breaks down: tall-skinny
+// (large m), short-wide (large p), deep K, GEMV-like (m or p of 1..16: bound by
+// reading the large operand) and sizes that are not a multiple of the register
+// tile.
+struct Shape {
+    std::string category;
+    int m, n, p;
+};
+
+static std::vector<Shape> make_shapes(bool full) {
+    std::vector<Shape> shapes = {
+        {"square", 128, 128, 128},
+        {"square", 256, 256, 256},
+        {"square", 512, 512, 512},
+        {"square", 1024, 1024, 1024},
+        {"tall-skinny", 4096, 256, 64},
+        {"tall-skinny", 8192, 128, 128},
+        {"short-wide", 64, 256, 4096},
+        {"short-wide", 128, 128, 8192},
+        {"deep-k", 256, 4096, 256},
+        {"gemv", 1, 4096, 4096},
+        {"gemv", 4096, 4096, 1},
+        {"gemv", 16, 4096, 4096},
+        {"gemv", 4096, 4096, 16},
+        {"odd", 127, 129, 131},
+        {"odd", 333, 517, 251},
+        {"odd", 1001, 999, 1003},
+    };
+    if (full) {
+        shapes.push_back({"square", 2048, 2048, 2048});
+        shapes.push_back({"square", 4096, 4096, 4096});
+        shapes.push_back({"tall-skinny", 16384, 512, 128});
+        shapes.push_back({"short-wide", 128, 512, 16384});
+        shapes.push_back({"odd", 2047, 2049, 2051});
+    }
+    return shapes;
+}
+
+// Statistics
+// Samples outside [Q1 - 3 IQR, Q3 + 3 IQR] (interrupts, page faults, frequency
+// changes) are dropped before computing median/p95/stddev.
+struct TimingStats {
+    double median;
+    double p95;
+    double stddev;
+    double min;
+    int samples;   // Kept after outlier rejection
+    int rejected;
+};
+
+static double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    double pos = q * (sorted.size() - 1);
+    size_t lo = (size_t)pos;
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (pos - lo) * (sorted[hi] - sorted[lo]);
+}
+
+static TimingStats compute_stats(std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    double q1 = percentile(times, 0.25), q3 = percentile(times, 0.75);
+    double iqr = q3 - q1;
+
+    std::vector<double> kept;
+    for (double t : times) {
+        if (t >= q1 - 3.0 * iqr && t <= q3 + 3.0 * iqr) kept.push_back(t);
+    }
+
+    TimingStats stats;
+    stats.samples = (int)kept.size();
+    stats.rejected = (int)(times.size() - kept.size());
+    stats.median = percentile(kept, 0.5);
+    stats.p95 = percentile(kept, 0.95);
+    stats.min = kept.front();
+
+    double mean = 0.0;
+    for (double t : kept) mean += t;
+    mean /= kept.size();
+    double var = 0.0;
+    for (double t : kept) var += (t - mean) * (t - mean);
+    stats.stddev = kept.size() > 1 ? std::sqrt(var / (kept.size() - 1)) : 0.0;
+    return stats;
+}
+
+// Machine limits for the roofline
+// Peak: the SGEMM micro-kernel on an L1-resident panel, on every thread at once.
+// Bandwidth: STREAM-style triad on arrays much larger than the last-level cache.
+struct MachineInfo {
+    double peak_gflops;
+    double bandwidth_gbs;
+    int threads;
+};
+
+static double measure_peak_gflops() {
+    const SgemmKernel& kern = sgemm_kernel();
+    const int k = 256, reps = 2000;
+    double best = 0.0;
+
+    for (int trial = 0; trial < 3; ++trial) {
+        double seconds = 0.0;
+        int threads = 1;
+        #pragma omp parallel
+        {
+            std::vector<float> A((size_t)kern.mr * k, 0.001f), B((size_t)kern.nr * k, 0.001f);
+            std::vector<float> C((size_t)kern.mr * kern.nr, 0.0f);
+            #pragma omp barrier
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int r = 0; r < reps; ++r) {
+                kern.kernel(k, A.data(), B.data(), C.data(), kern.nr, kern.mr, kern.nr, 1.0f);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            #pragma omp barrier
+            #pragma omp master
+            {
+                seconds = std::chrono::duration<double>(end - start).count();
+                threads = omp_get_num_threads();
+            }
+        }
+        double flops = 2.0 * kern.mr * kern.nr * k * reps * threads;
+        best = std::max(best, flops / (seconds * 1e9));
+    }
+    return best;
+}
+
+static double measure_bandwidth_gbs() {
+    // 4x the last-level cache per array (64-256 MB), so nothing is served from cache
+    size_t bytes = std::min<size_t>(std::max<size_t>(4 * (size_t)detect_cache_sizes().l3, 64u << 20), 256u << 20);
+    const size_t len = bytes / sizeof(float);
+    Matrix a, b, c;
+    a.resize(len);
+    b.resize(len);
+    c.resize(len);
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)len; ++i) {
+        a[i] = 0.0f;
+        b[i] = 1.0f;
+        c[i] = 2.0f;
+    }
+
+    double best = 1e9;
+    for (int trial = 0; trial < 5; ++trial) {
+        auto start = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < (long long)len; ++i) {
+            a[i] = b[i] + 3.0f * c[i];
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return 3.0 * len * sizeof(float) / (best * 1e9);
+}
+
+static MachineInfo measure_machine() {
+    MachineInfo info;
+    info.threads = omp_get_max_threads();
+    info.peak_gflops = measure_peak_gflops();
+    info.bandwidth_gbs = measure_bandwidth_gbs();
+    return info;
+}
+
+// Results
+struct BenchResult {
+    std::string method;
+    Shape shape;
+    TimingStats stats;
+    double gflops;          // At the median time
+    double pct_peak;        // gflops / measured peak
+    double pct_roofline;    // gflops / min(peak, intensity * bandwidth)
+    double intensity;       // Flops per byte of compulsory traffic (read A, B, C; write C)
+    std::string status;     // PASS / FAIL / N/A
+    std::string verify_mode;  // "reference", "freivalds" or "none"
+    VerifyReport verify = {true, -1.0, -1.0, -1.0, -1.0};
+
+    // Only with --counters (negative = not measured / not available)
+    PerfReport counters = {-1.0, -1.0, -1.0, -1.0, -1.0};
+    double pack_a_pct = -1.0;   // Share of SGEMM driver thread-time (for methods that use it)
+    double pack_b_pct = -1.0;
+    double compute_pct = -1.0;
+};
+
+struct BenchConfig {
+    int min_iterations = 5;
+    int max_iterations = 50;
+    double min_seconds = 0.3;   // Keep sampling until this much time was measured
+    bool full = false;
+    std::string csv_path;
+    std::string json_path;
+    std::vector<std::string> only_methods;
+    PerfCounters* counters = nullptr;  // --counters
+    // Verification: element-wise against the double reference up to this many
+    // flops (the reference runs once per shape), Freivalds above it
+    std::string verify = "auto";       // auto | reference | freivalds | off
+    double reference_max_flops = 2.0 * 1024 * 1024 * 1024;
+};
+
+// Peak FLOPs per cycle and core of the active kernel: 2 FMA pipes x 2 flops x
+// SIMD lanes (1-pipe AVX-512 parts will show at most 50% utilization).
+static double peak_flops_per_cycle() {
+    switch (sgemm_kernel().isa) {
+        case CpuIsa::AVX512: return 2 * 2 * 16;
+        case CpuIsa::AVX2: return 2 * 2 * 8;
+        default: return 2 * 4; // SSE2 add + mul
+    }
+}
+
+// Runs func a few times with hardware counters and SGEMM phase timing enabled
+// (separately from the timed runs, so the instrumentation never skews them).
+static void measure_counters(const Method& method, const Matrix& A, const Matrix& B, Matrix& C,
+                             int m, int n, int p, PerfCounters& counters, BenchResult& r) {
+    const double flops = 2.0 * m * n * p;
+    const int runs = std::max(1, std::min(10, (int)(0.1 / r.stats.median)));
+
+    PerfSample total;
+    for (long long& v : total.values) v = 0;
+
+    reset_sgemm_phase_times();
+    set_sgemm_phase_timing(true);
+    for (int run = 0; run < runs; ++run) {
+        zeros_matrix(C, m, p);
+        counters.start();
+        method.func(A, B, C, m, n, p);
+        PerfSample sample = counters.stop();
+        for (int e = 0; e < (int)PerfEvent::Count; ++e) {
+            total.values[e] = (total.values[e] >= 0 && sample.values[e] >= 0) ? total.values[e] + sample.values[e] : -1;
+        }
+    }
+    set_sgemm_phase_timing(false);
+
+    r.counters = make_perf_report(total, flops * runs, peak_flops_per_cycle());
+
+    SgemmPhaseTimes phases = sgemm_phase_times();
+    double busy = phases.pack_a + phases.pack_b + phases.compute;
+    if (phases.calls > 0 && busy > 0) {
+        r.pack_a_pct = 100.0 * phases.pack_a / busy;
+        r.pack_b_pct = 100.0 * phases.pack_b / busy;
+        r.compute_pct = 100.0 * phases.compute / busy;
+    }
+}
+
+// "-" for metrics that were not measured
+static std::string metric(double value, int precision) {
+    if (value < 0) return "-";
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(precision) << value;
+    return out.str();
+}
+
+static void print_counters(const std::vector<BenchResult>& results, size_t first) {
+    std::cout << std::left << std::setw(20) << "Counters"
+              << std::setw(8) << "IPC"
+              << std::setw(12) << "L1D/kFLOP"
+              << std::setw(12) << "LLC/kFLOP"
+              << std::setw(12) << "dTLB/kFLOP"
+              << std::setw(8) << "FMA %"
+              << "Pack A / Pack B / Compute %" << std::endl;
+    for (size_t i = first; i < results.size(); ++i) {
+        const auto& r = results[i];
+        std::string phases = r.compute_pct < 0 ? "-"
+            : metric(r.pack_a_pct, 1) + " / " + metric(r.pack_b_pct, 1) + " / " + metric(r.compute_pct, 1);
+        std::cout << std::left << std::setw(20) << r.method
+                  << std::setw(8) << metric(r.counters.ipc, 2)
+                  << std::setw(12) << metric(r.counters.l1d_miss_per_kflop, 3)
+                  << std::setw(12) << metric(r.counters.llc_miss_per_kflop, 4)
+                  << std::setw(12) << metric(r.counters.dtlb_miss_per_kflop, 4)
+                  << std::setw(8) << metric(100.0 * r.counters.fma_utilization, 1)
+                  << phases << std::endl;
+    }
+}
+
+static bool method_selected(const BenchConfig& config, const std::string& name) {
+    if (config.only_methods.empty()) return true;
+    return std::find(config.only_methods.begin(), config.only_methods.end(), name) != config.only_methods.end();
+}
+
+// Timed runs of `run` (after `reset`, which is not timed) until both the
+// iteration and the minimum-time targets of the config are met.
+static std::vector<double> time_runs(const BenchConfig& config, const std::function<void()>& reset,
+                                     const std::function<void()>& run) {
+    std::vector<double> times;
+    double total = 0.0;
+    while ((int)times.size() < config.max_iterations &&
+           ((int)times.size() < config.min_iterations || total < config.min_seconds)) {
+        reset();
+        auto start = std::chrono::high_resolution_clock::now();
+        run();
+        auto end = std::chrono::high_resolution_clock::now();
+        double t = std::chrono::duration<double>(end - start).count();
+        times.push_back(t);
+        total += t;
+    }
+    return times;
+}
+
+static void print_header() {
+    std::cout << std::left << std::setw(20) << "Method"
+              << std::setw(12) << "Median (s)"
+              << std::setw(12) << "p95 (s)"
+              << std::setw(10) << "Stddev %"
+              << std::setw(10) << "GFLOPS"
+              << std::setw(9) << "% peak"
+              << std::setw(9) << "% roof"
+              << std::setw(12) << "Err/bound"
+              << "Status" << std::endl;
+    std::cout << std::string(100, '-') << std::endl;
+}
+
+static void print_result(const BenchResult& r) {
+    std::cout << std::left << std::setw(20) << r.method
+              << std::setw(12) << std::scientific << std::setprecision(3) << r.stats.median
+              << std::setw(12) << r.stats.p95
+              << std::setw(10) << std::fixed << std::setprecision(1) << 100.0 * r.stats.stddev / r.stats.median
+              << std::setw(10) << std::setprecision(2) << r.gflops
+              << std::setw(9) << std::setprecision(1) << r.pct_peak
+              << std::setw(9) << r.pct_roofline
+              << std::setw(12) << (r.verify.worst_ratio < 0 ? std::string("-") : metric(r.verify.worst_ratio, 4))
+              << r.status << " (" << r.verify_mode << ")" << std::endl;
+}
+
+void run_benchmark(const Shape& shape, const BenchConfig& config, const MachineInfo& machine,
+                   std::vector<BenchResult>& results) {
+    const int m = shape.m, n = shape.n, p = shape.p;
+    const double flops = 2.0 * m * n * p;
+    DispatchPlan plan = plan_matmul(m, n, p);
+    std::cout << shape.category << " " << m << "x" << n << " * " << n << "x" << p << " (Auto: "
+              << shape_class_name(plan.shape) << ", " << plan.kernel << ", " << plan.threads << " threads)"
+              << std::endl;
+
+    Matrix A, B, C_test;
     randomize_matrix(A, m, n);
     randomize_matrix(B, n, p);
-    zeros_matrix(C_ref, m, p);
     zeros_matrix(C_test, m, p);
 
-    // Run reference implementation (Naive)
-    bool verify = (m <= 512); 
-    
-    if (verify) {
-        std::cout << "Generating reference result using Naive..." << std::endl;
-        matmul_naive(A, B, C_ref, m, n, p);
+    // Double-precision reference (blocked, parallel) if affordable, otherwise
+    // each result gets Freivalds' O(n^2) check
+    std::string verify_mode = config.verify;
+    if (verify_mode == "auto") {
+        verify_mode = (flops <= config.reference_max_flops) ? "reference" : "freivalds";
+    }
+    std::vector<double> C_ref, abs_ref;
+    if (verify_mode == "reference") {
+        reference_matmul(A, B, m, n, p, C_ref, abs_ref);
     }
 
-    std::cout << std::left << std::setw(25) << "Method" 
-              << std::setw(15) << "Time (s)" 
-              << std::setw(15) << "GFLOPS" 
-              << "Status" << std::endl;
+    double bytes = 4.0 * ((double)m * n + (double)n * p + 2.0 * m * p);
+    double intensity = flops / bytes;
+    double roof = std::min(machine.peak_gflops, intensity * machine.bandwidth_gbs);
+
+    print_header();
+
+    size_t first_result = results.size();
+    for (const auto& method : methods) {
+        if (!method_selected(config, method.name) || flops > method.max_flops) continue;
+
+        // Warmup (also checks the result)
+        zeros_matrix(C_test, m, p);
+        method.func(A, B, C_test, m, n, p);
+
+        VerifyReport check = {true, -1.0, -1.0, -1.0, -1.0};
+        if (verify_mode == "reference") {
+            check = verify_against_reference(C_ref, abs_ref, C_test, m, n, p);
+        } else if (verify_mode == "freivalds") {
+            check = verify_freivalds(A, B, C_test, m, n, p);
+        }
+        std::string status = (verify_mode == "off") ? "N/A" : (check.pass ? "PASS" : "FAIL");
+
+        std::vector<double> times = time_runs(config, [&] { zeros_matrix(C_test, m, p); },
+                                              [&] { method.func(A, B, C_test, m, n, p); });
+
+        BenchResult r;
+        r.method = method.name;
+        r.shape = shape;
+        r.stats = compute_stats(times);
+        r.gflops = flops / (r.stats.median * 1e9);
+        r.pct_peak = 100.0 * r.gflops / machine.peak_gflops;
+        r.pct_roofline = 100.0 * r.gflops / roof;
+        r.intensity = intensity;
+        r.status = status;
+        r.verify_mode = verify_mode;
+        r.verify = check;
+        if (config.counters) {
+            measure_counters(method, A, B, C_test, m, n, p, *config.counters, r);
+        }
+        results.push_back(r);
+        print_result(r);
+    }
+    if (config.counters) {
+        std::cout << std::endl;
+        print_counters(results, first_result);
+    }
+    std::cout << std::endl;
+}
+
+// Mixed precision: the same product with fp32, bf16 and fp16 storage (fp32
+// accumulation) and as a u8 x s8 -> s32 integer GEMM, side by side. Inputs are
+// converted once, outside the timed region. The checks compare against the
+// reference product of the converted inputs, so they test the kernels, not the
+// rounding of the inputs (the integer GEMM must be exact). Operations per second
+// of the integer GEMM are reported in the GFLOPS column; % peak is relative to
+// the fp32 peak.
+void run_mixed_precision_benchmark(const Shape& shape, const BenchConfig& config, const MachineInfo& machine,
+                                   std::vector<BenchResult>& results) {
+    const char* names[] = {"GEMM FP32", "GEMM BF16", "GEMM FP16", "GEMM INT8"};
+    bool any = false;
+    for (const char* name : names) any |= method_selected(config, name);
+    if (!any) return;
+
+    const int m = shape.m, n = shape.n, p = shape.p;
+    const double flops = 2.0 * m * n * p;
+    std::cout << "Mixed precision " << m << "x" << n << " * " << n << "x" << p
+              << " (int8 kernel: " << int8_kernel_name() << ")" << std::endl;
+    print_header();
+
+    Matrix A, B;
+    randomize_matrix(A, m, n);
+    randomize_matrix(B, n, p);
+    BF16Matrix A_bf16, B_bf16;
+    FP16Matrix A_fp16, B_fp16;
+    to_bf16(A, A_bf16);
+    to_bf16(B, B_bf16);
+    to_fp16(A, A_fp16);
+    to_fp16(B, B_fp16);
+
+    // Full u8 / s8 range (exercises the saturation handling of the AVX2 kernel)
+    U8Matrix A_u8((size_t)m * n);
+    S8Matrix B_s8((size_t)n * p);
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (auto& v : A_u8) v = (uint8_t)dist(gen);
+    for (auto& v : B_s8) v = (int8_t)(dist(gen) - 128);
+
+    std::string verify_mode = config.verify;
+    if (verify_mode == "auto") {
+        verify_mode = (flops <= config.reference_max_flops) ? "reference" : "freivalds";
+    }
+
+    for (int variant = 0; variant < 4; ++variant) {
+        if (!method_selected(config, names[variant])) continue;
+
+        // Inputs as seen by the kernel, in float (exact for all four types)
+        Matrix A_in(A.size()), B_in(B.size()), C;
+        S32Matrix C_s32;
+        int element_bytes = 4;
+        std::function<void()> run;
+        if (variant == 0) {
+            A_in = A;
+            B_in = B;
+            run = [&] { matmul_optimized_sgemm(A, B, C, m, n, p); };
+        } else if (variant == 1) {
+            convert_bf16_to_float(A_bf16.data(), A_in.data(), A_in.size());
+            convert_bf16_to_float(B_bf16.data(), B_in.data(), B_in.size());
+            element_bytes = 2;
+            run = [&] { matmul_bf16(A_bf16, B_bf16, C, m, n, p); };
+        } else if (variant == 2) {
+            convert_fp16_to_float(A_fp16.data(), A_in.data(), A_in.size());
+            convert_fp16_to_float(B_fp16.data(), B_in.data(), B_in.size());
+            element_bytes = 2;
+            run = [&] { matmul_fp16(A_fp16, B_fp16, C, m, n, p); };
+        } else {
+            std::copy(A_u8.begin(), A_u8.end(), A_in.begin());
+            std::copy(B_s8.begin(), B_s8.end(), B_in.begin());
+            element_bytes = 1;
+            run = [&] { matmul_u8s8s32(A_u8, B_s8, C_s32, m, n, p); };
+        }
+        auto reset = [&] {
+            if (variant == 3) C_s32.assign((size_t)m * p, 0);
+            else zeros_matrix(C, m, p);
+        };
+
+        reset();
+        run();
+        // Integer result in float for the checks (exact below 2^24, larger sums
+        // are checked to float precision)
+        Matrix C_check;
+        if (variant == 3) C_check.assign(C_s32.begin(), C_s32.end());
+        const Matrix& result = (variant == 3) ? C_check : C;
+
+        VerifyReport check = {true, -1.0, -1.0, -1.0, -1.0};
+        if (verify_mode == "reference") {
+            std::vector<double> C_ref, abs_ref;
+            reference_matmul(A_in, B_in, m, n, p, C_ref, abs_ref);
+            check = verify_against_reference(C_ref, abs_ref, result, m, n, p);
+        } else if (verify_mode == "freivalds") {
+            check = verify_freivalds(A_in, B_in, result, m, n, p);
+        }
+
+        std::vector<double> times = time_runs(config, reset, run);
+
+        double bytes = (double)element_bytes * ((double)m * n + (double)n * p) + 8.0 * m * p;
+        double intensity = flops / bytes;
+        // bf16 / fp16 compute in fp32; vpdpbusd does 4 multiply-adds per 32-bit
+        // lane, so the int8 compute roof is taken as 4x the fp32 peak
+        double compute_peak = (variant == 3) ? 4.0 * machine.peak_gflops : machine.peak_gflops;
+        double roof = std::min(compute_peak, intensity * machine.bandwidth_gbs);
+
+        BenchResult r;
+        r.method = names[variant];
+        r.shape = shape;
+        r.stats = compute_stats(times);
+        r.gflops = flops / (r.stats.median * 1e9);
+        r.pct_peak = 100.0 * r.gflops / machine.peak_gflops;
+        r.pct_roofline = 100.0 * r.gflops / roof;
+        r.intensity = intensity;
+        r.status = (verify_mode == "off") ? "N/A" : (check.pass ? "PASS" : "FAIL");
+        r.verify_mode = verify_mode;
+        r.verify = check;
+        results.push_back(r);
+        print_result(r);
+    }
+    std::cout << std::endl;
+}
+
+// NUMA scaling, s x s x s: the 1-node plan (one team on all threads) vs. the
+// plan over all nodes, with A and C first-touched by the main thread (all pages
+// on node 0) and with every row block first-touched by its node
+// (numa_distribute_rows / numa_zeros_matrix). On a single-node machine run with
+// MATMUL_NUMA_NODES=2 (and at least 2 threads) to exercise the per-node teams.
+// Every plan must produce the 1-node result.
+bool run_numa_benchmark(int s, int iterations) {
+    const NumaTopology& topo = numa_topology();
+    int threads = omp_get_max_threads();
+    NumaPlan one_node = numa_plan(s, threads, 1);
+    NumaPlan all_nodes = numa_plan(s, threads);
+    std::cout << "NUMA " << s << "^3, " << topo.num_nodes << (topo.simulated ? " simulated" : "") << " node(s), "
+              << threads << " threads" << std::endl;
+
+    Matrix A_main, B, C_ref;
+    randomize_matrix(A_main, s, s);
+    randomize_matrix(B, s, s);
+    Matrix A_local = A_main;
+    numa_distribute_rows(A_local, s, s);
+
+    // C is re-created before every run (outside the timing) with the placement
+    // under test
+    auto run = [&](const Matrix& A, const NumaPlan& plan, bool first_touch, Matrix& C) {
+        double best = 1e9;
+        for (int iter = 0; iter < iterations; ++iter) {
+            if (first_touch) {
+                numa_zeros_matrix(C, s, s);
+            } else {
+                zeros_matrix(C, s, s);
+            }
+            auto start = std::chrono::high_resolution_clock::now();
+            matmul_sgemm_numa_plan(A, B, C, s, s, s, plan);
+            best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+        return best;
+    };
+
+    double flops = 2.0 * s * s * s;
+    double t_one = run(A_main, one_node, false, C_ref);
+    std::cout << "1 node,  main-thread pages: " << std::fixed << std::setprecision(2) << flops / (t_one * 1e9)
+              << " GFLOPS" << std::endl;
+    if (all_nodes.node.size() < 2) {
+        std::cout << "(single node: set MATMUL_NUMA_NODES=2 to compare with a 2-node plan)" << std::endl << std::endl;
+        return true;
+    }
+
+    bool pass = true;
+    Matrix C;
+    for (bool first_touch : {false, true}) {
+        double t = run(first_touch ? A_local : A_main, all_nodes, first_touch, C);
+        bool same = C == C_ref;
+        pass = pass && same;
+        std::cout << all_nodes.node.size() << " nodes, " << (first_touch ? "first-touch pages: " : "main-thread pages: ")
+                  << flops / (t * 1e9) << " GFLOPS, " << std::setprecision(2) << t_one / t << "x "
+                  << (same ? "PASS" : "FAIL") << std::endl;
+    }
+    std::cout << std::endl;
+    return pass;
+}
+
+// Batch throughput: `batch` independent m x n x p products, once through
+// matmul_batched_strided and once as a loop of single matmul_optimized_sgemm calls.
+void run_batched_benchmark(int m, int n, int p, int batch, int iterations) {
+    std::cout << "Batched " << batch << " x (" << m << "x" << n << " * " << n << "x" << p << ")" << std::endl;
+
+    Matrix A, B, C;
+    randomize_matrix(A, batch * m, n);
+    randomize_matrix(B, batch * n, p);
+    zeros_matrix(C, batch * m, p);
+    long long stride_a = (long long)m * n, stride_b = (long long)n * p, stride_c = (long long)m * p;
+
+    // Per-item operands for the looped baseline (it takes whole Matrix objects)
+    std::vector<Matrix> As(batch), Bs(batch), Cs(batch);
+    for (int b = 0; b < batch; ++b) {
+        As[b].assign(A.begin() + b * stride_a, A.begin() + (b + 1) * stride_a);
+        Bs[b].assign(B.begin() + b * stride_b, B.begin() + (b + 1) * stride_b);
+        zeros_matrix(Cs[b], m, p);
+    }
+
+    double t_batched = 1e9, t_loop = 1e9;
+    for (int iter = 0; iter < iterations; ++iter) {
+        auto start = std::chrono::high_resolution_clock::now();
+        matmul_batched_strided(A.data(), stride_a, B.data(), stride_b, C.data(), stride_c, m, n, p, batch);
+        auto mid = std::chrono::high_resolution_clock::now();
+        for (int b = 0; b < batch; ++b) {
+            matmul_optimized_sgemm(As[b], Bs[b], Cs[b], m, n, p);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        t_batched = std::min(t_batched, std::chrono::duration<double>(mid - start).count());
+        t_loop = std::min(t_loop, std::chrono::duration<double>(end - mid).count());
+    }
+
+    double flops = 2.0 * m * n * p * batch;
+    std::cout << std::left << std::setw(25) << "Method"
+              << std::setw(15) << "Time (s)"
+              << std::setw(15) << "GEMMs/s"
+              << "GFLOPS" << std::endl;
     std::cout << std::string(65, '-') << std::endl;
+    std::cout << std::left << std::setw(25) << "matmul_batched_strided"
+              << std::setw(15) << std::fixed << std::setprecision(6) << t_batched
+              << std::setw(15) << std::fixed << std::setprecision(0) << batch / t_batched
+              << std::fixed << std::setprecision(2) << flops / (t_batched * 1e9) << std::endl;
+    std::cout << std::left << std::setw(25) << "loop of optimized_sgemm"
+              << std::setw(15) << std::fixed << std::setprecision(6) << t_loop
+              << std::setw(15) << std::fixed << std::setprecision(0) << batch / t_loop
+              << std::fixed << std::setprecision(2) << flops / (t_loop * 1e9) << std::endl;
+    std::cout << std::endl;
+}
 
-    for (const auto& [name, func] : methods) {
-        double min_time = 1e9;
-        
-        // Warmup
-        if (iterations > 1) func(A, B, C_test, m, n, p);
+// Error scale of a float product: (|A| |B|)_ij for A m x n, B n x p, from the
+// packed SGEMM on absolute values. Any float evaluation of element (i, j) of
+// A * B is within n * u times it of the exact value (verify.h).
+Matrix abs_product(const Matrix& A, const Matrix& B, int m, int n, int p) {
+    Matrix A_abs = A, B_abs = B, scale;
+    for (auto& a : A_abs) a = std::fabs(a);
+    for (auto& b : B_abs) b = std::fabs(b);
+    zeros_matrix(scale, m, p);
+    sgemm('N', 'N', m, p, n, 1.0f, A_abs.data(), n, B_abs.data(), p, 0.0f, scale.data(), p);
+    return scale;
+}
+
+// Compares two float evaluations of the same K = n product (and whatever was
+// applied after it). Each is off by at most n * u * scale_ij, so they may differ
+// by twice that, times `slope` (the steepest step applied afterwards, ~1.13 for
+// GELU) and the usual tolerance factor of 2, plus rel_slack * |C_ref_ij| for
+// rounding of the output. max_diff gets the largest difference.
+bool within_product_bound(const Matrix& C, const Matrix& C_ref, const Matrix& scale, int n, double slope,
+                          double rel_slack, double& max_diff) {
+    const double allowed = 2.0 * 2.0 * n * FLOAT_UNIT_ROUNDOFF * slope;
+    bool pass = true;
+    max_diff = 0.0;
+    for (size_t i = 0; i < C.size(); ++i) {
+        double diff = std::fabs((double)C[i] - (double)C_ref[i]);
+        max_diff = std::max(max_diff, diff);
+        if (!(diff <= allowed * scale[i] + rel_slack * std::fabs((double)C_ref[i]))) pass = false;
+    }
+    return pass;
+}
+
+// Fused epilogue: C = GELU(A * B + bias) once with the epilogue in the
+// micro-kernel and once as sgemm followed by a separate pass over C. The gap is
+// the extra read + write of C, so it is largest for small n (K).
+// The fused results are checked against the separate pass for GELU + column
+// bias, for row bias + clamp + scale with beta != 0, and for ReLU into BF16 and
+// GELU into FP16 output. Returns false if any of them is off.
+bool run_epilogue_benchmark(int m, int n, int p, int iterations) {
+    std::cout << "Epilogue bias + GELU, " << m << "x" << n << " * " << n << "x" << p << std::endl;
+
+    Matrix A, B, C_fused, C_separate, bias;
+    randomize_matrix(A, m, n);
+    randomize_matrix(B, n, p);
+    randomize_matrix(bias, 1, p);
+    zeros_matrix(C_fused, m, p);
+    zeros_matrix(C_separate, m, p);
+
+    SgemmEpilogue epilogue;
+    epilogue.col_bias = bias.data();
+    epilogue.activation = Activation::GELU;
 
+    double t_fused = 1e9, t_separate = 1e9;
+    for (int iter = 0; iter < iterations; ++iter) {
+        auto start = std::chrono::high_resolution_clock::now();
+        sgemm_epilogue('N', 'N', m, p, n, 1.0f, A.data(), n, B.data(), p, 0.0f, C_fused.data(), p, epilogue);
+        auto mid = std::chrono::high_resolution_clock::now();
+        sgemm('N', 'N', m, p, n, 1.0f, A.data(), n, B.data(), p, 0.0f, C_separate.data(), p);
+        #pragma omp parallel for
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < p; ++j) {
+                C_separate[(size_t)i * p + j] = apply_epilogue(C_separate[(size_t)i * p + j], epilogue, i, j);
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        t_fused = std::min(t_fused, std::chrono::duration<double>(mid - start).count());
+        t_separate = std::min(t_separate, std::chrono::duration<double>(end - mid).count());
+    }
+
+    // GELU is steeper than 1 (up to ~1.13) and the vector exp differs from
+    // std::exp by a few ulps, hence the slope and the small relative slack
+    const Matrix scale = abs_product(A, B, m, n, p);
+    double max_diff = 0.0;
+    bool pass = within_product_bound(C_fused, C_separate, scale, n, 1.2, 1e-6, max_diff);
+
+    double flops = 2.0 * m * n * p;
+    std::cout << "Fused:    " << std::fixed << std::setprecision(6) << t_fused << " s, " << std::setprecision(2)
+              << flops / (t_fused * 1e9) << " GFLOPS" << std::endl;
+    std::cout << "Separate: " << std::setprecision(6) << t_separate << " s, " << std::setprecision(2)
+              << flops / (t_separate * 1e9) << " GFLOPS (max difference " << std::scientific
+              << std::setprecision(2) << max_diff << std::fixed << ") " << (pass ? "PASS" : "FAIL") << std::endl;
+
+    // Other epilogues, checked once: fused into C (or the 16-bit output) vs.
+    // sgemm + apply_epilogue + conversion. C starts from C_init for beta != 0.
+    Matrix C_init, row_bias;
+    randomize_matrix(C_init, m, p);
+    randomize_matrix(row_bias, m, 1);
+    std::vector<uint16_t> out16((size_t)m * p);
+    auto check = [&](const char* name, const SgemmEpilogue& epilogue, float beta, double slope) {
+        Matrix C = C_init, C_ref = C_init, beta_scale = scale;
+        for (size_t i = 0; i < beta_scale.size(); ++i) beta_scale[i] += std::fabs(beta * C_init[i]);
+
+        SgemmEpilogue fused = epilogue;
+        if (fused.output_type != EpilogueOutput::Float) {
+            fused.output = out16.data();
+            fused.ldo = p;
+        }
+        sgemm_epilogue('N', 'N', m, p, n, 1.0f, A.data(), n, B.data(), p, beta, C.data(), p, fused);
+        sgemm('N', 'N', m, p, n, 1.0f, A.data(), n, B.data(), p, beta, C_ref.data(), p);
+
+        // Compare in float after rounding both sides to the output type; they
+        // may then differ by one more unit in the last place of that type
+        double rel_slack = 1e-6;
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < p; ++j) {
+                size_t idx = (size_t)i * p + j;
+                float value = apply_epilogue(C_ref[idx], epilogue, i, j);
+                if (epilogue.output_type == EpilogueOutput::BF16) {
+                    bfloat16 fused_value;
+                    fused_value.bits = out16[idx];
+                    C[idx] = bf16_to_float(fused_value);
+                    value = bf16_to_float(float_to_bf16(value));
+                    rel_slack = 1.0 / 128;
+                } else if (epilogue.output_type == EpilogueOutput::FP16) {
+                    float16 fused_value;
+                    fused_value.bits = out16[idx];
+                    C[idx] = fp16_to_float(fused_value);
+                    value = fp16_to_float(float_to_fp16(value));
+                    rel_slack = 1.0 / 1024;
+                }
+                C_ref[idx] = value;
+            }
+        }
+        double diff = 0.0;
+        bool ok = within_product_bound(C, C_ref, beta_scale, n, slope, rel_slack, diff);
+        std::cout << "Check " << name << ": max difference " << std::scientific << std::setprecision(2) << diff
+                  << std::fixed << " " << (ok ? "PASS" : "FAIL") << std::endl;
+        pass = pass && ok;
+    };
+
+    SgemmEpilogue clamp;
+    clamp.row_bias = row_bias.data();
+    clamp.activation = Activation::Clamp;
+    clamp.clamp_min = -0.5f * std::sqrt((float)n); // about half of the values lie outside
+    clamp.clamp_max = 0.5f * std::sqrt((float)n);
+    clamp.scale = 0.5f;
+    check("row bias + clamp + scale, beta 0.5", clamp, 0.5f, 1.0);
+
+    SgemmEpilogue relu_bf16;
+    relu_bf16.col_bias = bias.data();
+    relu_bf16.activation = Activation::ReLU;
+    relu_bf16.output_type = EpilogueOutput::BF16;
+    check("bias + ReLU to BF16", relu_bf16, 0.0f, 1.0);
+
+    SgemmEpilogue gelu_fp16 = epilogue;
+    gelu_fp16.output_type = EpilogueOutput::FP16;
+    check("bias + GELU to FP16", gelu_fp16, 0.0f, 1.2);
+
+    std::cout << std::endl;
+    return pass;
+}
+
+// Pre-packed weights: C = A * B for a fixed B (n x p) and a new A (m x n) per
+// call, with B packed on every call (sgemm) vs. packed once (sgemm_prepacked).
+// Small m is the serving case, where packing B is a large share of the call.
+// Also checks the result against sgemm, and that B saved to a file and loaded
+// back gives the same product. Returns false if either check fails.
+bool run_prepacked_benchmark(int m, int n, int p, int iterations) {
+    std::cout << "Pre-packed B, " << m << "x" << n << " * " << n << "x" << p << std::endl;
+
+    Matrix A, B, C_packed, C_plain;
+    randomize_matrix(A, m, n);
+    randomize_matrix(B, n, p);
+    zeros_matrix(C_packed, m, p);
+    zeros_matrix(C_plain, m, p);
+
+    auto pack_start = std::chrono::high_resolution_clock::now();
+    PackedMatrix weights;
+    weights.pack(B, n, p);
+    double t_pack = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - pack_start).count();
+
+    double t_prepacked = 1e9, t_plain = 1e9;
+    for (int iter = 0; iter < iterations; ++iter) {
+        auto start = std::chrono::high_resolution_clock::now();
+        sgemm_prepacked('N', m, 1.0f, A.data(), n, weights, 0.0f, C_packed.data(), p);
+        auto mid = std::chrono::high_resolution_clock::now();
+        sgemm('N', 'N', m, p, n, 1.0f, A.data(), n, B.data(), p, 0.0f, C_plain.data(), p);
+        auto end = std::chrono::high_resolution_clock::now();
+        t_prepacked = std::min(t_prepacked, std::chrono::duration<double>(mid - start).count());
+        t_plain = std::min(t_plain, std::chrono::duration<double>(end - mid).count());
+    }
+
+    const Matrix scale = abs_product(A, B, m, n, p);
+    double max_diff = 0.0;
+    bool pass = within_product_bound(C_packed, C_plain, scale, n, 1.0, 0.0, max_diff);
+
+    // Round trip through a file, then the accumulating entry point
+    const std::string path = "matmul_prepacked_B.bin";
+    PackedMatrix loaded;
+    Matrix C_loaded;
+    zeros_matrix(C_loaded, m, p);
+    double max_diff_loaded = 0.0;
+    bool round_trip = weights.save(path) && loaded.load(path) && loaded.rows() == n && loaded.cols() == p &&
+                      matmul_prepacked(A.data(), n, loaded, C_loaded.data(), p, m) &&
+                      within_product_bound(C_loaded, C_plain, scale, n, 1.0, 0.0, max_diff_loaded);
+    std::remove(path.c_str());
+
+    double flops = 2.0 * m * n * p;
+    std::cout << "Pack once:  " << std::fixed << std::setprecision(6) << t_pack << " s (" << weights.bytes() / 1024
+              << " KB)" << std::endl;
+    std::cout << "Pre-packed: " << t_prepacked << " s, " << std::setprecision(2) << flops / (t_prepacked * 1e9)
+              << " GFLOPS" << std::endl;
+    std::cout << "sgemm:      " << std::setprecision(6) << t_plain << " s, " << std::setprecision(2)
+              << flops / (t_plain * 1e9) << " GFLOPS (max difference " << std::scientific << std::setprecision(2)
+              << max_diff << std::fixed << ") " << (pass ? "PASS" : "FAIL") << std::endl;
+    std::cout << "Save / load / matmul_prepacked: max difference " << std::scientific << std::setprecision(2)
+              << max_diff_loaded << std::fixed << " " << (round_trip ? "PASS" : "FAIL") << std::endl;
+    std::cout << std::endl;
+    return pass && round_trip;
+}
+
+// Fixed sizes: ns per call of S x S x S for the compiled-for-the-shape kernel
+// (called directly, and through the function table like the methods above)
+// vs. matmul_simd and matmul_optimized_sgemm through the table. Calls are
+// repeated on the same operands, so this is the in-cache per-call cost.
+template <int S>
+void run_fixed_benchmark(int iterations) {
+    Matrix A, B, C;
+    randomize_matrix(A, S, S);
+    randomize_matrix(B, S, S);
+    zeros_matrix(C, S, S);
+    const int reps = std::max(100, (int)(2e7 / (2.0 * S * S * S)));
+
+    auto ns_per_call = [&](const std::function<void()>& call) {
+        double best = 1e9;
         for (int iter = 0; iter < iterations; ++iter) {
-            zeros_matrix(C_test, m, p); // Reset result
             auto start = std::chrono::high_resolution_clock::now();
-            func(A, B, C_test, m, n, p);
-            auto end = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> diff = end - start;
-            if (diff.count() < min_time) min_time = diff.count();
+            for (int r = 0; r < reps; ++r) call();
+            double t = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            best = std::min(best, t * 1e9 / reps);
         }
+        return best;
+    };
 
-        // Calculate GFLOPS: 2*m*n*p floating point operations
-        double gflops = (2.0 * m * n * p) / (min_time * 1e9);
-        
-        std::string status = "N/A";
-        if (verify) {
-            if (verify_matrix(C_ref, C_test)) {
-                status = "PASS";
-            } else {
-                status = "FAIL";
+    MatMulFunc fixed = matmul_fixed_dispatch, simd = matmul_simd, packed = matmul_optimized_sgemm;
+    double t_direct = ns_per_call([&] { matmul_fixed<S, S, S>(A.data(), B.data(), C.data()); });
+    double t_table = ns_per_call([&] { fixed(A, B, C, S, S, S); });
+    double t_simd = ns_per_call([&] { simd(A, B, C, S, S, S); });
+    double t_packed = ns_per_call([&] { packed(A, B, C, S, S, S); });
+
+    double flops = 2.0 * S * S * S;
+    std::cout << std::left << std::setw(10) << (std::to_string(S) + "^3") << std::fixed << std::setprecision(1);
+    for (double t : {t_direct, t_table, t_simd, t_packed}) {
+        std::cout << std::setw(12) << t << std::setw(10) << flops / t;
+    }
+    std::cout << std::endl;
+}
+
+void run_fixed_benchmarks(int iterations) {
+    std::cout << "Fixed-size kernels, ns per call (and GFLOPS)" << std::endl;
+    std::cout << std::left << std::setw(10) << "Size" << std::setw(22) << "matmul_fixed<S,S,S>"
+              << std::setw(22) << "Fixed (table)" << std::setw(22) << "SIMD" << "Optimized SGEMM" << std::endl;
+    std::cout << std::string(98, '-') << std::endl;
+    run_fixed_benchmark<4>(iterations);
+    run_fixed_benchmark<8>(iterations);
+    run_fixed_benchmark<16>(iterations);
+    run_fixed_benchmark<32>(iterations);
+    run_fixed_benchmark<64>(iterations);
+    std::cout << std::endl;
+}
+
+// Mixed load: a chain of `chain` dependent products (X1 = X0 * W1, X2 = X1 * W2,
+// ...) next to `independent` unrelated ones, all s x s. Blocking calls one
+// after the other on all threads vs. everything submitted to the async
+// scheduler (lanes on disjoint cores when there are at least as many CPUs as
+// lanes, weights of the chain packed while the previous link runs). Also
+// reports the CPUs of each lane and how long the submitting thread was busy.
+void run_async_benchmark(int s, int chain, int independent, int iterations) {
+    GemmScheduler& scheduler = GemmScheduler::global();
+    std::cout << "Async mixed load, chain of " << chain << " + " << independent << " independent, " << s << "x"
+              << s << " (" << scheduler.lanes() << " lanes)" << std::endl;
+    for (int l = 0; l < scheduler.lanes(); ++l) {
+        std::cout << "  lane " << l << ": " << scheduler.lane_threads(l) << " threads on CPUs";
+        for (int cpu : scheduler.lane_cpus(l)) std::cout << " " << cpu;
+        std::cout << std::endl;
+    }
+
+    Matrix X0, A, B;
+    randomize_matrix(X0, s, s);
+    randomize_matrix(A, s, s);
+    randomize_matrix(B, s, s);
+    std::vector<Matrix> weights(chain), links_sync(chain), links_async(chain);
+    std::vector<Matrix> outs_sync(independent), outs_async(independent);
+    for (auto& w : weights) randomize_matrix(w, s, s);
+
+    auto reset = [&]() {
+        for (int c = 0; c < chain; ++c) {
+            zeros_matrix(links_sync[c], s, s);
+            zeros_matrix(links_async[c], s, s);
+        }
+        for (int i = 0; i < independent; ++i) {
+            zeros_matrix(outs_sync[i], s, s);
+            zeros_matrix(outs_async[i], s, s);
+        }
+    };
+
+    double t_sync = 1e9, t_async = 1e9, t_submit = 1e9;
+    for (int iter = 0; iter < iterations; ++iter) {
+        reset();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int c = 0; c < chain; ++c) {
+            matmul_optimized_sgemm(c == 0 ? X0 : links_sync[c - 1], weights[c], links_sync[c], s, s, s);
+        }
+        for (int i = 0; i < independent; ++i) {
+            matmul_optimized_sgemm(A, B, outs_sync[i], s, s, s);
+        }
+        auto mid = std::chrono::high_resolution_clock::now();
+        // Interleaved like a pipeline would issue them
+        GemmFuture link;
+        for (int k = 0; k < std::max(chain, independent); ++k) {
+            if (k < chain) {
+                link = matmul_async(k == 0 ? X0 : links_async[k - 1], weights[k], links_async[k], s, s, s, {link});
             }
+            if (k < independent) matmul_async(A, B, outs_async[k], s, s, s);
         }
+        auto submitted = std::chrono::high_resolution_clock::now();
+        scheduler.wait_all();
+        auto end = std::chrono::high_resolution_clock::now();
+        t_sync = std::min(t_sync, std::chrono::duration<double>(mid - start).count());
+        t_async = std::min(t_async, std::chrono::duration<double>(end - mid).count());
+        t_submit = std::min(t_submit, std::chrono::duration<double>(submitted - mid).count());
+    }
 
-        std::cout << std::left << std::setw(25) << name 
-                  << std::setw(15) << std::fixed << std::setprecision(4) << min_time 
-                  << std::setw(15) << std::fixed << std::setprecision(2) << gflops 
-                  << status << std::endl;
+    double max_diff = 0.0;
+    for (int c = 0; c < chain; ++c) {
+        for (size_t i = 0; i < links_sync[c].size(); ++i) {
+            max_diff = std::max(max_diff, (double)std::fabs(links_sync[c][i] - links_async[c][i]));
+        }
+    }
+    for (int k = 0; k < independent; ++k) {
+        for (size_t i = 0; i < outs_sync[k].size(); ++i) {
+            max_diff = std::max(max_diff, (double)std::fabs(outs_sync[k][i] - outs_async[k][i]));
+        }
     }
+
+    double flops = 2.0 * s * s * s * (chain + independent);
+    std::cout << "Blocking: " << std::fixed << std::setprecision(6) << t_sync << " s, " << std::setprecision(2)
+              << flops / (t_sync * 1e9) << " GFLOPS" << std::endl;
+    std::cout << "Async:    " << std::setprecision(6) << t_async << " s, " << std::setprecision(2)
+              << flops / (t_async * 1e9) << " GFLOPS, submitting took " << t_submit * 1e6
+              << " us (max difference " << std::scientific << std::setprecision(2) << max_diff << std::fixed << ")"
+              << std::endl;
     std::cout << std::endl;
 }
 
-int main(int argc, char** argv) {
-    // Default sizes
-    std::vector<std::tuple<int, int, int>> sizes = {
-        {128, 128, 128},
-        {256, 256, 256},
-        {512, 512, 512},
-        {1024, 1024, 1024} 
+// Per-call thread count of the std::thread version: matmul_parallel_threads_n
+// with 1, half and all of the pool's threads, timed and checked against
+// matmul_parallel_threads (the same loops, so the results must be identical).
+bool run_thread_count_check(int s, int iterations) {
+    Matrix A, B, C_ref, C;
+    randomize_matrix(A, s, s);
+    randomize_matrix(B, s, s);
+    zeros_matrix(C_ref, s, s);
+    matmul_parallel_threads(A, B, C_ref, s, s, s);
+
+    int pool = ThreadPool::global().size();
+    std::vector<int> counts = {1};
+    if (pool / 2 > 1) counts.push_back(pool / 2);
+    if (pool > 1) counts.push_back(pool);
+
+    bool pass = true;
+    double flops = 2.0 * s * s * s;
+    std::cout << "Parallel Threads per-call thread count, " << s << "^3" << std::endl;
+    for (int threads : counts) {
+        double best = 1e9;
+        for (int iter = 0; iter < iterations; ++iter) {
+            zeros_matrix(C, s, s);
+            auto start = std::chrono::high_resolution_clock::now();
+            matmul_parallel_threads_n(A, B, C, s, s, s, threads);
+            best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+        bool same = C == C_ref;
+        pass = pass && same;
+        std::cout << std::right << std::setw(4) << threads << std::left << " threads: " << std::fixed << std::setprecision(2)
+                  << flops / (best * 1e9) << " GFLOPS " << (same ? "PASS" : "FAIL") << std::endl;
+    }
+    std::cout << std::endl;
+    return pass;
+}
+
+// Dependency ordering of the async scheduler, checked against the same
+// products run one after the other:
+//  - an indirect chain: C0 = A0 * B0, C1 = C0 * B1 after C0, D = Ad * C0 after
+//    C1 only (D's B is written by a product D depends on through C1);
+//  - random graphs over a few shared s x s buffers, each product naming only the
+//    last writers of its operands and the readers of its output as `after`.
+// Runs on its own scheduler with 3 lanes (the OpenMP thread count is raised to 3
+// for the scheduler if needed), so products and early packing overlap.
+bool run_async_dependency_check(int s, int iterations) {
+    int saved_threads = omp_get_max_threads();
+    omp_set_num_threads(std::max(3, saved_threads));
+    GemmScheduler scheduler(3);
+    omp_set_num_threads(saved_threads);
+
+    // Operands scaled so that chained products keep their magnitude
+    auto operand = [&](Matrix& M) {
+        randomize_matrix(M, s, s);
+        for (auto& v : M) v /= std::sqrt((float)s);
+    };
+    auto relative_error = [](const Matrix& X, const Matrix& ref) {
+        double max_diff = 0.0, max_ref = 1e-30;
+        for (size_t i = 0; i < X.size(); ++i) {
+            max_diff = std::max(max_diff, (double)std::fabs(X[i] - ref[i]));
+            max_ref = std::max(max_ref, (double)std::fabs(ref[i]));
+        }
+        return max_diff / max_ref;
+    };
+    const double tolerance = 1e-4;
+
+    int chain_failures = 0;
+    for (int iter = 0; iter < iterations; ++iter) {
+        Matrix A0, B0, B1, Ad, C0, C1, D, C0_ref, D_ref;
+        operand(A0);
+        operand(B0);
+        operand(B1);
+        operand(Ad);
+        zeros_matrix(C0, s, s);
+        zeros_matrix(C1, s, s);
+        zeros_matrix(D, s, s);
+        zeros_matrix(C0_ref, s, s);
+        zeros_matrix(D_ref, s, s);
+
+        GemmFuture f0 = scheduler.submit({A0.data(), s, B0.data(), s, C0.data(), s, s, s, s});
+        GemmFuture f1 = scheduler.submit({C0.data(), s, B1.data(), s, C1.data(), s, s, s, s}, {f0});
+        scheduler.submit({Ad.data(), s, C0.data(), s, D.data(), s, s, s, s}, {f1});
+        scheduler.wait_all();
+
+        matmul_optimized_sgemm(A0, B0, C0_ref, s, s, s);
+        matmul_optimized_sgemm(Ad, C0_ref, D_ref, s, s, s);
+        if (relative_error(D, D_ref) > tolerance) ++chain_failures;
+    }
+
+    const int BUFFERS = 5, OPS = 12;
+    int graph_failures = 0;
+    std::srand(11);
+    for (int iter = 0; iter < iterations; ++iter) {
+        std::vector<Matrix> bufs(BUFFERS), refs(BUFFERS);
+        for (int b = 0; b < BUFFERS; ++b) {
+            operand(bufs[b]);
+            refs[b] = bufs[b];
+        }
+        std::vector<GemmFuture> last_writer(BUFFERS);
+        std::vector<std::vector<GemmFuture>> readers(BUFFERS);
+        for (int op = 0; op < OPS; ++op) {
+            int out = std::rand() % BUFFERS;
+            int a = (out + 1 + std::rand() % (BUFFERS - 1)) % BUFFERS;
+            int b = (out + 1 + std::rand() % (BUFFERS - 1)) % BUFFERS;
+
+            std::vector<GemmFuture> after = readers[out];
+            after.push_back(last_writer[out]);
+            after.push_back(last_writer[a]);
+            after.push_back(last_writer[b]);
+            GemmFuture f = scheduler.submit({bufs[a].data(), s, bufs[b].data(), s, bufs[out].data(), s, s, s, s},
+                                            after);
+            last_writer[out] = f;
+            readers[out].clear();
+            readers[a].push_back(f);
+            readers[b].push_back(f);
+
+            matmul_optimized_sgemm(refs[a], refs[b], refs[out], s, s, s);
+        }
+        scheduler.wait_all();
+        for (int b = 0; b < BUFFERS; ++b) {
+            if (relative_error(bufs[b], refs[b]) > tolerance) {
+                ++graph_failures;
+                break;
+            }
+        }
+    }
+
+    bool pass = chain_failures == 0 && graph_failures == 0;
+    std::cout << "Async dependencies (" << scheduler.lanes() << " lanes, " << s << "x" << s
+              << "): indirect chain wrong in " << chain_failures << "/" << iterations << ", random graphs wrong in "
+              << graph_failures << "/" << iterations << " " << (pass ? "PASS" : "FAIL") << std::endl;
+    std::cout << std::endl;
+    return pass;
+}
+
+// Sparse A (s x s) times a dense s x s B at a few densities, with the nonzeros
+// scattered at random and in 8x8 clusters (75% filled, like block-pruned
+// weights): dense SGEMM on A vs. CSR vs. BSR vs. the format Auto picks.
+// Effective GFLOPS count the dense 2 * s^3, so they compare directly.
+// Every sparse result must match the dense one within the K-scaled bound of
+// verify.h: each side is off by at most s * u * (|A||B|)_ij, so they may differ
+// by twice that (times the usual tolerance factor of 2). Returns false if not.
+bool run_sparse_benchmark(int s, int iterations) {
+    std::cout << "Sparse x dense, " << s << "x" << s << " * " << s << "x" << s << " (" << sparse_kernel_name()
+              << " kernels), effective GFLOPS" << std::endl;
+    std::cout << std::left << std::setw(10) << "Pattern" << std::setw(10) << "Density" << std::setw(8) << "Fill"
+              << std::setw(10) << "Dense" << std::setw(10) << "CSR" << std::setw(10) << "BSR" << std::setw(16)
+              << "Auto" << "Max diff" << std::endl;
+    std::cout << std::string(89, '-') << std::endl;
+
+    Matrix B, B_abs, C_dense, C_sparse, C_scale;
+    randomize_matrix(B, s, s);
+    B_abs = B;
+    for (auto& b : B_abs) b = std::fabs(b);
+    zeros_matrix(C_dense, s, s);
+    zeros_matrix(C_sparse, s, s);
+    std::srand(7);
+    auto uniform = []() { return (float)std::rand() / (float)RAND_MAX; };
+
+    // Best of `iterations`, C zeroed before each run (outside the timing)
+    auto best_time = [&](Matrix& C, const std::function<void()>& call) {
+        double best = 1e9;
+        for (int iter = 0; iter < iterations; ++iter) {
+            zeros_matrix(C, s, s);
+            auto start = std::chrono::high_resolution_clock::now();
+            call();
+            best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+        return best;
     };
+    // Largest |C_dense - C_sparse| and whether every element is inside its bound
+    // (C_scale holds |A||B|, rounded to float, which is far below the bound)
+    const double allowed = 2.0 * 2.0 * s * FLOAT_UNIT_ROUNDOFF;
+    bool all_pass = true;
+    auto max_difference = [&](bool& pass) {
+        double max_diff = 0.0;
+        for (size_t i = 0; i < C_dense.size(); ++i) {
+            double diff = std::fabs((double)C_dense[i] - (double)C_sparse[i]);
+            max_diff = std::max(max_diff, diff);
+            if (!(diff <= allowed * C_scale[i])) pass = false;
+        }
+        return max_diff;
+    };
+
+    const int BLK = SparseMatrix::BLOCK;
+    const double flops = 2.0 * s * s * s;
+    for (int blocky = 0; blocky < 2; ++blocky) {
+        for (double density : {0.01, 0.05, 0.1, 0.2}) {
+            Matrix A(static_cast<size_t>(s) * s, 0.0f);
+            if (!blocky) {
+                for (auto& a : A) {
+                    if (uniform() < density) a = uniform() - 0.5f;
+                }
+            } else {
+                for (int bi = 0; bi < s; bi += BLK) {
+                    for (int bk = 0; bk < s; bk += BLK) {
+                        if (uniform() >= density / 0.75) continue;
+                        for (int i = bi; i < std::min(bi + BLK, s); ++i) {
+                            for (int k = bk; k < std::min(bk + BLK, s); ++k) {
+                                if (uniform() < 0.75f) A[(size_t)i * s + k] = uniform() - 0.5f;
+                            }
+                        }
+                    }
+                }
+            }
 
-    for (const auto& [m, n, p] : sizes) {
-        run_benchmark(m, n, p, 3);
+            SparseMatrix csr, bsr, automatic;
+            csr.from_dense(A.data(), s, s, s, SparseFormat::CSR);
+            bsr.from_dense(A.data(), s, s, s, SparseFormat::BSR);
+            automatic.from_dense(A.data(), s, s, s);
+
+            // Error scale |A||B|, itself a sparse product
+            Matrix A_abs = A;
+            for (auto& a : A_abs) a = std::fabs(a);
+            SparseMatrix abs_csr;
+            abs_csr.from_dense(A_abs.data(), s, s, s, SparseFormat::CSR);
+            zeros_matrix(C_scale, s, s);
+            matmul_sparse(abs_csr, B_abs.data(), s, C_scale.data(), s, s);
+
+            double t_dense = best_time(C_dense, [&] {
+                matmul_optimized_sgemm_strided(A.data(), s, B.data(), s, C_dense.data(), s, s, s, s);
+            });
+            double t_csr = best_time(C_sparse, [&] { matmul_sparse(csr, B.data(), s, C_sparse.data(), s, s); });
+            bool pass = true;
+            double max_diff = max_difference(pass);
+            double t_bsr = best_time(C_sparse, [&] { matmul_sparse(bsr, B.data(), s, C_sparse.data(), s, s); });
+            max_diff = std::max(max_diff, max_difference(pass));
+            double t_auto = best_time(C_sparse, [&] { matmul_sparse(automatic, B.data(), s, C_sparse.data(), s, s); });
+            max_diff = std::max(max_diff, max_difference(pass));
+            all_pass = all_pass && pass;
+
+            std::cout << std::left << std::setw(10) << (blocky ? "8x8" : "random") << std::fixed
+                      << std::setprecision(3) << std::setw(10) << csr.density() << std::setprecision(2)
+                      << std::setw(8) << bsr.block_fill();
+            for (double t : {t_dense, t_csr, t_bsr}) std::cout << std::setw(10) << flops / (t * 1e9);
+            std::cout << std::setw(16)
+                      << (std::to_string((int)(flops / (t_auto * 1e9))) + " (" +
+                          sparse_format_name(automatic.format()) + ")")
+                      << std::scientific << std::setprecision(2) << max_diff << std::fixed << " "
+                      << (pass ? "PASS" : "FAIL") << std::endl;
+        }
+    }
+    std::cout << std::endl;
+    return all_pass;
+}
+
+// Out-of-core: an n x n product through memory-mapped files in the working
+// directory vs. the same product in memory. The files are written first and
+// the page cache is not dropped, so this measures the streaming overhead; run
+// with files larger than RAM (see out_of_core.h) to measure the I/O overlap.
+int run_out_of_core_benchmark(int n, bool prefetch) {
+    const std::string path_a = "matmul_ooc_A.bin", path_b = "matmul_ooc_B.bin", path_c = "matmul_ooc_C.bin";
+    std::cout << "Out-of-core " << n << "x" << n << " * " << n << "x" << n << std::endl;
+
+    Matrix A, B, C;
+    randomize_matrix(A, n, n);
+    randomize_matrix(B, n, n);
+    if (!write_matrix_file(path_a, A, n, n) || !write_matrix_file(path_b, B, n, n)) {
+        std::cerr << "Could not write the matrix files" << std::endl;
+        return 1;
     }
 
+    zeros_matrix(C, n, n);
+    auto start = std::chrono::high_resolution_clock::now();
+    matmul_optimized_sgemm(A, B, C, n, n, n);
+    double t_memory = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    MappedMatrix file_a, file_b, file_c;
+    StreamingOptions options;
+    options.prefetch = prefetch;
+    StreamingStats stats;
+    bool ok = file_a.open(path_a, false) && file_b.open(path_b, false) && file_c.create(path_c, n, n) &&
+              matmul_streaming(file_a, file_b, file_c, options, &stats) && file_c.sync();
+    file_c.close();
+    int rows = 0, cols = 0;
+    ok = ok && read_matrix_file(path_c, C, rows, cols);
+    std::remove(path_a.c_str());
+    std::remove(path_b.c_str());
+    std::remove(path_c.c_str());
+    if (!ok) {
+        std::cerr << "Streaming GEMM failed (mmap not available?)" << std::endl;
+        return 1;
+    }
+
+    VerifyReport check = verify_freivalds(A, B, C, n, n, n);
+    double flops = 2.0 * n * n * n;
+    std::cout << "In memory: " << std::fixed << std::setprecision(2) << flops / (t_memory * 1e9) << " GFLOPS" << std::endl;
+    std::cout << "Streaming: " << flops / (stats.seconds * 1e9) << " GFLOPS (tile " << stats.tile << ", depth "
+              << stats.depth << ", " << stats.steps << " steps, waited " << stats.io_wait_seconds << " s for I/O) "
+              << (check.pass ? "PASS" : "FAIL") << std::endl;
+    return check.pass ? 0 : 2;
+}
+
+// Machine-readable output
+// One row/object per (method, shape). The JSON also records the machine limits
+// and the kernel configuration, so runs from different commits or machines can
+// be compared.
+static bool write_csv(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "method,category,m,n,p,median_s,p95_s,stddev_s,min_s,samples,rejected,gflops,pct_peak,pct_roofline,"
+           "intensity,status,verify_mode,max_rel_error,max_ulp_error,err_bound_ratio,ipc,l1d_miss_per_kflop,llc_miss_per_kflop,dtlb_miss_per_kflop,fma_util,pack_a_pct,"
+           "pack_b_pct,compute_pct\n";
+    out << std::setprecision(9);
+    for (const auto& r : results) {
+        out << r.method << "," << r.shape.category << "," << r.shape.m << "," << r.shape.n << "," << r.shape.p << ","
+            << r.stats.median << "," << r.stats.p95 << "," << r.stats.stddev << "," << r.stats.min << ","
+            << r.stats.samples << "," << r.stats.rejected << "," << r.gflops << "," << r.pct_peak << ","
+            << r.pct_roofline << "," << r.intensity << "," << r.status << "," << r.verify_mode;
+        for (double v : {r.verify.max_rel_error, r.verify.max_ulp_error, r.verify.worst_ratio, r.counters.ipc, r.counters.l1d_miss_per_kflop, r.counters.llc_miss_per_kflop,
+                         r.counters.dtlb_miss_per_kflop, r.counters.fma_utilization, r.pack_a_pct, r.pack_b_pct,
+                         r.compute_pct}) {
+            out << ",";
+            if (v >= 0) out << v; // Empty when not measured
+        }
+        out << "\n";
+    }
+    return (bool)out;
+}
+
+static bool write_json(const std::string& path, const MachineInfo& machine, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out) return false;
+    BlockingParams blocking = blocking_params();
+    out << std::setprecision(9);
+    out << "{\n";
+    out << "  \"timestamp\": " << (long long)std::time(nullptr) << ",\n";
+    out << "  \"machine\": {\"isa\": \"" << cpu_isa_name(active_cpu_isa()) << "\", \"kernel\": \""
+        << sgemm_kernel().name << "\", \"threads\": " << machine.threads << ", \"peak_gflops\": "
+        << machine.peak_gflops << ", \"bandwidth_gbs\": " << machine.bandwidth_gbs << ", \"mc\": " << blocking.mc
+        << ", \"kc\": " << blocking.kc << ", \"nc\": " << blocking.nc << "},\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << "    {\"method\": \"" << r.method << "\", \"category\": \"" << r.shape.category << "\", \"m\": "
+            << r.shape.m << ", \"n\": " << r.shape.n << ", \"p\": " << r.shape.p << ", \"median_s\": "
+            << r.stats.median << ", \"p95_s\": " << r.stats.p95 << ", \"stddev_s\": " << r.stats.stddev
+            << ", \"min_s\": " << r.stats.min << ", \"samples\": " << r.stats.samples << ", \"rejected\": "
+            << r.stats.rejected << ", \"gflops\": " << r.gflops << ", \"pct_peak\": " << r.pct_peak
+            << ", \"pct_roofline\": " << r.pct_roofline << ", \"intensity\": " << r.intensity
+            << ", \"status\": \"" << r.status << "\", \"verify_mode\": \"" << r.verify_mode << "\"";
+        const char* names[] = {"max_rel_error", "max_ulp_error", "err_bound_ratio", "ipc", "l1d_miss_per_kflop", "llc_miss_per_kflop", "dtlb_miss_per_kflop",
+                               "fma_util", "pack_a_pct", "pack_b_pct", "compute_pct"};
+        const double values[] = {r.verify.max_rel_error, r.verify.max_ulp_error, r.verify.worst_ratio, r.counters.ipc, r.counters.l1d_miss_per_kflop, r.counters.llc_miss_per_kflop,
+                                 r.counters.dtlb_miss_per_kflop, r.counters.fma_utilization, r.pack_a_pct,
+                                 r.pack_b_pct, r.compute_pct};
+        for (int f = 0; f < 11; ++f) {
+            out << ", \"" << names[f] << "\": ";
+            if (values[f] >= 0) out << values[f];
+            else out << "null";
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+
+static void print_usage() {
+    std::cout << "Usage: benchmark_runner [options]\n"
+              << "  --full               Add the large shapes (2048-16384)\n"
+              << "  --methods A,B        Only run these methods (names as printed)\n"
+              << "  --iterations N       At least N timed runs per method (default 5)\n"
+              << "  --csv FILE           Write results as CSV\n"
+              << "  --json FILE          Write results and machine info as JSON\n"
+              << "  --verify MODE        auto (default) | reference | freivalds | off\n"
+              << "  --counters           Hardware counters (perf_event_open) and SGEMM phase times\n"
+              << "  --autotune [n]       Tune the cache blocking and save the profile\n"
+              << "  --calibrate-dispatch Measure the matmul_auto crossovers and save the profile\n"
+              << "  --out-of-core n      Streaming GEMM on memory-mapped files (n x n, in the working directory)\n"
+              << "  --no-prefetch        With --out-of-core: no background prefetch\n"
+              << "  --strassen-depth n   Task depth of Strassen Parallel (-1 = automatic)\n";
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    bool use_counters = false;
+    int out_of_core_n = 0;
+    bool prefetch = true;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = (i + 1 < argc);
+        if (arg == "--autotune") {
+            // Search the blocking parameters on this machine and write the tuning
+            // profile that the kernels load at startup.
+            int n = (has_value && std::atoi(argv[i + 1]) > 0) ? std::atoi(argv[i + 1]) : 1024;
+            BlockingParams best = autotune_blocking(n, true);
+            std::string path = tuning_profile_path();
+            if (!save_tuning_profile(path, best)) {
+                std::cerr << "Could not write tuning profile " << path << std::endl;
+                return 1;
+            }
+            std::cout << "Best: MC=" << best.mc << " KC=" << best.kc << " NC=" << best.nc
+                      << " tile=" << best.tile_block << " Strassen cutoff=" << best.strassen_cutoff << ", saved to " << path
+                      << std::endl;
+            return 0;
+        } else if (arg == "--calibrate-dispatch") {
+            // Crossovers for matmul_auto (kernel and thread count per shape)
+            DispatchParams params = calibrate_dispatch(true);
+            std::string path = dispatch_profile_path();
+            if (!save_dispatch_profile(path, params)) {
+                std::cerr << "Could not write dispatch profile " << path << std::endl;
+                return 1;
+            }
+            std::cout << "Dispatch: tiny <= " << params.tiny_max_flops << " FLOPs, " << params.flops_per_thread
+                      << " FLOPs/thread, skinny <= " << params.skinny_max_dim << ", huge >= " << params.huge_min_dim
+                      << ", saved to " << path << std::endl;
+            return 0;
+        } else if (arg == "--out-of-core" && has_value) {
+            out_of_core_n = std::atoi(argv[++i]);
+        } else if (arg == "--strassen-depth" && has_value) {
+            set_strassen_task_depth(std::atoi(argv[++i]));
+        } else if (arg == "--no-prefetch") {
+            prefetch = false;
+        } else if (arg == "--counters") {
+            use_counters = true;
+        } else if (arg == "--verify" && has_value) {
+            config.verify = argv[++i];
+        } else if (arg == "--full") {
+            config.full = true;
+        } else if (arg == "--iterations" && has_value) {
+            config.min_iterations = std::max(1, std::atoi(argv[++i]));
+            config.max_iterations = std::max(config.max_iterations, config.min_iterations);
+        } else if (arg == "--csv" && has_value) {
+            config.csv_path = argv[++i];
+        } else if (arg == "--json" && has_value) {
+            config.json_path = argv[++i];
+        } else if (arg == "--methods" && has_value) {
+            std::stringstream list(argv[++i]);
+            std::string name;
+            while (std::getline(list, name, ',')) config.only_methods.push_back(name);
+        } else {
+            print_usage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (out_of_core_n > 0) {
+        return run_out_of_core_benchmark(out_of_core_n, prefetch);
+    }
+
+    // Opened before the first parallel region, so every worker thread inherits them
+    std::unique_ptr<PerfCounters> counters;
+    if (use_counters) {
+        counters.reset(new PerfCounters());
+        config.counters = counters.get();
+        std::cout << "Counters: " << counters->status() << std::endl;
+    }
+
+    BlockingParams blocking = blocking_params();
+    MachineInfo machine = measure_machine();
+    std::cout << "Kernel: " << sgemm_kernel().name << ", threads: " << machine.threads
+              << ", blocking: MC=" << blocking.mc << " KC=" << blocking.kc << " NC=" << blocking.nc
+              << " tile=" << blocking.tile_block << std::endl;
+    std::cout << "Measured peak: " << std::fixed << std::setprecision(1) << machine.peak_gflops
+              << " GFLOPS, memory bandwidth: " << machine.bandwidth_gbs << " GB/s" << std::endl << std::endl;
+
+    std::vector<BenchResult> results;
+    for (const auto& shape : make_shapes(config.full)) {
+        run_benchmark(shape, config, machine, results);
+        if (shape.category == "square") {
+            run_mixed_precision_benchmark(shape, config, machine, results);
+        }
+    }
+
+    // First-touch placement and per-node teams vs. one team
+    bool checks_pass = run_numa_benchmark(2048, 3);
+
+    // Many small independent products
+    for (int s : {16, 32, 64, 128}) {
+        run_batched_benchmark(s, s, s, 1000, 3);
+    }
+
+    // Dependent chain next to independent products
+    run_async_benchmark(512, 4, 8, 3);
+    checks_pass = run_async_dependency_check(512, 20) && checks_pass;
+
+    // Per-call thread count of the std::thread pool version
+    checks_pass = run_thread_count_check(512, 3) && checks_pass;
+
+    // Sparse A: CSR / BSR vs. dense around the crossover
+    checks_pass = run_sparse_benchmark(2048, 3) && checks_pass;
+
+    // Common small sizes, per call
+    run_fixed_benchmarks(5);
+
+    // Square and short-K (epilogue pass comparable to the product itself)
+    checks_pass = run_epilogue_benchmark(1024, 1024, 1024, 3) && checks_pass;
+    checks_pass = run_epilogue_benchmark(4096, 64, 4096, 3) && checks_pass;
+
+    // Serving: a few rows of activations against fixed weights
+    for (int m : {1, 16, 128}) {
+        checks_pass = run_prepacked_benchmark(m, 2048, 2048, 10) && checks_pass;
+    }
+
+    if (!config.csv_path.empty() && !write_csv(config.csv_path, results)) {
+        std::cerr << "Could not write " << config.csv_path << std::endl;
+        return 1;
+    }
+    if (!config.json_path.empty() && !write_json(config.json_path, machine, results)) {
+        std::cerr << "Could not write " << config.json_path << std::endl;
+        return 1;
+    }
+
+    // Non-zero exit if any kernel produced a wrong result, so CI can gate on it
+    if (!checks_pass) return 2;
+    for (const auto& r : results) {
+        if (r.status == "FAIL") return 2;
+    }
     return 0;
 }
@@ -1,6 +1,6 @@
 @echo off
 if not exist build mkdir build
-"C:\MinGW\bin\g++.exe" -O3 -march=native -mavx2 -mfma -fopenmp -I include src/naive.cpp src/loop_reorder.cpp src/tiled.cpp src/simd.cpp src/parallel_omp.cpp src/parallel_threads.cpp src/strassen.cpp src/optimized_sgemm.cpp benchmark/benchmark_harness.cpp -o build/benchmark_runner.exe
+"C:\MinGW\bin\g++.exe" -O3 -fopenmp -I include src/aligned_buffer.cpp src/cpu_dispatch.cpp src/tuning.cpp src/sgemm_kernels.cpp src/naive.cpp src/loop_reorder.cpp src/tiled.cpp src/simd.cpp src/parallel_omp.cpp src/thread_pool.cpp src/parallel_threads.cpp src/strassen.cpp src/optimized_sgemm.cpp src/batched.cpp src/numa.cpp src/perf_counters.cpp src/verify.cpp src/mixed_precision.cpp src/int8_gemm.cpp src/out_of_core.cpp src/matmul_auto.cpp src/packed_matrix.cpp src/skinny_gemm.cpp src/matmul_fixed.cpp src/matmul_async.cpp src/sparse_gemm.cpp benchmark/benchmark_harness.cpp -o build/benchmark_runner.exe
 if %errorlevel% neq 0 (
     echo Compilation failed!
     exit /b %errorlevel%
@@ -0,0 +1,109 @@
+#ifndef ALIGNED_BUFFER_H
+#define ALIGNED_BUFFER_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Aligned storage
+// - Every allocation is 64-byte aligned (one cache line, one ZMM register), so
+//   rows never straddle an extra line at the start and aligned SIMD access is legal.
+// - Allocations of HUGE_PAGE_THRESHOLD bytes or more are aligned to 2 MB and
+//   advised as transparent huge pages (madvise(MADV_HUGEPAGE) on Linux), which
+//   cuts TLB misses when the kernels stride down the columns of large matrices.
+//   Set MATMUL_HUGE_PAGES=0 (or call set_huge_pages_enabled(false)) to turn it off.
+// - Elements are default-initialized: resize() does not zero memory that is about
+//   to be overwritten anyway. Use assign(n, 0.0f) (zeros_matrix) when zeros are needed.
+
+constexpr size_t CACHE_LINE_ALIGNMENT = 64;
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+constexpr size_t HUGE_PAGE_THRESHOLD = 4 * 1024 * 1024;
+
+void* aligned_alloc_bytes(size_t bytes);
+void aligned_free_bytes(void* ptr);
+
+bool huge_pages_enabled();
+void set_huge_pages_enabled(bool enabled);
+
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > (size_t)-1 / sizeof(T)) throw std::bad_array_new_length();
+        return static_cast<T*>(aligned_alloc_bytes(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t) noexcept {
+        aligned_free_bytes(ptr);
+    }
+
+    // Default-initialize instead of value-initialize (no zeroing on resize)
+    template <typename U>
+    void construct(U* ptr) noexcept(noexcept(::new ((void*)ptr) U)) {
+        ::new ((void*)ptr) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* ptr, Args&&... args) {
+        ::new ((void*)ptr) U(static_cast<Args&&>(args)...);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const AlignedAllocator<T>&, const AlignedAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const AlignedAllocator<T>&, const AlignedAllocator<U>&) { return false; }
+
+using AlignedVector = std::vector<float, AlignedAllocator<float>>;
+
+// Row padding
+// With a leading dimension that is a multiple of 256 floats (1 KB: our 1024,
+// 2048, 4096 shapes and their halves), the same column of consecutive rows maps
+// to the same L1 set and to addresses that differ by a multiple of 4 KB, so loads
+// falsely alias earlier stores. padded_ld() rounds cols up to a whole cache line
+// and adds one more line when the stride would hit that pattern.
+inline int padded_ld(int cols) {
+    const int line = (int)(CACHE_LINE_ALIGNMENT / sizeof(float));
+    int ld = (cols + line - 1) / line * line;
+    if (ld % 256 == 0) ld += line;
+    return ld;
+}
+
+// Row-major matrix with a padded leading dimension: element (i, j) is at
+// data[i * ld + j]. Use it with the strided entry points (sgemm, ..._strided).
+struct PaddedMatrix {
+    AlignedVector data;
+    int rows = 0;
+    int cols = 0;
+    int ld = 0;
+
+    PaddedMatrix() = default;
+    PaddedMatrix(int rows, int cols)
+        : data((size_t)rows * padded_ld(cols), 0.0f), rows(rows), cols(cols), ld(padded_ld(cols)) {}
+
+    float* row(int i) { return data.data() + (size_t)i * ld; }
+    const float* row(int i) const { return data.data() + (size_t)i * ld; }
+};
+
+// Thread-local packing buffer pool
+// The packing buffers of the SGEMM driver are grow-only and owned by the calling
+// thread, so repeated calls (a batch of small products, Strassen leaves, ...)
+// never go back to the allocator. Each slot is an independent buffer; a caller
+// must not hand out the same slot twice at the same time.
+enum class PackSlot {
+    A = 0, // Packed MC x KC block of A (one per thread)
+    B = 1  // Packed KC x NC panel of B (shared by the team, owned by the caller)
+};
+
+// At least `count` floats, 64-byte (or huge-page) aligned. Contents are unspecified.
+float* packing_buffer(PackSlot slot, size_t count);
+
+// Frees this thread's pooled buffers (e.g. after a one-off huge product).
+void release_packing_buffers();
+
+#endif // ALIGNED_BUFFER_H
@@ -0,0 +1,103 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+// Runtime CPU dispatch
+// The SIMD kernels are compiled for several instruction sets into the same binary
+// (per-function target attributes instead of global -mavx2/-march=native flags),
+// and the best one the running CPU supports is picked once at startup via CPUID.
+// So a binary built on one machine runs (at full speed) on every part of the fleet.
+
+// Per-function ISA targets. Only functions marked with these may use the
+// matching intrinsics; everything else is compiled for the baseline ISA.
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+// Extensions used by the mixed-precision kernels (see cpu_features())
+#define TARGET_AVX2_F16C __attribute__((target("avx2,fma,f16c")))
+#define TARGET_AVX512_VNNI __attribute__((target("avx512f,avx512bw,avx512vnni")))
+#else
+// MSVC allows any intrinsic in any function, no attribute needed.
+#define TARGET_AVX2
+#define TARGET_AVX512
+#define TARGET_AVX2_F16C
+#define TARGET_AVX512_VNNI
+#endif
+
+// Instruction set levels, ordered from slowest to fastest
+enum class CpuIsa {
+    Scalar = 0, // Portable C++ (whatever the compiler emits for the baseline, e.g. SSE2)
+    AVX2 = 1,   // AVX2 + FMA3, 16 YMM registers (8 floats)
+    AVX512 = 2  // AVX-512F, 32 ZMM registers (16 floats)
+};
+
+// Best ISA supported by this CPU and OS (CPUID + XGETBV), detected once.
+CpuIsa detect_cpu_isa();
+
+// ISA the kernels actually use. Defaults to detect_cpu_isa(); the environment
+// variable MATMUL_ISA=scalar|avx2|avx512 can force a lower level (e.g. to
+// compare kernels on one machine). Requests above what the CPU supports are ignored.
+CpuIsa active_cpu_isa();
+
+const char* cpu_isa_name(CpuIsa isa);
+
+// Extensions beyond the ISA level, for the mixed-precision kernels. Only reported
+// when the active ISA (after MATMUL_ISA) is high enough to use them, so forcing
+// MATMUL_ISA=scalar also switches the half-precision conversions and the int8
+// kernels to their portable versions.
+struct CpuFeatures {
+    bool f16c;        // Half <-> float conversion (with AVX2)
+    bool avx512bw;    // 8/16-bit integer ops on ZMM (with AVX-512)
+    bool avx512vnni;  // vpdpbusd: u8 x s8 dot products into s32 (with AVX-512)
+};
+
+const CpuFeatures& cpu_features();
+
+// Data cache sizes in bytes (per core for L1/L2, total for L3).
+// Read from sysfs on Linux, otherwise from CPUID leaf 4 (deterministic cache
+// parameters); entries that cannot be determined fall back to 32K / 256K / 8M.
+struct CacheSizes {
+    long l1d;
+    long l2;
+    long l3;
+};
+
+CacheSizes detect_cache_sizes();
+
+// SGEMM micro-kernel
+// Computes C[0:mr, 0:nr] = A_panel * B_panel + beta * C[0:mr, 0:nr] for one
+// MR x NR tile, where A_panel is packed as A[p * MR + i] and B_panel as
+// B[p * NR + j] (zero-padded). With beta == 0, C is not read.
+using SgemmMicroKernel = void (*)(int k, const float* A, const float* B, float* C, int ldc, int mr, int nr,
+                                  float beta);
+
+// Small-matrix kernel
+// C += A * B straight from the (unpacked, row-major, strided) operands. For tiny
+// shapes (16-64) packing costs more than it saves, so batched and small calls
+// use this instead of the packed micro-kernel.
+using SmallGemmKernel = void (*)(int m, int n, int p, const float* A, int lda, const float* B, int ldb,
+                                 float* C, int ldc);
+
+// Same micro-kernel with the fused epilogue (sgemm.h) applied before the
+// store; row / col are the position of the tile in C (for the biases and the
+// separate output). Used for the last K block only.
+struct SgemmEpilogue;
+using SgemmEpilogueKernel = void (*)(int k, const float* A, const float* B, float* C, int ldc, int mr, int nr,
+                                     float beta, const SgemmEpilogue& epilogue, int row, int col);
+
+struct SgemmKernel {
+    const char* name;        // e.g. "avx2-6x16"
+    CpuIsa isa;
+    int mr;                  // Rows of the register tile (A panel width)
+    int nr;                  // Columns of the register tile (B panel width)
+    SgemmMicroKernel kernel;
+    SmallGemmKernel small;   // Unpacked kernel for tiny shapes
+    SgemmEpilogueKernel kernel_epilogue;
+};
+
+// Micro-kernel for a given ISA level
+const SgemmKernel& sgemm_kernel_for(CpuIsa isa);
+
+// Micro-kernel selected for this machine (sgemm_kernel_for(active_cpu_isa()))
+const SgemmKernel& sgemm_kernel();
+
+#endif // CPU_DISPATCH_H
@@ -0,0 +1,130 @@
+#ifndef MATMUL_ASYNC_H
+#define MATMUL_ASYNC_H
+
+#include "matrix_utils.h"
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Asynchronous GEMM
+// Every matmul_* call blocks until C is complete. matmul_async only queues the
+// product and returns a GemmFuture, so the caller can prepare the next inputs
+// while it runs, and products can name the futures they depend on (a chain
+// C1 = A * B, D = C1 * E is D submitted "after" C1).
+//
+// The products run on a GemmScheduler: the threads of the process are split
+// into lanes, disjoint sets of cores. Each lane is one persistent thread that
+// runs one product at a time on its own OpenMP team (its team size is set per
+// lane, so every parallel region it starts stays on the lane's cores). With
+// more than one lane, independent products run side by side instead of taking
+// turns on all cores, which raises the throughput of mixed loads of mid-sized
+// products (each scales worse on all cores than on a share of them). Each lane
+// is bound to its own CPUs: on a NUMA machine lane i gets node i % nodes (split
+// between the lanes of a node), on a single node the CPUs are split evenly
+// between the lanes (numa_cpu_share). With fewer CPUs than lanes the sets
+// overlap. MATMUL_NUMA_NODES=k (numa.h) simulates nodes.
+//
+// Pipelining: a product that waits for other products does not need its B
+// operand from them unless B overlaps the output of a product that has not
+// finished yet (checked on the address ranges against all of them, since B can
+// be written by a product it only depends on indirectly). Then B is packed into a PackedMatrix by a lane with nothing
+// else to do while the producers still run, and the product itself uses the
+// pre-packed B (no pack_B on the critical path).
+//
+// Conventions as matmul_*: C += A * B, A m x n, B n x p, row-major with leading
+// dimensions. The operands must stay alive and unchanged (and C untouched by
+// the caller) until the future is ready; only the `after` products are ordered
+// against it, everything else is the caller's to synchronize.
+
+struct GemmOp {
+    const float* A = nullptr;
+    int lda = 0;
+    const float* B = nullptr;
+    int ldb = 0;
+    float* C = nullptr;
+    int ldc = 0;
+    int m = 0, n = 0, p = 0;
+};
+
+struct AsyncGemmJob;
+class GemmScheduler;
+
+// Completion handle of one submitted product (copyable, shared)
+class GemmFuture {
+public:
+    GemmFuture() = default;
+
+    bool valid() const { return job_ != nullptr; }
+    bool ready() const;
+    void wait() const;
+
+private:
+    friend class GemmScheduler;
+    std::shared_ptr<AsyncGemmJob> job_;
+};
+
+class GemmScheduler {
+public:
+    // lanes = 0: MATMUL_ASYNC_LANES if set, else one lane per NUMA node on
+    // multi-node machines, else 2 (1 with a single thread). The threads
+    // (omp_get_max_threads()) are divided evenly between the lanes.
+    explicit GemmScheduler(int lanes = 0);
+    // Waits for everything submitted
+    ~GemmScheduler();
+
+    GemmScheduler(const GemmScheduler&) = delete;
+    GemmScheduler& operator=(const GemmScheduler&) = delete;
+
+    int lanes() const { return (int)lanes_.size(); }
+    int lane_threads(int lane) const { return lanes_[lane].threads; }
+    const std::vector<int>& lane_cpus(int lane) const { return lanes_[lane].cpus; }
+
+    // Queues C += A * B to run once every future in `after` is ready. Invalid
+    // futures in `after` are ignored, futures of another scheduler are waited
+    // for here. Returns an invalid future for an invalid op (null pointers,
+    // dimensions <= 0, leading dimensions too small).
+    GemmFuture submit(const GemmOp& op, const std::vector<GemmFuture>& after = {});
+
+    // Blocks until everything submitted so far is done
+    void wait_all();
+
+    // Process-wide scheduler, created on first use
+    static GemmScheduler& global();
+
+private:
+    struct Lane {
+        int threads;
+        std::vector<int> cpus; // The lane's share of the CPUs (empty = unbound)
+        std::thread worker;
+    };
+
+    void lane_loop(int lane);
+    void run_pack(const std::shared_ptr<AsyncGemmJob>& job);
+    void run_product(const std::shared_ptr<AsyncGemmJob>& job, int lane);
+    void finish(const std::shared_ptr<AsyncGemmJob>& job);
+
+    std::vector<Lane> lanes_;
+
+    std::mutex mutex_;                    // Guards everything below and the job states
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    std::deque<std::shared_ptr<AsyncGemmJob>> ready_;   // Products whose inputs are done
+    std::deque<std::shared_ptr<AsyncGemmJob>> packing_; // Early B packing, when no product is ready
+    std::vector<std::shared_ptr<AsyncGemmJob>> unfinished_; // Submitted, not finished
+    bool stop_ = false;
+};
+
+// Submits to GemmScheduler::global()
+GemmFuture matmul_async(const GemmOp& op, const std::vector<GemmFuture>& after = {});
+GemmFuture matmul_async(const float* A, int lda, const float* B, int ldb, float* C, int ldc, int m, int n, int p,
+                        const std::vector<GemmFuture>& after = {});
+
+// Tight row-major Matrix operands (the Matrix objects must outlive the future)
+GemmFuture matmul_async(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p,
+                        const std::vector<GemmFuture>& after = {});
+
+#endif // MATMUL_ASYNC_H
@@ -0,0 +1,83 @@
+#ifndef MATMUL_AUTO_H
+#define MATMUL_AUTO_H
+
+#include "matrix_utils.h"
+#include <string>
+
+// Shape-aware dispatch
+// matmul_auto picks the kernel and the number of threads for each call, so call
+// sites do not have to choose between the implementations. The shape is put in
+// one of five classes:
+//   Tiny   - the whole product is a few hundred KFLOPs: the unpacked small
+//            kernel on one thread (packing and thread start-up cost more), or
+//            the kernel compiled for the shape (matmul_fixed.h) if there is one.
+//   Skinny - m or p is at most skinny_max_dim (GEMV-like): the bandwidth-bound
+//            skinny kernels of skinny_gemm.h.
+//   Small  - packed SGEMM on fewer threads than the machine has, one thread per
+//            flops_per_thread of work.
+//   Large  - packed SGEMM on all threads.
+//   Huge   - all dimensions at least huge_min_dim: Strassen (parallel), when the
+//            calibration measured it to be faster on this machine.
+// The thresholds are a cost model whose constants come from a calibration run
+// (benchmark_runner --calibrate-dispatch writes them to a profile that is loaded
+// at startup, like the blocking profile of tuning.h).
+
+enum class ShapeClass {
+    Tiny,
+    Skinny,
+    Small,
+    Large,
+    Huge
+};
+
+const char* shape_class_name(ShapeClass shape);
+
+struct DispatchParams {
+    double tiny_max_flops;   // Up to this many FLOPs (2mnp): small kernel, one thread
+    double flops_per_thread; // Work per thread below which another thread does not pay off
+    int skinny_max_dim;      // min(m, p) up to this: Skinny
+    int huge_min_dim;        // min(m, n, p) from this: Huge (0 = never use Strassen)
+};
+
+// What matmul_auto will do for a shape
+struct DispatchPlan {
+    ShapeClass shape;
+    const char* kernel;      // "fixed", "small", "skinny-m", "skinny-p", "sgemm" or "strassen-parallel"
+    int threads;
+};
+
+// Parameters in use: the dispatch profile (MATMUL_DISPATCH_PROFILE, default
+// "matmul_dispatch.profile" in the working directory) if it exists and was
+// made for the active micro-kernel and thread count, otherwise
+// default_dispatch_params(). Loaded once; reading takes no lock, and a call
+// running while set_dispatch_params replaces them sees the old or the new set.
+DispatchParams dispatch_params();
+void set_dispatch_params(const DispatchParams& params);
+
+// Cost-model defaults for machines without a profile
+DispatchParams default_dispatch_params();
+
+// Measures the crossovers on this machine (short timed runs, a few seconds):
+// small kernel vs packed SGEMM, one thread vs all threads, skinny kernel vs
+// packed SGEMM on m x 2048 x 2048 and Strassen vs packed SGEMM at 2048.
+// Returns the result (it is not applied or saved).
+DispatchParams calibrate_dispatch(bool verbose);
+
+// Profile file: "key=value" lines, tagged with the micro-kernel and thread count
+bool save_dispatch_profile(const std::string& path, const DispatchParams& params);
+bool load_dispatch_profile(const std::string& path, DispatchParams& params);
+std::string dispatch_profile_path();
+
+// Plan for C += A * B with A m x n, B n x p. Inside a parallel region the plan
+// is always single-threaded.
+DispatchPlan plan_matmul(int m, int n, int p);
+
+// C += A * B through the planned kernel
+void matmul_auto(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
+
+// Same on strided row-major views. Huge shapes take the packed SGEMM here
+// (Strassen needs whole matrices), with all threads.
+void matmul_auto_strided(const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                         int m, int n, int p);
+
+#endif // MATMUL_AUTO_H
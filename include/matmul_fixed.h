@@ -0,0 +1,164 @@
+#ifndef MATMUL_FIXED_H
+#define MATMUL_FIXED_H
+
+#include "cpu_dispatch.h"
+#include "matrix_utils.h"
+#include <immintrin.h>
+
+// Fixed-size kernels
+// Small products of a few common sizes (4x4 ... 64x64) are called so often that
+// the per-call cost of the generic kernels shows: std::function dispatch, loops
+// with runtime bounds and tails, shape checks. matmul_fixed<M, N, P> is compiled
+// for one shape: every loop bound is a constant, so the compiler unrolls the
+// loops, keeps the C tile in registers for the whole K loop and folds every
+// address into a constant offset. No checks, no allocation.
+//
+// Layout: tight row-major, A M x N, B N x P, C M x P, and like the other
+// matmul_* kernels it accumulates (C += A * B).
+//
+// Register blocking (AVX2 + FMA, 16 YMM registers): C is cut into column
+// chunks of up to 32 floats (4 YMM) and row blocks of up to 12 / chunk vectors
+// rows, so one block is at most 12 accumulators plus the B row and the A
+// broadcast. P = 4 uses XMM rows instead. Shapes where P is not a multiple of 4
+// take the portable version. The AVX-512 level uses the AVX2 kernels as well
+// (at these sizes the wider registers do not pay for the tails and transitions).
+//
+// matmul_fixed<M, N, P>() picks AVX2 or portable at runtime (active_cpu_isa(),
+// read once); matmul_fixed_avx2 / matmul_fixed_scalar can be called directly.
+
+namespace fixed_detail {
+
+// Accumulators of one block: R rows x V vectors of 8 floats at column j0
+template <int N, int P, int R, int V>
+TARGET_AVX2
+inline void block8(const float* A, const float* B, float* C, int i0, int j0) {
+    __m256 c[R][V];
+    #pragma GCC unroll 16
+    for (int r = 0; r < R; ++r) {
+        #pragma GCC unroll 4
+        for (int v = 0; v < V; ++v) c[r][v] = _mm256_loadu_ps(&C[(i0 + r) * P + j0 + 8 * v]);
+    }
+
+    #pragma GCC unroll 64
+    for (int k = 0; k < N; ++k) {
+        __m256 b[V];
+        #pragma GCC unroll 4
+        for (int v = 0; v < V; ++v) b[v] = _mm256_loadu_ps(&B[k * P + j0 + 8 * v]);
+        #pragma GCC unroll 16
+        for (int r = 0; r < R; ++r) {
+            __m256 a = _mm256_broadcast_ss(&A[(i0 + r) * N + k]);
+            #pragma GCC unroll 4
+            for (int v = 0; v < V; ++v) c[r][v] = _mm256_fmadd_ps(a, b[v], c[r][v]);
+        }
+    }
+
+    #pragma GCC unroll 16
+    for (int r = 0; r < R; ++r) {
+        #pragma GCC unroll 4
+        for (int v = 0; v < V; ++v) _mm256_storeu_ps(&C[(i0 + r) * P + j0 + 8 * v], c[r][v]);
+    }
+}
+
+// Same with one XMM (4 floats) per row, for P = 4
+template <int N, int P, int R>
+TARGET_AVX2
+inline void block4(const float* A, const float* B, float* C, int i0, int j0) {
+    __m128 c[R];
+    #pragma GCC unroll 16
+    for (int r = 0; r < R; ++r) c[r] = _mm_loadu_ps(&C[(i0 + r) * P + j0]);
+
+    #pragma GCC unroll 64
+    for (int k = 0; k < N; ++k) {
+        __m128 b = _mm_loadu_ps(&B[k * P + j0]);
+        #pragma GCC unroll 16
+        for (int r = 0; r < R; ++r) c[r] = _mm_fmadd_ps(_mm_broadcast_ss(&A[(i0 + r) * N + k]), b, c[r]);
+    }
+
+    #pragma GCC unroll 16
+    for (int r = 0; r < R; ++r) _mm_storeu_ps(&C[(i0 + r) * P + j0], c[r]);
+}
+
+// All row blocks of one column chunk: full blocks of RB rows, then the rest
+template <int M, int N, int P, int V, int RB>
+TARGET_AVX2
+inline void column_chunk8(const float* A, const float* B, float* C, int j0) {
+    constexpr int FULL = M / RB * RB;
+    #pragma GCC unroll 16
+    for (int i0 = 0; i0 < FULL; i0 += RB) block8<N, P, RB, V>(A, B, C, i0, j0);
+    if constexpr (M % RB != 0) block8<N, P, M % RB, V>(A, B, C, FULL, j0);
+}
+
+template <int M, int N, int P, int RB>
+TARGET_AVX2
+inline void column_chunk4(const float* A, const float* B, float* C, int j0) {
+    constexpr int FULL = M / RB * RB;
+    #pragma GCC unroll 16
+    for (int i0 = 0; i0 < FULL; i0 += RB) block4<N, P, RB>(A, B, C, i0, j0);
+    if constexpr (M % RB != 0) block4<N, P, M % RB>(A, B, C, FULL, j0);
+}
+
+constexpr int min_int(int a, int b) { return a < b ? a : b; }
+
+} // namespace fixed_detail
+
+// Portable version: the same loops with constant bounds, vectorized by the
+// compiler for the baseline ISA
+template <int M, int N, int P>
+inline void matmul_fixed_scalar(const float* A, const float* B, float* C) {
+    for (int i = 0; i < M; ++i) {
+        for (int k = 0; k < N; ++k) {
+            float a = A[i * N + k];
+            for (int j = 0; j < P; ++j) C[i * P + j] += a * B[k * P + j];
+        }
+    }
+}
+
+template <int M, int N, int P>
+TARGET_AVX2
+inline void matmul_fixed_avx2(const float* A, const float* B, float* C) {
+    using namespace fixed_detail;
+    if constexpr (P % 8 == 0) {
+        constexpr int V = min_int(P / 8, 4);       // YMM per row of a column chunk
+        constexpr int RB = min_int(M, 12 / V);     // Rows per block
+        constexpr int W = 8 * V;
+        constexpr int FULL = P / W * W;
+        #pragma GCC unroll 8
+        for (int j0 = 0; j0 < FULL; j0 += W) column_chunk8<M, N, P, V, RB>(A, B, C, j0);
+        // P = 40, 48, 56: one narrower chunk at the end
+        if constexpr (P % W != 0) column_chunk8<M, N, P, (P % W) / 8, min_int(M, 12 / ((P % W) / 8))>(A, B, C, FULL);
+    } else if constexpr (P % 4 == 0 && P < 8) {
+        column_chunk4<M, N, P, min_int(M, 12)>(A, B, C, 0);
+    } else {
+        matmul_fixed_scalar<M, N, P>(A, B, C);
+    }
+}
+
+inline bool fixed_use_avx2() {
+    static const bool avx2 = active_cpu_isa() >= CpuIsa::AVX2;
+    return avx2;
+}
+
+// C += A * B for compile-time M, N, P
+template <int M, int N, int P>
+inline void matmul_fixed(const float* A, const float* B, float* C) {
+    if (fixed_use_avx2()) {
+        matmul_fixed_avx2<M, N, P>(A, B, C);
+    } else {
+        matmul_fixed_scalar<M, N, P>(A, B, C);
+    }
+}
+
+// Runtime selection
+// The square sizes 4, 8, 16, 32 and 64 are instantiated in matmul_fixed.cpp for
+// every ISA level; fixed_gemm_kernel returns the one for the active ISA, or
+// nullptr for any other shape. Batched GEMM and matmul_auto's Tiny class use
+// these for tight operands.
+using FixedGemmKernel = void (*)(const float* A, const float* B, float* C);
+
+FixedGemmKernel fixed_gemm_kernel(int m, int n, int p);
+
+// Entry for the function table (MatMulFunc): the fixed kernel for the shape,
+// or the unpacked small kernel / packed SGEMM for shapes without one
+void matmul_fixed_dispatch(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
+
+#endif // MATMUL_FIXED_H
@@ -8,10 +8,13 @@
 #include <string>
 #include <functional>
 #include <iomanip>
+#include "aligned_buffer.h"
 
 // Using float for SGEMM (Single Precision General Matrix Multiply)
 // Flattened 1D vector for better cache locality: A[i * cols + j]
-using Matrix = std::vector<float>;
+// Storage is 64-byte aligned (huge pages for large matrices) and not zeroed on
+// resize, see aligned_buffer.h.
+using Matrix = AlignedVector;
 
 struct MatrixDims {
     int rows;
@@ -0,0 +1,92 @@
+#ifndef MIXED_PRECISION_H
+#define MIXED_PRECISION_H
+
+#include "matrix_utils.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Mixed-precision GEMM
+// Large products are memory-bandwidth bound, so storing the operands in 16 or 8
+// bits doubles (quadruples) the effective bandwidth and cache capacity. The
+// kernels keep a wide accumulator:
+// - bf16 / fp16 inputs, fp32 accumulation: the operands are widened to float
+//   while packing and then go through the regular SGEMM driver and micro-kernel,
+//   so the only extra cost is the conversion (F16C / AVX2 where available).
+// - u8 x s8 -> s32: own packing (4 consecutive K values per 32-bit lane) and
+//   micro-kernels on vpdpbusd (AVX-512 VNNI) or vpmaddubsw (AVX2).
+
+// 16-bit floating point storage types (raw bits)
+// bfloat16: float with the low 16 mantissa bits dropped (same range as float,
+//           8 bits of precision).
+// float16:  IEEE 754 binary16 (5-bit exponent, 11 bits of precision, max 65504).
+struct bfloat16 {
+    uint16_t bits;
+};
+
+struct float16 {
+    uint16_t bits;
+};
+
+// Round to nearest even; NaNs stay (quiet) NaNs.
+inline bfloat16 float_to_bf16(float value) {
+    uint32_t u;
+    std::memcpy(&u, &value, sizeof(u));
+    if ((u & 0x7FFFFFFFu) > 0x7F800000u) return bfloat16{(uint16_t)((u >> 16) | 0x40)};
+    u += 0x7FFFu + ((u >> 16) & 1);
+    return bfloat16{(uint16_t)(u >> 16)};
+}
+
+inline float bf16_to_float(bfloat16 value) {
+    uint32_t u = (uint32_t)value.bits << 16;
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// Portable conversions (round to nearest even, overflow to infinity, subnormals kept)
+float16 float_to_fp16(float value);
+float fp16_to_float(float16 value);
+
+template <typename T>
+using AlignedStorage = std::vector<T, AlignedAllocator<T>>;
+
+using BF16Matrix = AlignedStorage<bfloat16>;
+using FP16Matrix = AlignedStorage<float16>;
+using U8Matrix = AlignedStorage<uint8_t>;
+using S8Matrix = AlignedStorage<int8_t>;
+using S32Matrix = AlignedStorage<int32_t>;
+
+// Bulk conversions (vectorized with F16C / AVX2 when the CPU has them). The
+// packing routines use the same functions on each row of a panel.
+void convert_float_to_bf16(const float* src, bfloat16* dst, size_t count);
+void convert_bf16_to_float(const bfloat16* src, float* dst, size_t count);
+void convert_float_to_fp16(const float* src, float16* dst, size_t count);
+void convert_fp16_to_float(const float16* src, float* dst, size_t count);
+
+void to_bf16(const Matrix& src, BF16Matrix& dst);
+void to_fp16(const Matrix& src, FP16Matrix& dst);
+
+// C += A * B, A m x n, B n x p (row-major views with leading dimensions), C in
+// fp32. Uses the packed SGEMM driver, so blocking, threading and the micro-kernel
+// are the same as matmul_optimized_sgemm.
+void matmul_bf16_strided(const bfloat16* A, int lda, const bfloat16* B, int ldb, float* C, int ldc,
+                         int m, int n, int p);
+void matmul_fp16_strided(const float16* A, int lda, const float16* B, int ldb, float* C, int ldc,
+                         int m, int n, int p);
+
+void matmul_bf16(const BF16Matrix& A, const BF16Matrix& B, Matrix& C, int m, int n, int p);
+void matmul_fp16(const FP16Matrix& A, const FP16Matrix& B, Matrix& C, int m, int n, int p);
+
+// Integer GEMM: C += A * B with A unsigned 8-bit, B signed 8-bit, C signed 32-bit
+// (the usual quantized-inference layout: activations u8, weights s8).
+// Exact as long as the s32 sums do not overflow, i.e. for n <= 65793.
+void gemm_u8s8s32_strided(const uint8_t* A, int lda, const int8_t* B, int ldb, int32_t* C, int ldc,
+                          int m, int n, int p);
+
+void matmul_u8s8s32(const U8Matrix& A, const S8Matrix& B, S32Matrix& C, int m, int n, int p);
+
+// Name of the int8 micro-kernel in use, e.g. "avx512vnni-12x32"
+const char* int8_kernel_name();
+
+#endif // MIXED_PRECISION_H
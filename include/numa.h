@@ -0,0 +1,88 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include "matrix_utils.h"
+#include <vector>
+
+// NUMA awareness
+// On multi-socket machines memory is placed on the node of the thread that first
+// writes a page (first touch). If the main thread initializes everything, all of
+// A, B and C end up on node 0 and the threads of the other sockets read them over
+// the interconnect. The NUMA mode therefore:
+// - splits the rows of A and C into one contiguous block per node (numa_plan),
+// - lets the threads of each node first-touch their own block (numa_zeros_matrix,
+//   numa_distribute_rows),
+// - runs one SGEMM team per node on its row block, with the team's threads bound
+//   to the node's CPUs and its own replica of the packed B panels (the panel
+//   buffer belongs to the node's master thread and is packed by the node's
+//   threads, so it is node-local too).
+//
+// The topology comes from /sys/devices/system/node (Linux). MATMUL_NUMA_NODES=k
+// simulates k nodes by splitting the CPUs evenly, so the NUMA code paths can be
+// exercised on a single-node machine.
+
+struct NumaTopology {
+    int num_nodes;
+    std::vector<std::vector<int>> node_cpus; // CPUs of each node
+    bool simulated;                          // From MATMUL_NUMA_NODES, not the hardware
+};
+
+// Detected (or simulated) topology, read once.
+const NumaTopology& numa_topology();
+
+// Work split for one call: threads and [row_begin, row_end) rows of A and C per
+// node. Only nodes that get at least one thread take part, and at most max_nodes
+// of them (0 = all).
+struct NumaPlan {
+    std::vector<int> node;       // Topology node index
+    std::vector<int> threads;    // Threads on that node
+    std::vector<int> row_begin;  // First row owned by that node
+    std::vector<int> row_end;
+};
+
+NumaPlan numa_plan(int rows, int num_threads, int max_nodes = 0);
+
+// Share `index` of `count` of a node's CPUs (node -1: all CPUs of the process),
+// as contiguous groups within the process's affinity mask. With fewer CPUs than
+// shares, CPUs are handed out round-robin (so shares overlap).
+std::vector<int> numa_cpu_share(int node, int index, int count);
+
+// Binds the calling thread to the CPUs of a node for its lifetime and restores
+// the previous affinity afterwards (no-op with a single node or off Linux).
+// The second form binds to an explicit CPU set (no-op if it is empty).
+class NumaThreadBinding {
+public:
+    explicit NumaThreadBinding(int node);
+    explicit NumaThreadBinding(const std::vector<int>& cpus);
+    ~NumaThreadBinding();
+
+    NumaThreadBinding(const NumaThreadBinding&) = delete;
+    NumaThreadBinding& operator=(const NumaThreadBinding&) = delete;
+
+private:
+    void bind(const std::vector<int>& cpus);
+
+    bool active_ = false;
+    alignas(8) unsigned char saved_mask_[128]; // cpu_set_t
+};
+
+// C = 0 (rows x cols), with every row block first-touched by the node that owns
+// it in matmul_sgemm_numa.
+void numa_zeros_matrix(Matrix& mat, int rows, int cols);
+
+// Moves the contents of mat into fresh storage first-touched the same way
+// (e.g. after randomize_matrix on the main thread).
+void numa_distribute_rows(Matrix& mat, int rows, int cols);
+
+// C += A * B with one SGEMM team per node (see above). Use numa_zeros_matrix /
+// numa_distribute_rows on A and C first, otherwise the pages are wherever they
+// were first touched. With more than one node in the plan, the first call raises
+// the OpenMP max-active-levels to 2 for the process (the per-node teams are
+// nested); it is never lowered again.
+void matmul_sgemm_numa(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
+
+// Same with a given plan (numa_plan(m, ...)), e.g. to compare a 1-node plan with
+// the full one. A single-node plan runs the plain SGEMM on its threads.
+void matmul_sgemm_numa_plan(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p, const NumaPlan& plan);
+
+#endif // NUMA_H
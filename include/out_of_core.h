@@ -0,0 +1,111 @@
+#ifndef OUT_OF_CORE_H
+#define OUT_OF_CORE_H
+
+#include "matrix_utils.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Out-of-core GEMM on memory-mapped matrix files
+// For products whose operands do not fit in RAM (e.g. 100k x 100k). A, B and C
+// live in files that are mapped into the address space; the page cache does the
+// I/O, and the streaming driver makes sure the next panels are already being
+// read while the current ones are multiplied (see matmul_streaming).
+//
+// File format: a 64-byte header followed by the matrix in row-major float32
+// (element (i, j) at offset 64 + 4 * (i * cols + j)), native byte order.
+struct MatrixFileHeader {
+    char magic[8];      // "MATF32\0\0"
+    uint64_t rows;
+    uint64_t cols;
+    uint8_t reserved[40];
+};
+
+const size_t MATRIX_FILE_HEADER_BYTES = 64;
+
+// A matrix file mapped into memory. Only available on POSIX systems (mmap);
+// elsewhere open() / create() return false.
+class MappedMatrix {
+public:
+    MappedMatrix() = default;
+    ~MappedMatrix();
+
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+    // New zero-filled file (sparse, nothing is written until it is touched),
+    // mapped read-write. An existing file is replaced.
+    bool create(const std::string& path, long long rows, long long cols);
+    // Existing file; writable = false maps it read-only.
+    bool open(const std::string& path, bool writable);
+    void close();
+
+    bool is_open() const { return data_ != nullptr; }
+    bool writable() const { return writable_; }
+    long long rows() const { return rows_; }
+    long long cols() const { return cols_; }
+    // Row-major, leading dimension cols()
+    float* data() { return data_; }
+    const float* data() const { return data_; }
+
+    // Reads the block rows [row, row + num_rows) x cols [col, col + num_cols)
+    // into the page cache: madvise(MADV_WILLNEED) to start readahead, then
+    // touches every page so the block is resident when this returns. Meant to
+    // run on a background thread while another block is being computed.
+    void prefetch(long long row, long long num_rows, long long col, long long num_cols) const;
+
+    // Starts writing back the dirty pages of rows [row, row + num_rows) without
+    // waiting for the I/O (sync_file_range on Linux, msync(MS_ASYNC) elsewhere).
+    void write_back(long long row, long long num_rows);
+
+    // Waits until everything written so far is on disk.
+    bool sync();
+
+private:
+    int fd_ = -1;
+    void* map_ = nullptr;
+    size_t map_bytes_ = 0;
+    float* data_ = nullptr;
+    long long rows_ = 0;
+    long long cols_ = 0;
+    bool writable_ = false;
+};
+
+// Whole-file helpers for matrices that fit in memory (tests, benchmark setup)
+bool write_matrix_file(const std::string& path, const Matrix& mat, int rows, int cols);
+bool read_matrix_file(const std::string& path, Matrix& mat, int& rows, int& cols);
+
+struct StreamingOptions {
+    // Bytes of operand data kept resident at once (C tile + current and next
+    // A / B panels). 0 = MATMUL_OOC_BUDGET_MB from the environment, or a quarter
+    // of the physical memory.
+    size_t memory_budget = 0;
+    // Read the next panels on a background thread while the current ones are
+    // multiplied. Without it every panel is faulted in by the compute threads.
+    bool prefetch = true;
+};
+
+struct StreamingStats {
+    int tile;               // Tile edge (rows of A / columns of B per block)
+    int depth;              // K depth per panel
+    long long steps;        // Panel pairs multiplied
+    double seconds;         // Total
+    double io_wait_seconds; // Compute stalled waiting for a prefetch to finish
+};
+
+// C += A * B on mapped files (A m x n, B n x p, C m x p). Returns false if the
+// shapes do not match or C is not writable.
+//
+// Loop nest (outer to inner) over T x T tiles of C and T/2-deep K panels:
+//   jc (T columns of B / C) -> ic (T rows of A / C) -> pc (K panels)
+// The C tile stays resident for its whole K loop and is written back once,
+// right after (so C streams to disk incrementally and is never read twice).
+// Each step multiplies an A panel (T x T/2) with a B panel (T/2 x T) through
+// the packed SGEMM driver, which applies its own GotoBLAS blocking inside;
+// meanwhile the next step's panels (and, at a tile boundary, the next C tile)
+// are prefetched. T is the largest multiple of 256 whose C tile plus two pairs
+// of panels (current + next) fit the memory budget: 12 T^2 bytes.
+bool matmul_streaming(const MappedMatrix& A, const MappedMatrix& B, MappedMatrix& C,
+                      const StreamingOptions& options = StreamingOptions(), StreamingStats* stats = nullptr);
+
+#endif // OUT_OF_CORE_H
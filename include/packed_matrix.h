@@ -0,0 +1,85 @@
+#ifndef PACKED_MATRIX_H
+#define PACKED_MATRIX_H
+
+#include "aligned_buffer.h"
+#include "matrix_utils.h"
+#include <algorithm>
+#include <string>
+
+struct SgemmEpilogue;
+
+// Pre-packed B operand
+// When B is reused across many products (model weights: B fixed, A changes per
+// request), packing it on every call is wasted work and memory traffic. A
+// PackedMatrix holds B already in the micro-kernel's panel layout, so the
+// driver skips pack_B and streams the panels straight from it.
+//
+// Layout: for every KC-deep block of rows (the depth blocking at pack time),
+// the columns are cut into NR-wide strips stored one after the other, each
+// kb x NR row-major with the last strip zero-padded. Block k starts at
+// k * padded_cols and a column offset j (a multiple of NR) at j * kb, so any
+// KC x NC panel the driver asks for is one contiguous range laid out exactly as
+// its own packed B buffer.
+//
+// The layout depends on the micro-kernel (NR) and on KC, which are recorded;
+// the driver uses the recorded KC for the product. A matrix packed for another
+// kernel (e.g. loaded from a file written on another machine) is rejected.
+class PackedMatrix {
+public:
+    PackedMatrix() = default;
+
+    // Packs op(B), rows x cols (K x N of the products it will be used in).
+    // transposed = false: B is row-major rows x cols with leading dimension ldb.
+    // transposed = true: B is stored as its transpose (cols x rows, leading
+    // dimension ldb), e.g. weights kept as [out_features][in_features].
+    bool pack(const float* B, int ldb, int rows, int cols, bool transposed = false);
+    bool pack(const Matrix& B, int rows, int cols) { return pack(B.data(), cols, rows, cols); }
+
+    // Serialization: a small header (kernel name, shape, KC / NR) followed by
+    // the packed panels, so prepacked weights can be loaded at startup without
+    // repacking. load() fails on files packed for a different micro-kernel.
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    void clear();
+
+    bool empty() const { return data_.empty(); }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int kc() const { return kc_; }
+    int nr() const { return nr_; }
+    const std::string& kernel() const { return kernel_; }
+    size_t bytes() const { return data_.size() * sizeof(float); }
+
+    // Packed for the micro-kernel currently in use
+    bool matches_kernel() const;
+
+    // Start of the packed strips of depth block k (a multiple of kc()) from column
+    // j (a multiple of nr()) on
+    const float* panel(int k, int j) const {
+        int kb = std::min(kc_, rows_ - k);
+        return data_.data() + (size_t)k * padded_cols() + (size_t)j * kb;
+    }
+
+private:
+    int padded_cols() const { return (cols_ + nr_ - 1) / nr_ * nr_; }
+
+    int rows_ = 0;
+    int cols_ = 0;
+    int kc_ = 0;
+    int nr_ = 0;
+    std::string kernel_;
+    AlignedVector data_;
+};
+
+// C = alpha * op(A) * B + beta * C with B pre-packed (K = B.rows(), N = B.cols()),
+// op(A) m x K. Same conventions as sgemm (row-major, beta = 0 never reads C); an
+// optional epilogue is fused as in sgemm_epilogue. Returns false if B is empty
+// or was packed for another micro-kernel.
+bool sgemm_prepacked(char transA, int m, float alpha, const float* A, int lda, const PackedMatrix& B,
+                     float beta, float* C, int ldc, const SgemmEpilogue* epilogue = nullptr);
+
+// C += A * B, A m x K (leading dimension lda), C m x N (leading dimension ldc)
+bool matmul_prepacked(const float* A, int lda, const PackedMatrix& B, float* C, int ldc, int m);
+
+#endif // PACKED_MATRIX_H
@@ -0,0 +1,74 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <string>
+
+// Hardware performance counters (Linux perf_event_open)
+// Counts user-space events of the whole process: the counters are opened with
+// `inherit`, so threads created AFTER opening (OpenMP team, thread pool) are
+// included. Open them at the start of main, before the first parallel region.
+//
+// Every event is opened on its own, so a missing one (no PMU in a VM, raw FP
+// events on a non-Intel CPU, perf_event_paranoid too strict) only disables that
+// event; off Linux nothing is available and all reads return -1.
+enum class PerfEvent {
+    Cycles = 0,
+    Instructions,
+    L1DMisses,      // L1 data cache read misses
+    LLCMisses,      // Last-level cache read misses
+    DTLBMisses,     // Data TLB read misses
+    FpScalar,       // FP_ARITH_INST_RETIRED.SCALAR_SINGLE (Intel)
+    FpPacked128,    // ... 128B_PACKED_SINGLE (4 floats)
+    FpPacked256,    // ... 256B_PACKED_SINGLE (8 floats)
+    FpPacked512,    // ... 512B_PACKED_SINGLE (16 floats)
+    Count
+};
+
+const char* perf_event_name(PerfEvent event);
+
+struct PerfSample {
+    long long values[(int)PerfEvent::Count]; // -1 = not available
+
+    long long operator[](PerfEvent event) const { return values[(int)event]; }
+    bool has(PerfEvent event) const { return values[(int)event] >= 0; }
+
+    // Floating point operations counted by the FP_ARITH events (an FMA counts
+    // as two), or -1 if they are not available
+    double fp_ops() const;
+};
+
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const;              // At least one event opened
+    bool available(PerfEvent event) const;
+    std::string status() const;          // e.g. "cycles instructions ... (dTLB unavailable)"
+
+    // Counts between start() and stop() (scaled if the kernel multiplexed them)
+    void start();
+    PerfSample stop();
+
+private:
+    int fds_[(int)PerfEvent::Count];
+};
+
+// Derived metrics for one kernel run of `flops` algorithmic operations.
+// Fields are negative when the underlying events are not available.
+struct PerfReport {
+    double ipc;                 // Instructions per cycle
+    double l1d_miss_per_kflop;  // L1D misses per 1000 FLOPs
+    double llc_miss_per_kflop;
+    double dtlb_miss_per_kflop;
+    double fma_utilization;     // FLOPs / (cycles * peak FLOPs per cycle), 0..1
+};
+
+// peak_flops_per_cycle: per core, e.g. 2 FMA units * 2 * 16 lanes = 64 for AVX-512.
+// Cycles are summed over threads, so utilization is per busy core.
+PerfReport make_perf_report(const PerfSample& sample, double flops, double peak_flops_per_cycle);
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,116 @@
+#ifndef SGEMM_H
+#define SGEMM_H
+
+#include <vector>
+
+// Raw-pointer SGEMM entry points
+// The Matrix-based matmul_* functions (see the benchmark harness) assume tight
+// row-major storage. These take plain pointers with leading dimensions instead,
+// so sub-matrices and caller-owned buffers can be used without copying.
+
+// BLAS-compatible SGEMM (row-major):
+//   C = alpha * op(A) * op(B) + beta * C
+// op(X) = X for trans = 'N', X^T for trans = 'T' (or 'C'). op(A) is m x k,
+// op(B) is k x n, C is m x n, and lda/ldb/ldc are row strides of the stored
+// matrices (so A is m x k with lda >= k for 'N', k x m with lda >= m for 'T').
+// Transposes are handled while packing, no copies are made. beta = 0 does not
+// read C at all (C may hold garbage/NaN), so there is no need to zero it first.
+void sgemm(char transA, char transB, int m, int n, int k, float alpha,
+           const float* A, int lda, const float* B, int ldb, float beta, float* C, int ldc);
+
+// Fused epilogue
+// Post-processing that would otherwise be separate passes over C (bias, ReLU /
+// GELU, scaling, conversion to 16-bit) applied by the micro-kernel as it stores
+// the final K block of each tile, while the tile is still in registers:
+//   out[i][j] = scale * activation(alpha * op(A) op(B) + beta * C + row_bias[i] + col_bias[j])
+// Earlier K blocks are stored to C as usual (they are partial sums).
+enum class Activation {
+    None,
+    ReLU,   // max(x, 0)
+    Clamp,  // min(max(x, clamp_min), clamp_max)
+    GELU    // x * sigmoid(2u), u = sqrt(2/pi) (x + 0.044715 x^3) (the tanh form)
+};
+
+enum class EpilogueOutput {
+    Float,
+    BF16,   // bfloat16 (round to nearest even), see mixed_precision.h
+    FP16    // IEEE half
+};
+
+struct SgemmEpilogue {
+    const float* row_bias = nullptr;   // m values, or nullptr
+    const float* col_bias = nullptr;   // n values (columns of C), or nullptr
+    Activation activation = Activation::None;
+    float clamp_min = 0.0f;            // Activation::Clamp
+    float clamp_max = 0.0f;
+    float scale = 1.0f;                // Applied after the activation
+    // Destination. nullptr: the results go to C. Otherwise they are written to
+    // `output` (output_type elements, leading dimension ldo) and C only serves
+    // as the fp32 accumulator of the earlier K blocks, so afterwards it holds
+    // partial sums (or is untouched when K fits one block).
+    void* output = nullptr;
+    EpilogueOutput output_type = EpilogueOutput::Float;
+    int ldo = 0;
+};
+
+// The epilogue for one value of row `row`, column `col` (bias, activation,
+// scale). The micro-kernels compute the same function on vectors.
+float apply_epilogue(float value, const SgemmEpilogue& epilogue, int row, int col);
+
+// sgemm followed by the epilogue, in one pass over C
+void sgemm_epilogue(char transA, char transB, int m, int n, int k, float alpha,
+                    const float* A, int lda, const float* B, int ldb, float beta, float* C, int ldc,
+                    const SgemmEpilogue& epilogue);
+
+// The entry points below follow the matmul_* convention instead: they accumulate,
+// C += A * B, with A m x n, B n x p.
+
+// Packed (GotoBLAS-style) SGEMM on strided row-major views.
+void matmul_optimized_sgemm_strided(const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                                    int m, int n, int p);
+
+// Same, on a team of exactly num_threads threads (also when called from inside a
+// parallel region with nesting enabled), each bound to the CPUs of NUMA node
+// numa_node for the call (-1 = unbound). Building block of matmul_sgemm_numa.
+void matmul_optimized_sgemm_strided_team(const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                                         int m, int n, int p, int num_threads, int numa_node);
+// Same, with every thread of the team bound to the given CPUs (empty = unbound)
+void matmul_optimized_sgemm_strided_team(const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                                         int m, int n, int p, int num_threads, const std::vector<int>& cpus);
+
+// C = epilogue(C + A * B), on tight row-major storage
+void matmul_optimized_sgemm_epilogue(const float* A, const float* B, float* C, int m, int n, int p,
+                                     const SgemmEpilogue& epilogue);
+
+// Phase timing of the packed SGEMM driver
+// When enabled, every call accumulates the time spent packing A, packing B and
+// in the micro-kernels, summed over threads (so with T threads the three can add
+// up to T x wall; the rest is barrier / load-imbalance wait). Meant for profiling
+// (e.g. does packing dominate at small sizes?), off by default.
+struct SgemmPhaseTimes {
+    double pack_a;   // Thread-seconds
+    double pack_b;
+    double compute;
+    double wall;     // Seconds, summed over calls
+    long long calls;
+};
+
+void set_sgemm_phase_timing(bool enabled);
+void reset_sgemm_phase_times();
+SgemmPhaseTimes sgemm_phase_times();
+
+// Batched GEMM
+// Runs `batch` independent products of the same shape, parallelized across the
+// batch (each product runs on a single thread with reused packing buffers).
+// Tiny shapes use the unpacked small-matrix kernel (see SgemmKernel::small).
+
+// Strided batch: item i uses A + i * stride_a, B + i * stride_b, C + i * stride_c,
+// each stored tightly (lda = n, ldb = ldc = p). stride_b = 0 shares one B.
+void matmul_batched_strided(const float* A, long long stride_a, const float* B, long long stride_b,
+                            float* C, long long stride_c, int m, int n, int p, int batch);
+
+// Pointer-array batch: item i uses A[i], B[i], C[i] (tight row-major).
+void matmul_batched(const float* const* A, const float* const* B, float* const* C,
+                    int m, int n, int p, int batch);
+
+#endif // SGEMM_H
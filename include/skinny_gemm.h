@@ -0,0 +1,45 @@
+#ifndef SKINNY_GEMM_H
+#define SKINNY_GEMM_H
+
+// GEMV and skinny GEMM
+// When m or p is tiny (1..16: one request row in decode, a handful of output
+// columns) the product is bound by reading the large operand, not by the FMAs,
+// and the packed SGEMM is a poor fit: it packs whole panels for a single row and
+// pads the register tile to MR / NR. These kernels read the large operand once,
+// straight from memory, with enough independent accumulators to keep the loads
+// flowing, and split the work along the long dimension so every thread streams
+// its own share of the memory bandwidth.
+//
+// Small m (x^T B, a few rows of A): C is cut into column panels that fit in L2
+// and B streams through each panel 16 rows at a time, row by row, so its reads
+// are sequential. Each step updates C in wide strips (128 floats on AVX-512, 32
+// on AVX2), up to 3 rows x the strip in registers. Threads take whole panels.
+// Small p (A x, a few columns of B): every row of C is a set of dot products
+// of a row of A with a column of B. B is copied transposed (p x n, small), then
+// 4 rows of A at a time stream along K against up to 4 (2 on AVX2) columns, with
+// the horizontal sums at the end. Threads take blocks of rows.
+//
+// All entry points accumulate (C += A * B) on row-major views with leading
+// dimensions; A is m x n, B is n x p. Any m / p works, but the kernels only pay
+// off where that dimension is small (see matmul_auto). num_threads = 0 picks the
+// thread count from the bytes streamed (about one thread per MB, one inside a
+// parallel region).
+
+// C += A * B, for small m
+void matmul_skinny_m(const float* A, int lda, const float* B, int ldb, float* C, int ldc, int m, int n, int p,
+                     int num_threads = 0);
+
+// C += A * B, for small p
+void matmul_skinny_p(const float* A, int lda, const float* B, int ldb, float* C, int ldc, int m, int n, int p,
+                     int num_threads = 0);
+
+// y += A x (A m x n, x n, y m)
+void matmul_gemv(const float* A, int lda, const float* x, float* y, int m, int n);
+
+// y += x^T B (x n, B n x p, y p)
+void matmul_gevm(const float* x, const float* B, int ldb, float* y, int n, int p);
+
+// Name of the skinny kernel set in use, e.g. "avx512"
+const char* skinny_kernel_name();
+
+#endif // SKINNY_GEMM_H
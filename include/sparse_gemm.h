@@ -0,0 +1,114 @@
+#ifndef SPARSE_GEMM_H
+#define SPARSE_GEMM_H
+
+#include "aligned_buffer.h"
+#include <vector>
+
+// Sparse x dense GEMM
+// For an A that is mostly zeros (pruned weights, adjacency matrices) the dense
+// kernels spend nearly all their FMAs on zeros. A SparseMatrix stores only the
+// nonzeros and matmul_sparse multiplies it with a dense B:
+//   CSR  - every nonzero with its column, row by row. Per nonzero A[i][k] the
+//          kernel broadcasts it and FMAs row k of B into row i of C (the I-K-J
+//          pattern of matmul_simd, K running over the nonzeros only), with a
+//          strip of C row i in registers across the whole row.
+//   BSR  - 8x8 blocks that contain at least one nonzero, stored densely (the
+//          zeros inside a block are multiplied). No per-element index, and each
+//          B load serves 8 rows of C, so it is faster per stored value than CSR
+//          when the nonzeros come in clusters (block-pruned weights).
+//   Dense - the matrix was not sparse enough: matmul_sparse runs the packed
+//          SGEMM on a dense copy.
+// Work is split between threads on whole rows (block rows for BSR) so that
+// every thread gets about the same number of nonzeros, not the same number of
+// rows (real sparsity patterns are uneven). B is walked in column panels that
+// fit in L2, since the nonzeros of a row read rows of B at random.
+//
+// SparseFormat::Auto picks the format with the lowest estimated cost, in units
+// of one CSR nonzero: CSR costs nnz, BSR bsr_min_fill per stored block entry and
+// dense dense_min_density per entry of A. So dense_min_density is the density
+// where the dense SGEMM (much higher FLOP rate, all FMAs) overtakes CSR,
+// bsr_min_fill the block fill where BSR overtakes CSR, and BSR loses to dense
+// once more than dense_min_density / bsr_min_fill of the blocks are stored.
+
+enum class SparseFormat {
+    Auto,
+    Dense,
+    CSR,
+    BSR
+};
+
+const char* sparse_format_name(SparseFormat format);
+
+struct SparseCrossover {
+    double dense_min_density; // nnz / (rows * cols) where dense beats CSR
+    double bsr_min_fill;      // nnz / (8x8 blocks with a nonzero * 64) where BSR beats CSR
+};
+
+// Defaults measured with the sparse benchmark (2048^3, AVX-512)
+SparseCrossover default_sparse_crossover();
+SparseCrossover sparse_crossover();
+void set_sparse_crossover(const SparseCrossover& crossover);
+
+class SparseMatrix {
+public:
+    static const int BLOCK = 8;   // BSR block size
+
+    SparseMatrix() = default;
+
+    // From a dense row-major rows x cols matrix with leading dimension lda.
+    // Entries with |a| <= drop_tolerance are treated as zeros.
+    bool from_dense(const float* A, int lda, int rows, int cols, SparseFormat format = SparseFormat::Auto,
+                    float drop_tolerance = 0.0f);
+
+    // From CSR arrays (row_ptr: rows + 1 offsets, col_idx / values: row_ptr[rows]
+    // entries, columns within a row ascending). Returns false if they are
+    // inconsistent.
+    bool from_csr(int rows, int cols, const int* row_ptr, const int* col_idx, const float* values,
+                  SparseFormat format = SparseFormat::Auto);
+
+    void clear();
+
+    bool empty() const { return rows_ == 0; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    SparseFormat format() const { return format_; }
+    long long nnz() const { return nnz_; }
+    double density() const { return rows_ ? (double)nnz_ / ((double)rows_ * cols_) : 0.0; }
+    // BSR: share of the stored block entries that are nonzeros (1 for the other formats)
+    double block_fill() const;
+    size_t bytes() const;
+
+    // Storage
+    // CSR:   row_ptr (rows + 1), col_idx = column of each value, values = nonzeros.
+    // BSR:   row_ptr (block rows + 1), col_idx = block column of each block,
+    //        values = BLOCK x BLOCK row-major per block, zero-padded at the edges.
+    // Dense: values = rows x cols row-major, the index arrays are empty.
+    const std::vector<int>& row_ptr() const { return row_ptr_; }
+    const std::vector<int>& col_idx() const { return col_idx_; }
+    const AlignedVector& values() const { return values_; }
+
+private:
+    void set_csr(int rows, int cols, std::vector<int> row_ptr, std::vector<int> col_idx, AlignedVector values);
+    void convert(SparseFormat format);
+    void csr_to_bsr();
+    void csr_to_dense();
+    long long count_blocks() const;
+
+    int rows_ = 0;
+    int cols_ = 0;
+    long long nnz_ = 0;
+    SparseFormat format_ = SparseFormat::CSR;
+    std::vector<int> row_ptr_;
+    std::vector<int> col_idx_;
+    AlignedVector values_;
+};
+
+// C += A * B, A rows x cols sparse, B cols x p (leading dimension ldb), C rows x p
+// (leading dimension ldc). num_threads = 0 picks the count from the work (one
+// inside a parallel region). Returns false for an empty A or bad arguments.
+bool matmul_sparse(const SparseMatrix& A, const float* B, int ldb, float* C, int ldc, int p, int num_threads = 0);
+
+// Name of the sparse kernel set in use, e.g. "avx512"
+const char* sparse_kernel_name();
+
+#endif // SPARSE_GEMM_H
@@ -0,0 +1,69 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool
+// Threads are created once and then reused for every call, so a parallel region
+// costs a wake-up (a few microseconds) instead of thread creation + join.
+//
+// parallel_for(num_tasks, fn) runs fn(0) .. fn(num_tasks - 1) with work stealing:
+// every participating thread starts on its own contiguous range of task indices
+// and, once that is empty, steals single tasks from the back of the others'
+// ranges. So uneven tasks (e.g. the last row of tiles) still balance out.
+// The calling thread participates as well.
+class ThreadPool {
+public:
+    // num_threads includes the calling thread (num_threads - 1 workers are spawned).
+    // pin_threads binds worker i to CPU i (Linux only, ignored elsewhere).
+    explicit ThreadPool(int num_threads, bool pin_threads = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return num_threads_; }
+
+    // Blocks until all tasks are done. max_threads limits how many threads take
+    // part in this call (0 = all). Calls from inside a task run inline.
+    void parallel_for(int num_tasks, const std::function<void(int)>& fn, int max_threads = 0);
+
+    // Process-wide pool with hardware_concurrency() threads.
+    // Set MATMUL_PIN_THREADS=1 to pin its workers to cores.
+    static ThreadPool& global();
+
+private:
+    // [begin, end) of task indices owned by one thread, packed into one atomic
+    // word so the owner (front) and thieves (back) can update it with a CAS.
+    struct alignas(64) TaskRange {
+        std::atomic<uint64_t> bounds{0};
+    };
+
+    void worker_loop(int id);
+    void run_participant(int id);
+    bool pop_front(TaskRange& range, int& task);
+    bool steal_back(TaskRange& range, int& task);
+
+    int num_threads_;
+    std::vector<std::thread> workers_;
+    std::unique_ptr<TaskRange[]> ranges_;
+
+    std::mutex call_mutex_;               // One parallel_for at a time
+    std::mutex mutex_;                    // Guards the job fields below
+    std::condition_variable wake_cv_;
+    std::condition_variable done_cv_;
+    const std::function<void(int)>* job_ = nullptr;
+    int participants_ = 0;
+    uint64_t generation_ = 0;
+    int pending_ = 0;                     // Workers still running the current job
+    bool stop_ = false;
+};
+
+#endif // THREAD_POOL_H
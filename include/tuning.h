@@ -0,0 +1,57 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include <string>
+
+// Cache blocking parameters
+// The packed SGEMM blocks op(A) into MC x KC blocks (kept in L2), op(B) into
+// KC x NC panels (kept in L3), and each KC x NR micro-panel of B should stay in
+// L1 while the micro-kernel streams over A. matmul_tiled uses square
+// TILE x TILE blocks that should fit three at a time in L1.
+// The best values depend on the cache sizes of the machine, so they are loaded at
+// startup instead of being compile-time constants.
+struct BlockingParams {
+    int mc;         // Rows of the packed A block (rounded to MR by the driver)
+    int kc;         // Depth of the packed A block / B panel
+    int nc;         // Columns of the packed B panel (rounded to NR)
+    int tile_block; // BLOCK_SIZE of matmul_tiled
+    int strassen_cutoff; // Strassen recursion stops at this size (MATMUL_STRASSEN_CUTOFF overrides)
+};
+
+// Strassen cutoff without a profile: one Strassen level (7 products of half the
+// size plus 15 additions) against the packed SGEMM rarely pays off below ~1024.
+const int DEFAULT_STRASSEN_CUTOFF = 1024;
+
+// Parameters the kernels use. On first use they are read from the tuning profile
+// (MATMUL_TUNING_PROFILE, default "matmul_tuning.profile" in the working
+// directory) if it exists and was made for the active micro-kernel; otherwise
+// they come from analytical_blocking() on the detected cache sizes.
+BlockingParams blocking_params();
+
+// Overrides the parameters for all following calls. Reading them takes no lock:
+// a kernel running concurrently sees either the old or the new parameters.
+void set_blocking_params(const BlockingParams& params);
+
+// Starting point from the cache model:
+//   KC: one KC x NR micro-panel of B fills half of L1
+//   MC: the MC x KC block of A fills half of L2
+//   NC: the KC x NC panel of B fills half of L3
+//   tile: 3 * tile^2 floats fit in L1
+//   Strassen cutoff: DEFAULT_STRASSEN_CUTOFF
+BlockingParams analytical_blocking();
+
+// Autotune: starts from analytical_blocking() and does a coordinate search
+// (KC, then MC, then NC, each scaled by 1/2 .. 2) with short timed runs of an
+// n x n x n matmul_optimized_sgemm, then picks the fastest tile size for
+// matmul_tiled, and measures the Strassen cutoff with the winning blocking.
+// Returns the winner (it is not applied or saved).
+BlockingParams autotune_blocking(int n, bool verbose);
+
+// Profile file: plain "key=value" lines, tagged with the micro-kernel name.
+bool save_tuning_profile(const std::string& path, const BlockingParams& params);
+bool load_tuning_profile(const std::string& path, BlockingParams& params);
+
+// Path used by blocking_params() at startup
+std::string tuning_profile_path();
+
+#endif // TUNING_H
@@ -0,0 +1,47 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "matrix_utils.h"
+#include <vector>
+
+// Scalable result verification
+// verify_matrix() (absolute 1e-4 against matmul_naive) only works for small
+// sizes: the naive reference is too slow beyond ~512 and float rounding error
+// grows with K. These checks scale to the production sizes instead.
+//
+// Error bound: a float dot product of length K satisfies
+//   |C_ij - fl(C_ij)| <= K * u * (|A| |B|)_ij,   u = 2^-24
+// (the classic worst case; typical errors are ~sqrt(K) u). Checks pass when the
+// error stays below tol_factor times this bound. Strassen-type algorithms only
+// satisfy a normwise version of it; at our recursion cutoffs they still stay
+// well inside it, and tol_factor leaves room for the difference.
+
+constexpr double FLOAT_UNIT_ROUNDOFF = 1.0 / (1 << 24);
+
+struct VerifyReport {
+    bool pass;
+    double max_abs_error;   // max |C - C_ref|
+    double max_rel_error;   // max |C - C_ref| / (|A||B|)_ij, i.e. relative to the error scale
+    double max_ulp_error;   // max |C - C_ref| in float ulps of (|A||B|)_ij (ulps of C_ref itself
+                            // are meaningless where the sum cancels to ~0)
+    double worst_ratio;     // max error / allowed error (pass <=> <= 1)
+};
+
+// Blocked, multithreaded reference in double precision. Also returns |A| |B|
+// (the error scale of every element) from the same pass.
+void reference_matmul(const Matrix& A, const Matrix& B, int m, int n, int p,
+                      std::vector<double>& C_ref, std::vector<double>& abs_ref);
+
+// Element-wise check of C (m x p, from a K = n product) against the reference.
+VerifyReport verify_against_reference(const std::vector<double>& C_ref, const std::vector<double>& abs_ref,
+                                      const Matrix& C, int m, int n, int p, double tol_factor = 2.0);
+
+// Freivalds' check in O(trials * (mn + np + mp)): for random +-1 vectors r,
+// compare A (B r) with C r (in double). A wrong C is caught with probability
+// >= 1 - 2^-trials, as long as the error in a row exceeds the rounding noise of
+// that row (so it finds wrong blocks / edge tiles, not single-ulp differences).
+// max_ulp_error is not computed (no element-wise reference).
+VerifyReport verify_freivalds(const Matrix& A, const Matrix& B, const Matrix& C, int m, int n, int p,
+                              int trials = 2, double tol_factor = 2.0);
+
+#endif // VERIFY_H
@@ -0,0 +1,95 @@
+#include "../include/aligned_buffer.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+static std::atomic<int> g_huge_pages{-1}; // -1 = not decided yet
+
+bool huge_pages_enabled() {
+    int state = g_huge_pages.load(std::memory_order_relaxed);
+    if (state < 0) {
+        const char* env = std::getenv("MATMUL_HUGE_PAGES");
+        state = (env && std::strcmp(env, "0") == 0) ? 0 : 1;
+        g_huge_pages.store(state, std::memory_order_relaxed);
+    }
+    return state != 0;
+}
+
+void set_huge_pages_enabled(bool enabled) {
+    g_huge_pages.store(enabled ? 1 : 0, std::memory_order_relaxed);
+}
+
+void* aligned_alloc_bytes(size_t bytes) {
+    if (bytes == 0) bytes = CACHE_LINE_ALIGNMENT;
+    bool huge = huge_pages_enabled() && bytes >= HUGE_PAGE_THRESHOLD;
+    size_t alignment = huge ? HUGE_PAGE_SIZE : CACHE_LINE_ALIGNMENT;
+
+#if defined(_WIN32)
+    // No transparent huge pages on Windows (large pages need a privilege), so
+    // only the alignment applies.
+    void* ptr = _aligned_malloc(bytes, alignment);
+    if (!ptr) throw std::bad_alloc();
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, bytes) != 0) throw std::bad_alloc();
+#if defined(MADV_HUGEPAGE)
+    // Only a hint: if THP is disabled system-wide this fails and we keep 4K pages.
+    if (huge) madvise(ptr, bytes / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE, MADV_HUGEPAGE);
+#endif
+#endif
+    return ptr;
+}
+
+void aligned_free_bytes(void* ptr) {
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+// One grow-only buffer per slot and thread
+struct PackingBufferPool {
+    float* buffers[2] = {nullptr, nullptr};
+    size_t capacity[2] = {0, 0};
+
+    ~PackingBufferPool() {
+        release();
+    }
+
+    float* get(PackSlot slot, size_t count) {
+        int s = (int)slot;
+        if (capacity[s] < count) {
+            aligned_free_bytes(buffers[s]);
+            buffers[s] = nullptr;
+            capacity[s] = 0;
+            buffers[s] = static_cast<float*>(aligned_alloc_bytes(count * sizeof(float)));
+            capacity[s] = count;
+        }
+        return buffers[s];
+    }
+
+    void release() {
+        for (int s = 0; s < 2; ++s) {
+            aligned_free_bytes(buffers[s]);
+            buffers[s] = nullptr;
+            capacity[s] = 0;
+        }
+    }
+};
+
+static thread_local PackingBufferPool t_pool;
+
+float* packing_buffer(PackSlot slot, size_t count) {
+    return t_pool.get(slot, count);
+}
+
+void release_packing_buffers() {
+    t_pool.release();
+}
@@ -0,0 +1,65 @@
+#include "../include/sgemm.h"
+#include "../include/cpu_dispatch.h"
+#include "../include/matmul_fixed.h"
+#include <omp.h>
+#include <algorithm>
+
+// Batched GEMM
+// Thousands of small products per step: per-call overhead (dispatch, packing
+// buffer allocation, thread fork/join) would dominate if each one went through
+// matmul_optimized_sgemm on its own. Instead:
+// - One parallel region for the whole batch, one product per thread at a time.
+//   Dynamic scheduling in chunks keeps threads balanced without per-item overhead.
+// - Tiny shapes go straight to the unpacked small kernel (no packing at all),
+//   or to the kernel compiled for the shape when there is one (matmul_fixed.h).
+// - Larger shapes use the packed SGEMM, which runs single-threaded inside the
+//   region and reuses its thread_local packing buffers across the batch.
+
+// Largest dimension that still takes the small kernel. Above this, B (n x p) no
+// longer fits in L1 and packing pays for itself.
+const int SMALL_GEMM_MAX_DIM = 64;
+
+static void gemm_one(const SgemmKernel& kern, FixedGemmKernel fixed, const float* A, const float* B, float* C,
+                     int m, int n, int p) {
+    if (fixed) {
+        fixed(A, B, C);
+    } else if (m <= SMALL_GEMM_MAX_DIM && n <= SMALL_GEMM_MAX_DIM && p <= SMALL_GEMM_MAX_DIM) {
+        kern.small(m, n, p, A, n, B, p, C, p);
+    } else {
+        matmul_optimized_sgemm_strided(A, n, B, p, C, p, m, n, p);
+    }
+}
+
+// Enough items per chunk that scheduling overhead stays small next to the math
+static int batch_chunk(int m, int n, int p) {
+    double flops = 2.0 * m * n * p;
+    return std::max(1, (int)(1e5 / flops));
+}
+
+void matmul_batched_strided(const float* A, long long stride_a, const float* B, long long stride_b,
+                            float* C, long long stride_c, int m, int n, int p, int batch) {
+    if (batch <= 0 || m <= 0 || n <= 0 || p <= 0) return;
+
+    const SgemmKernel& kern = sgemm_kernel();
+    FixedGemmKernel fixed = fixed_gemm_kernel(m, n, p);
+    int chunk = batch_chunk(m, n, p);
+
+    #pragma omp parallel for schedule(dynamic, chunk) if(batch > 1)
+    for (int b = 0; b < batch; ++b) {
+        gemm_one(kern, fixed, A + b * stride_a, B + b * stride_b, C + b * stride_c, m, n, p);
+    }
+}
+
+void matmul_batched(const float* const* A, const float* const* B, float* const* C,
+                    int m, int n, int p, int batch) {
+    if (batch <= 0 || m <= 0 || n <= 0 || p <= 0) return;
+
+    const SgemmKernel& kern = sgemm_kernel();
+    FixedGemmKernel fixed = fixed_gemm_kernel(m, n, p);
+    int chunk = batch_chunk(m, n, p);
+
+    #pragma omp parallel for schedule(dynamic, chunk) if(batch > 1)
+    for (int b = 0; b < batch; ++b) {
+        gemm_one(kern, fixed, A[b], B[b], C[b], m, n, p);
+    }
+}
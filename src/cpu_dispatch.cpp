@@ -0,0 +1,212 @@
+#include "../include/cpu_dispatch.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+// CPUID feature detection
+// A feature is only usable if the CPU has it AND the OS saves the wider register
+// state on context switch (OSXSAVE + XCR0 bits), so we check both.
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+static void cpuid(unsigned leaf, unsigned sub, unsigned regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)sub);
+    for (int i = 0; i < 4; ++i) regs[i] = (unsigned)r[i];
+#else
+    __cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t xgetbv0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+static CpuIsa detect_from_cpuid() {
+    unsigned r[4];
+    cpuid(0, 0, r);
+    unsigned max_leaf = r[0];
+    if (max_leaf < 7) return CpuIsa::Scalar;
+
+    cpuid(1, 0, r);
+    bool osxsave = (r[2] >> 27) & 1;
+    bool fma = (r[2] >> 12) & 1;
+    bool avx = (r[2] >> 28) & 1;
+    if (!osxsave || !avx) return CpuIsa::Scalar;
+
+    uint64_t xcr0 = xgetbv0();
+    bool os_ymm = (xcr0 & 0x6) == 0x6;    // XMM + YMM state
+    bool os_zmm = (xcr0 & 0xE6) == 0xE6;  // + opmask, ZMM_Hi256, Hi16_ZMM state
+
+    cpuid(7, 0, r);
+    bool avx2 = (r[1] >> 5) & 1;
+    bool avx512f = (r[1] >> 16) & 1;
+
+    if (avx512f && os_zmm) return CpuIsa::AVX512;
+    if (avx2 && fma && os_ymm) return CpuIsa::AVX2;
+    return CpuIsa::Scalar;
+}
+
+static CpuFeatures features_from_cpuid() {
+    CpuFeatures features = {false, false, false};
+    unsigned r[4];
+    cpuid(0, 0, r);
+    if (r[0] < 7) return features;
+    cpuid(1, 0, r);
+    features.f16c = (r[2] >> 29) & 1;
+    cpuid(7, 0, r);
+    features.avx512bw = (r[1] >> 30) & 1;
+    features.avx512vnni = (r[2] >> 11) & 1;
+    return features;
+}
+
+// CPUID leaf 4: one sub-leaf per cache, until the type field reads 0
+static void caches_from_cpuid(CacheSizes& sizes) {
+    unsigned r[4];
+    cpuid(0, 0, r);
+    if (r[0] < 4) return;
+
+    for (unsigned sub = 0; sub < 16; ++sub) {
+        cpuid(4, sub, r);
+        unsigned type = r[0] & 0x1F; // 1 = data, 2 = instruction, 3 = unified
+        if (type == 0) break;
+        if (type == 2) continue;
+        unsigned level = (r[0] >> 5) & 0x7;
+        long ways = ((r[1] >> 22) & 0x3FF) + 1;
+        long partitions = ((r[1] >> 12) & 0x3FF) + 1;
+        long line = (r[1] & 0xFFF) + 1;
+        long sets = (long)r[2] + 1;
+        long size = ways * partitions * line * sets;
+        if (level == 1) sizes.l1d = size;
+        else if (level == 2) sizes.l2 = size;
+        else if (level == 3) sizes.l3 = size;
+    }
+}
+#else
+static CpuIsa detect_from_cpuid() {
+    return CpuIsa::Scalar;
+}
+
+static CpuFeatures features_from_cpuid() {
+    return CpuFeatures{false, false, false};
+}
+
+static void caches_from_cpuid(CacheSizes&) {}
+#endif
+
+CpuIsa detect_cpu_isa() {
+    static const CpuIsa isa = detect_from_cpuid();
+    return isa;
+}
+
+static CpuIsa select_isa() {
+    CpuIsa best = detect_cpu_isa();
+    const char* env = std::getenv("MATMUL_ISA");
+    if (!env) return best;
+
+    CpuIsa requested = best;
+    if (std::strcmp(env, "scalar") == 0) requested = CpuIsa::Scalar;
+    else if (std::strcmp(env, "avx2") == 0) requested = CpuIsa::AVX2;
+    else if (std::strcmp(env, "avx512") == 0) requested = CpuIsa::AVX512;
+
+    // Never go above what the hardware can run
+    return (requested < best) ? requested : best;
+}
+
+CpuIsa active_cpu_isa() {
+    static const CpuIsa isa = select_isa();
+    return isa;
+}
+
+const CpuFeatures& cpu_features() {
+    static const CpuFeatures features = [] {
+        // The OS-support checks of the ISA level cover these as well (same register state)
+        CpuFeatures f = features_from_cpuid();
+        CpuIsa isa = active_cpu_isa();
+        f.f16c = f.f16c && isa >= CpuIsa::AVX2;
+        f.avx512bw = f.avx512bw && isa >= CpuIsa::AVX512;
+        f.avx512vnni = f.avx512vnni && f.avx512bw && isa >= CpuIsa::AVX512;
+        return f;
+    }();
+    return features;
+}
+
+// sysfs: /sys/devices/system/cpu/cpu0/cache/indexN/{level,type,size}, size like "48K"
+static bool caches_from_sysfs(CacheSizes& sizes) {
+    bool found = false;
+    for (int index = 0; index < 8; ++index) {
+        std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+        int level = 0;
+        char type[32] = {0};
+        char size_str[32] = {0};
+
+        FILE* f = std::fopen((dir + "level").c_str(), "r");
+        if (!f) break;
+        int ok = std::fscanf(f, "%d", &level);
+        std::fclose(f);
+        if (ok != 1) continue;
+
+        f = std::fopen((dir + "type").c_str(), "r");
+        if (!f) continue;
+        ok = std::fscanf(f, "%31s", type);
+        std::fclose(f);
+        if (ok != 1 || std::strcmp(type, "Instruction") == 0) continue;
+
+        f = std::fopen((dir + "size").c_str(), "r");
+        if (!f) continue;
+        ok = std::fscanf(f, "%31s", size_str);
+        std::fclose(f);
+        if (ok != 1) continue;
+
+        char* unit = nullptr;
+        long size = std::strtol(size_str, &unit, 10);
+        if (unit && (*unit == 'K' || *unit == 'k')) size *= 1024;
+        else if (unit && (*unit == 'M' || *unit == 'm')) size *= 1024 * 1024;
+        if (size <= 0) continue;
+
+        if (level == 1) sizes.l1d = size;
+        else if (level == 2) sizes.l2 = size;
+        else if (level == 3) sizes.l3 = size;
+        found = true;
+    }
+    return found;
+}
+
+CacheSizes detect_cache_sizes() {
+    static const CacheSizes sizes = [] {
+        CacheSizes s = {0, 0, 0};
+        if (!caches_from_sysfs(s)) caches_from_cpuid(s);
+        if (s.l1d <= 0) s.l1d = 32 * 1024;
+        if (s.l2 <= 0) s.l2 = 256 * 1024;
+        if (s.l3 <= 0) s.l3 = 8 * 1024 * 1024;
+        return s;
+    }();
+    return sizes;
+}
+
+const char* cpu_isa_name(CpuIsa isa) {
+    switch (isa) {
+        case CpuIsa::AVX512: return "avx512";
+        case CpuIsa::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+const SgemmKernel& sgemm_kernel() {
+    static const SgemmKernel& kernel = sgemm_kernel_for(active_cpu_isa());
+    return kernel;
+}
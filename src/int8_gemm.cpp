@@ -0,0 +1,310 @@
+#include "../include/mixed_precision.h"
+#include "../include/cpu_dispatch.h"
+#include "../include/tuning.h"
+#include <immintrin.h>
+#include <omp.h>
+#include <algorithm>
+#include <cstring>
+
+// Integer GEMM: C (s32) += A (u8) * B (s8)
+// Same structure as the SGEMM driver in optimized_sgemm.cpp (GotoBLAS loop nest,
+// packed A block per thread, shared packed B panel, MR x NR micro-kernel chosen
+// at runtime), but K is consumed in groups of 4: the integer dot-product
+// instructions multiply 4 consecutive u8 x s8 pairs and add them into one s32 lane.
+//
+// Packed layouts (K zero-padded to a multiple of 4, rows/columns to MR/NR):
+// - A panel: A_packed[(g * MR + i) * 4 + t] = A[i][4g + t], so the 4 bytes of
+//   row i in group g are one 32-bit word that the kernel broadcasts.
+// - B panel: B_packed[(g * NR + j) * 4 + t] = B[4g + t][j], so one vector load
+//   holds the 4 K values of NR / 4 (AVX2: 8) consecutive columns.
+
+// Micro-kernel: C[0:mr, 0:nr] += A_panel * B_panel over kq groups of 4.
+// a_high: some packed A value is >= 128 (see the AVX2 kernel).
+using Int8MicroKernel = void (*)(int kq, const uint8_t* A, const int8_t* B, int32_t* C, int ldc, int mr, int nr,
+                                 bool a_high);
+
+struct Int8GemmKernel {
+    const char* name;
+    int mr;
+    int nr;
+    Int8MicroKernel kernel;
+};
+
+// Adds the valid mr x nr corner of a full MR x NR tile (border tiles)
+static void add_tile(const int32_t* tile, int NR, int32_t* C, int ldc, int mr, int nr) {
+    for (int i = 0; i < mr; ++i) {
+        for (int j = 0; j < nr; ++j) {
+            C[i * ldc + j] += tile[i * NR + j];
+        }
+    }
+}
+
+// Portable micro-kernel: 4x8
+static void int8_kernel_4x8_scalar(int kq, const uint8_t* A, const int8_t* B, int32_t* C, int ldc, int mr, int nr,
+                                   bool) {
+    const int MR = 4, NR = 8;
+    int32_t c[MR * NR] = {};
+
+    for (int g = 0; g < kq; ++g) {
+        for (int i = 0; i < MR; ++i) {
+            const uint8_t* a = &A[(g * MR + i) * 4];
+            for (int j = 0; j < NR; ++j) {
+                const int8_t* b = &B[(g * NR + j) * 4];
+                c[i * NR + j] += a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+            }
+        }
+    }
+    add_tile(c, NR, C, ldc, mr, nr);
+}
+
+// AVX2 micro-kernel: 4x16 (8 YMM accumulators, 2 YMM of B per group)
+// vpmaddubsw multiplies u8 x s8 pairs and adds adjacent products into a
+// SATURATED s16: 2 * 255 * -128 does not fit. Values below 128 are safe
+// (|2 * 127 * -128| < 32768), so for blocks with a high bit set we split
+// a = (a & 0x7F) + 128 * (a >> 7) and run both halves through vpmaddubsw (the
+// second one scaled by 128 in vpmaddwd). Blocks of 7-bit data (a common
+// quantization choice) take the single-instruction path.
+TARGET_AVX2
+static void int8_kernel_4x16_avx2(int kq, const uint8_t* A, const int8_t* B, int32_t* C, int ldc, int mr, int nr,
+                                  bool a_high) {
+    const int MR = 4, NR = 16;
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i scale_high = _mm256_set1_epi16(128);
+    const __m256i low7 = _mm256_set1_epi8(0x7F);
+    const __m256i bit0 = _mm256_set1_epi8(1);
+
+    __m256i c[MR][2];
+    for (int i = 0; i < MR; ++i) c[i][0] = c[i][1] = _mm256_setzero_si256();
+
+    if (!a_high) {
+        for (int g = 0; g < kq; ++g) {
+            __m256i b0 = _mm256_loadu_si256((const __m256i*)&B[g * NR * 4]);
+            __m256i b1 = _mm256_loadu_si256((const __m256i*)&B[g * NR * 4 + 32]);
+            for (int i = 0; i < MR; ++i) {
+                int32_t word;
+                std::memcpy(&word, &A[(g * MR + i) * 4], 4);
+                __m256i a = _mm256_set1_epi32(word);
+                c[i][0] = _mm256_add_epi32(c[i][0], _mm256_madd_epi16(_mm256_maddubs_epi16(a, b0), ones));
+                c[i][1] = _mm256_add_epi32(c[i][1], _mm256_madd_epi16(_mm256_maddubs_epi16(a, b1), ones));
+            }
+        }
+    } else {
+        for (int g = 0; g < kq; ++g) {
+            __m256i b0 = _mm256_loadu_si256((const __m256i*)&B[g * NR * 4]);
+            __m256i b1 = _mm256_loadu_si256((const __m256i*)&B[g * NR * 4 + 32]);
+            for (int i = 0; i < MR; ++i) {
+                int32_t word;
+                std::memcpy(&word, &A[(g * MR + i) * 4], 4);
+                __m256i a = _mm256_set1_epi32(word);
+                __m256i lo = _mm256_and_si256(a, low7);
+                // Top bit of every byte -> bit 0 of that byte (16-bit shift, then mask)
+                __m256i hi = _mm256_and_si256(_mm256_srli_epi16(a, 7), bit0);
+                __m256i s0 = _mm256_add_epi32(_mm256_madd_epi16(_mm256_maddubs_epi16(lo, b0), ones),
+                                              _mm256_madd_epi16(_mm256_maddubs_epi16(hi, b0), scale_high));
+                __m256i s1 = _mm256_add_epi32(_mm256_madd_epi16(_mm256_maddubs_epi16(lo, b1), ones),
+                                              _mm256_madd_epi16(_mm256_maddubs_epi16(hi, b1), scale_high));
+                c[i][0] = _mm256_add_epi32(c[i][0], s0);
+                c[i][1] = _mm256_add_epi32(c[i][1], s1);
+            }
+        }
+    }
+
+    if (mr == MR && nr == NR) {
+        for (int i = 0; i < MR; ++i) {
+            __m256i* row = (__m256i*)&C[i * ldc];
+            _mm256_storeu_si256(row, _mm256_add_epi32(_mm256_loadu_si256(row), c[i][0]));
+            _mm256_storeu_si256(row + 1, _mm256_add_epi32(_mm256_loadu_si256(row + 1), c[i][1]));
+        }
+        return;
+    }
+    alignas(32) int32_t tile[MR * NR];
+    for (int i = 0; i < MR; ++i) {
+        _mm256_store_si256((__m256i*)&tile[i * NR], c[i][0]);
+        _mm256_store_si256((__m256i*)&tile[i * NR + 8], c[i][1]);
+    }
+    add_tile(tile, NR, C, ldc, mr, nr);
+}
+
+// AVX-512 VNNI micro-kernel: 12x32 (24 ZMM accumulators, like the SGEMM
+// kernel). vpdpbusd adds the four u8 x s8 products straight into s32, with no
+// intermediate saturation, so a_high needs no special case.
+TARGET_AVX512_VNNI
+static void int8_kernel_12x32_vnni(int kq, const uint8_t* A, const int8_t* B, int32_t* C, int ldc, int mr, int nr,
+                                   bool) {
+    const int MR = 12, NR = 32;
+    __m512i c[MR][2];
+    for (int i = 0; i < MR; ++i) c[i][0] = c[i][1] = _mm512_setzero_si512();
+
+    for (int g = 0; g < kq; ++g) {
+        __m512i b0 = _mm512_loadu_si512(&B[g * NR * 4]);
+        __m512i b1 = _mm512_loadu_si512(&B[g * NR * 4 + 64]);
+        for (int i = 0; i < MR; ++i) {
+            int32_t word;
+            std::memcpy(&word, &A[(g * MR + i) * 4], 4);
+            __m512i a = _mm512_set1_epi32(word);
+            c[i][0] = _mm512_dpbusd_epi32(c[i][0], a, b0);
+            c[i][1] = _mm512_dpbusd_epi32(c[i][1], a, b1);
+        }
+    }
+
+    if (mr == MR && nr == NR) {
+        for (int i = 0; i < MR; ++i) {
+            int32_t* row = &C[i * ldc];
+            _mm512_storeu_si512(row, _mm512_add_epi32(_mm512_loadu_si512(row), c[i][0]));
+            _mm512_storeu_si512(row + 16, _mm512_add_epi32(_mm512_loadu_si512(row + 16), c[i][1]));
+        }
+        return;
+    }
+    alignas(64) int32_t tile[MR * NR];
+    for (int i = 0; i < MR; ++i) {
+        _mm512_store_si512(&tile[i * NR], c[i][0]);
+        _mm512_store_si512(&tile[i * NR + 16], c[i][1]);
+    }
+    add_tile(tile, NR, C, ldc, mr, nr);
+}
+
+static const Int8GemmKernel& int8_kernel() {
+    static const Int8GemmKernel kernels[] = {
+        {"scalar-4x8", 4, 8, int8_kernel_4x8_scalar},
+        {"avx2-4x16", 4, 16, int8_kernel_4x16_avx2},
+        {"avx512vnni-12x32", 12, 32, int8_kernel_12x32_vnni},
+    };
+    // AVX-512 without VNNI has no faster s8 dot product than AVX2's
+    static const Int8GemmKernel& kernel = cpu_features().avx512vnni ? kernels[2]
+                                        : active_cpu_isa() >= CpuIsa::AVX2 ? kernels[1]
+                                        : kernels[0];
+    return kernel;
+}
+
+const char* int8_kernel_name() {
+    return int8_kernel().name;
+}
+
+// Packs mr rows x k of A (zero-padded to MR x 4*ceil(k/4)). Returns whether any
+// value is >= 128, which selects the split path of the AVX2 kernel.
+static bool pack_A_u8(int k, const uint8_t* A, int lda, uint8_t* A_packed, int mr, int MR) {
+    int kq = (k + 3) / 4;
+    uint8_t any = 0;
+    int g = 0;
+    if (mr == MR) {
+        // Whole groups of a full panel: one 4-byte copy per row and group
+        for (; g < k / 4; ++g) {
+            for (int i = 0; i < MR; ++i) {
+                const uint8_t* src = &A[(long long)i * lda + g * 4];
+                uint8_t* dst = &A_packed[(g * MR + i) * 4];
+                std::memcpy(dst, src, 4);
+                any |= src[0] | src[1] | src[2] | src[3];
+            }
+        }
+    }
+    for (; g < kq; ++g) {
+        for (int i = 0; i < MR; ++i) {
+            uint8_t* dst = &A_packed[(g * MR + i) * 4];
+            for (int t = 0; t < 4; ++t) {
+                int p = g * 4 + t;
+                uint8_t v = (i < mr && p < k) ? A[(long long)i * lda + p] : 0;
+                dst[t] = v;
+                any |= v;
+            }
+        }
+    }
+    return (any & 0x80) != 0;
+}
+
+static void pack_B_s8(int k, const int8_t* B, int ldb, int8_t* B_packed, int nr, int NR) {
+    int kq = (k + 3) / 4;
+    for (int g = 0; g < kq; ++g) {
+        for (int t = 0; t < 4; ++t) {
+            int p = g * 4 + t;
+            const int8_t* b_row = (p < k) ? &B[(long long)p * ldb] : nullptr;
+            for (int j = 0; j < NR; ++j) {
+                B_packed[(g * NR + j) * 4 + t] = (b_row && j < nr) ? b_row[j] : 0;
+            }
+        }
+    }
+}
+
+// Driver: loop nest jc (NC) -> pc (KC) -> ic (MC) -> jr (NR) -> ir (MR), with the
+// work split over (ic block, jr range) items as in sgemm_driver. The blocking is
+// the tuned float blocking with KC scaled by 4: at 1 byte per element the packed
+// panels then take the same cache footprint as the float ones.
+void gemm_u8s8s32_strided(const uint8_t* A, int lda, const int8_t* B, int ldb, int32_t* C, int ldc,
+                          int m, int n, int p) {
+    if (m <= 0 || n <= 0 || p <= 0) return;
+
+    const Int8GemmKernel& kern = int8_kernel();
+    const int MR = kern.mr;
+    const int NR = kern.nr;
+
+    const BlockingParams blocking = blocking_params();
+    const int MC = std::max(MR, blocking.mc / MR * MR);
+    const int KC = std::max(4, blocking.kc * 4);
+    const int NC = std::max(NR, blocking.nc / NR * NR);
+
+    int num_threads = omp_in_parallel() ? 1 : omp_get_max_threads();
+    int rows_per_thread = (m + num_threads - 1) / num_threads;
+    int mc = std::min(MC, std::max(MR, (rows_per_thread + MR - 1) / MR * MR));
+    int num_ic = (m + mc - 1) / mc;
+    int num_jr = std::max(1, std::min(num_threads / num_ic, NC / NR));
+
+    // The pooled packing buffers are counted in floats (4 bytes)
+    int8_t* B_packed = (int8_t*)packing_buffer(PackSlot::B, ((size_t)KC * NC + 3) / 4);
+
+    #pragma omp parallel num_threads(num_threads) if(num_threads > 1)
+    {
+        uint8_t* A_packed = (uint8_t*)packing_buffer(PackSlot::A, ((size_t)mc * KC + 3) / 4);
+
+        for (int j = 0; j < p; j += NC) {
+            int jb = std::min(NC, p - j);
+            int num_strips = (jb + NR - 1) / NR;
+
+            for (int k = 0; k < n; k += KC) {
+                int kb = std::min(KC, n - k);
+                int kq = (kb + 3) / 4;
+
+                // Pack B cooperatively; the implicit barrier completes the panel.
+                #pragma omp for schedule(static)
+                for (int s = 0; s < num_strips; ++s) {
+                    int nr = std::min(NR, jb - s * NR);
+                    pack_B_s8(kb, &B[(long long)k * ldb + j + s * NR], ldb, &B_packed[(size_t)s * NR * kq * 4], nr, NR);
+                }
+
+                int strips_per_jr = (num_strips + num_jr - 1) / num_jr;
+
+                #pragma omp for collapse(2) schedule(dynamic)
+                for (int ic = 0; ic < num_ic; ++ic) {
+                    for (int jr = 0; jr < num_jr; ++jr) {
+                        int s_begin = jr * strips_per_jr;
+                        int s_end = std::min(num_strips, s_begin + strips_per_jr);
+                        if (s_begin >= s_end) continue;
+
+                        int i = ic * mc;
+                        int ib = std::min(mc, m - i);
+                        int num_panels = (ib + MR - 1) / MR;
+
+                        bool a_high = false;
+                        for (int r = 0; r < num_panels; ++r) {
+                            int mr = std::min(MR, ib - r * MR);
+                            a_high |= pack_A_u8(kb, &A[(long long)(i + r * MR) * lda + k], lda,
+                                                &A_packed[(size_t)r * MR * kq * 4], mr, MR);
+                        }
+
+                        for (int s = s_begin; s < s_end; ++s) {
+                            int nr = std::min(NR, jb - s * NR);
+                            for (int r = 0; r < num_panels; ++r) {
+                                int mr = std::min(MR, ib - r * MR);
+                                kern.kernel(kq, &A_packed[(size_t)r * MR * kq * 4], &B_packed[(size_t)s * NR * kq * 4],
+                                            &C[(long long)(i + r * MR) * ldc + (j + s * NR)], ldc, mr, nr, a_high);
+                            }
+                        }
+                    }
+                }
+                // Implicit barrier: compute is done before the next B panel overwrites this one.
+            }
+        }
+    }
+}
+
+void matmul_u8s8s32(const U8Matrix& A, const S8Matrix& B, S32Matrix& C, int m, int n, int p) {
+    gemm_u8s8s32_strided(A.data(), n, B.data(), p, C.data(), p, m, n, p);
+}
@@ -0,0 +1,264 @@
+#include "../include/matmul_async.h"
+#include "../include/numa.h"
+#include "../include/packed_matrix.h"
+#include "../include/sgemm.h"
+#include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+// Asynchronous GEMM (see matmul_async.h)
+// All job state below is guarded by the scheduler's mutex, except the operands
+// and packed_b, which only the lane running the job touches.
+
+enum class EarlyPack {
+    None,
+    Queued,    // In packing_, no lane has taken it yet
+    Running,
+    Done
+};
+
+struct AsyncGemmJob {
+    GemmOp op;
+    GemmScheduler* owner = nullptr;
+    int waiting = 0;                                       // Unfinished `after` products
+    EarlyPack pack = EarlyPack::None;
+    bool finished = false;
+    std::vector<std::shared_ptr<AsyncGemmJob>> dependents; // Products waiting for this one
+    PackedMatrix packed_b;
+    std::promise<void> done;
+    std::shared_future<void> done_future;
+};
+
+bool GemmFuture::ready() const {
+    return !job_ || job_->done_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void GemmFuture::wait() const {
+    if (job_) job_->done_future.wait();
+}
+
+// Whether the address ranges spanned by two row-major views (rows x cols,
+// leading dimension ld) intersect
+static bool ranges_overlap(const float* a, int a_rows, int a_cols, int lda,
+                           const float* b, int b_rows, int b_cols, int ldb) {
+    uintptr_t a0 = reinterpret_cast<uintptr_t>(a);
+    uintptr_t a1 = reinterpret_cast<uintptr_t>(a + (size_t)(a_rows - 1) * lda + a_cols);
+    uintptr_t b0 = reinterpret_cast<uintptr_t>(b);
+    uintptr_t b1 = reinterpret_cast<uintptr_t>(b + (size_t)(b_rows - 1) * ldb + b_cols);
+    return a0 < b1 && b0 < a1;
+}
+
+static bool valid_op(const GemmOp& op) {
+    return op.A && op.B && op.C && op.m > 0 && op.n > 0 && op.p > 0 &&
+           op.lda >= op.n && op.ldb >= op.p && op.ldc >= op.p;
+}
+
+GemmScheduler::GemmScheduler(int lanes) {
+    const NumaTopology& topo = numa_topology();
+    int threads = std::max(1, omp_get_max_threads());
+    if (lanes <= 0) {
+        const char* env = std::getenv("MATMUL_ASYNC_LANES");
+        if (env && std::atoi(env) > 0) {
+            lanes = std::atoi(env);
+        } else if (topo.num_nodes > 1) {
+            lanes = topo.num_nodes;
+        } else {
+            lanes = std::min(2, threads);
+        }
+    }
+    lanes = std::max(1, std::min(lanes, threads));
+
+    // Threads split evenly; lanes spread round-robin over the nodes, and the
+    // CPUs of a node (all CPUs on a single node) split between its lanes
+    lanes_.resize(lanes);
+    int nodes = std::max(1, topo.num_nodes);
+    for (int l = 0; l < lanes; ++l) {
+        lanes_[l].threads = threads * (l + 1) / lanes - threads * l / lanes;
+        int node = l % nodes;
+        int lanes_on_node = (lanes - node + nodes - 1) / nodes;
+        lanes_[l].cpus = numa_cpu_share(nodes > 1 ? node : -1, l / nodes, lanes_on_node);
+    }
+    for (int l = 0; l < lanes; ++l) {
+        lanes_[l].worker = std::thread([this, l]() { lane_loop(l); });
+    }
+}
+
+GemmScheduler::~GemmScheduler() {
+    wait_all();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& lane : lanes_) {
+        if (lane.worker.joinable()) lane.worker.join();
+    }
+}
+
+GemmScheduler& GemmScheduler::global() {
+    static GemmScheduler scheduler;
+    return scheduler;
+}
+
+GemmFuture GemmScheduler::submit(const GemmOp& op, const std::vector<GemmFuture>& after) {
+    GemmFuture future;
+    if (!valid_op(op)) return future;
+
+    auto job = std::make_shared<AsyncGemmJob>();
+    job->op = op;
+    job->owner = this;
+    job->done_future = job->done.get_future().share();
+    future.job_ = job;
+
+    // Only products of this scheduler can be tracked as dependencies
+    for (const GemmFuture& f : after) {
+        if (f.valid() && f.job_->owner != this) f.wait();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const GemmFuture& f : after) {
+            if (!f.valid() || f.job_->owner != this || f.job_->finished) continue;
+            f.job_->dependents.push_back(job);
+            ++job->waiting;
+        }
+
+        // B may be written by any product ordered before this one, not only the
+        // direct `after` ones (X = A * C0 after {f1}, f1 after {f0} and f0
+        // writing C0), so it is checked against every unfinished output
+        bool b_being_written = false;
+        for (const auto& other : unfinished_) {
+            const GemmOp& o = other->op;
+            if (ranges_overlap(o.C, o.m, o.p, o.ldc, op.B, op.n, op.p, op.ldb)) {
+                b_being_written = true;
+                break;
+            }
+        }
+        unfinished_.push_back(job);
+
+        if (job->waiting == 0) {
+            ready_.push_back(job);
+        } else if (!b_being_written) {
+            job->pack = EarlyPack::Queued;
+            packing_.push_back(job);
+        }
+    }
+    work_cv_.notify_one();
+    return future;
+}
+
+void GemmScheduler::wait_all() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [&]() { return unfinished_.empty(); });
+}
+
+void GemmScheduler::lane_loop(int lane) {
+    // Everything this thread runs stays on the lane's cores: the binding holds
+    // for the thread's lifetime (team threads it creates inherit it, the SGEMM
+    // team binds each of its threads explicitly, so OMP_PROC_BIND places cannot
+    // move it) and the team size of every parallel region it starts is the lane's.
+    NumaThreadBinding binding(lanes_[lane].cpus);
+    omp_set_num_threads(lanes_[lane].threads);
+
+    for (;;) {
+        std::shared_ptr<AsyncGemmJob> job;
+        bool pack = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [&]() { return stop_ || !ready_.empty() || !packing_.empty(); });
+            // Products first: they unblock others. Packing fills idle time.
+            if (!ready_.empty()) {
+                job = ready_.front();
+                ready_.pop_front();
+            } else if (!packing_.empty()) {
+                job = packing_.front();
+                packing_.pop_front();
+                job->pack = EarlyPack::Running;
+                pack = true;
+            } else {
+                return; // stop_ and nothing left
+            }
+        }
+
+        if (pack) {
+            run_pack(job);
+        } else {
+            run_product(job, lane);
+            finish(job);
+        }
+    }
+}
+
+void GemmScheduler::run_pack(const std::shared_ptr<AsyncGemmJob>& job) {
+    const GemmOp& op = job->op;
+    job->packed_b.pack(op.B, op.ldb, op.n, op.p);
+
+    bool now_ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job->pack = EarlyPack::Done;
+        now_ready = job->waiting == 0;
+        if (now_ready) ready_.push_back(job);
+    }
+    if (now_ready) work_cv_.notify_one();
+}
+
+void GemmScheduler::run_product(const std::shared_ptr<AsyncGemmJob>& job, int lane) {
+    const GemmOp& op = job->op;
+    // EarlyPack::Done is only set before the job is queued as ready, no lock needed
+    if (job->pack == EarlyPack::Done && matmul_prepacked(op.A, op.lda, job->packed_b, op.C, op.ldc, op.m)) {
+        job->packed_b.clear();
+        return;
+    }
+    job->packed_b.clear();
+    matmul_optimized_sgemm_strided_team(op.A, op.lda, op.B, op.ldb, op.C, op.ldc, op.m, op.n, op.p,
+                                        lanes_[lane].threads, lanes_[lane].cpus);
+}
+
+void GemmScheduler::finish(const std::shared_ptr<AsyncGemmJob>& job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job->finished = true;
+        job->done.set_value();
+        for (auto& next : job->dependents) {
+            if (--next->waiting > 0) continue;
+            // All inputs done: an early pack nobody started is dropped, a running
+            // one queues the product itself when it is done
+            if (next->pack == EarlyPack::Queued) {
+                packing_.erase(std::find(packing_.begin(), packing_.end(), next));
+                next->pack = EarlyPack::None;
+            }
+            if (next->pack != EarlyPack::Running) ready_.push_back(next);
+        }
+        job->dependents.clear();
+        unfinished_.erase(std::find(unfinished_.begin(), unfinished_.end(), job));
+        if (unfinished_.empty()) idle_cv_.notify_all();
+    }
+    work_cv_.notify_all();
+}
+
+GemmFuture matmul_async(const GemmOp& op, const std::vector<GemmFuture>& after) {
+    return GemmScheduler::global().submit(op, after);
+}
+
+GemmFuture matmul_async(const float* A, int lda, const float* B, int ldb, float* C, int ldc, int m, int n, int p,
+                        const std::vector<GemmFuture>& after) {
+    GemmOp op;
+    op.A = A;
+    op.lda = lda;
+    op.B = B;
+    op.ldb = ldb;
+    op.C = C;
+    op.ldc = ldc;
+    op.m = m;
+    op.n = n;
+    op.p = p;
+    return matmul_async(op, after);
+}
+
+GemmFuture matmul_async(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p,
+                        const std::vector<GemmFuture>& after) {
+    return matmul_async(A.data(), n, B.data(), p, C.data(), p, m, n, p, after);
+}
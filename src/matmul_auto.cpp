@@ -0,0 +1,310 @@
+#include "../include/matmul_auto.h"
+#include "../include/cpu_dispatch.h"
+#include "../include/sgemm.h"
+#include "../include/matmul_fixed.h"
+#include "../include/skinny_gemm.h"
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+void matmul_strassen_parallel(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
+
+const char* shape_class_name(ShapeClass shape) {
+    switch (shape) {
+        case ShapeClass::Tiny: return "tiny";
+        case ShapeClass::Skinny: return "skinny";
+        case ShapeClass::Small: return "small";
+        case ShapeClass::Large: return "large";
+        case ShapeClass::Huge: return "huge";
+    }
+    return "?";
+}
+
+// Defaults: the small kernel up to 64^3 (as the batched GEMM), one thread per
+// ~4 MFLOP (about 100 us of micro-kernel time, against a few us to wake a
+// thread), the skinny kernels up to 16 rows / columns, no Strassen.
+DispatchParams default_dispatch_params() {
+    DispatchParams params;
+    params.tiny_max_flops = 2.0 * 64 * 64 * 64;
+    params.flops_per_thread = 4e6;
+    params.skinny_max_dim = 16;
+    params.huge_min_dim = 0;
+    return params;
+}
+
+std::string dispatch_profile_path() {
+    const char* env = std::getenv("MATMUL_DISPATCH_PROFILE");
+    return env ? env : "matmul_dispatch.profile";
+}
+
+bool save_dispatch_profile(const std::string& path, const DispatchParams& params) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "# matmul dispatch profile (written by benchmark_runner --calibrate-dispatch)\n";
+    out << "kernel=" << sgemm_kernel().name << "\n";
+    out << "threads=" << omp_get_max_threads() << "\n";
+    out << "tiny_max_flops=" << params.tiny_max_flops << "\n";
+    out << "flops_per_thread=" << params.flops_per_thread << "\n";
+    out << "skinny_max_dim=" << params.skinny_max_dim << "\n";
+    out << "huge_min_dim=" << params.huge_min_dim << "\n";
+    return (bool)out;
+}
+
+bool load_dispatch_profile(const std::string& path, DispatchParams& params) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    DispatchParams loaded = default_dispatch_params();
+    bool kernel_matches = false, threads_match = false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = line.substr(0, eq);
+        std::string value = line.substr(eq + 1);
+
+        if (key == "kernel") kernel_matches = (value == sgemm_kernel().name);
+        else if (key == "threads") threads_match = (std::atoi(value.c_str()) == omp_get_max_threads());
+        else if (key == "tiny_max_flops") loaded.tiny_max_flops = std::atof(value.c_str());
+        else if (key == "flops_per_thread") loaded.flops_per_thread = std::atof(value.c_str());
+        else if (key == "skinny_max_dim") loaded.skinny_max_dim = std::atoi(value.c_str());
+        else if (key == "huge_min_dim") loaded.huge_min_dim = std::atoi(value.c_str());
+    }
+
+    // The crossovers move with the micro-kernel and with the number of threads
+    // (OMP_NUM_THREADS), so a profile made for another setup does not apply.
+    if (!kernel_matches || !threads_match) return false;
+    if (loaded.tiny_max_flops < 0 || loaded.flops_per_thread <= 0 || loaded.skinny_max_dim < 0 ||
+        loaded.huge_min_dim < 0) {
+        return false;
+    }
+
+    params = loaded;
+    return true;
+}
+
+// Immutable snapshot behind an atomic pointer, as the blocking parameters
+// (tuning.cpp): matmul_auto reads it on every call, also from inside parallel
+// regions, so the read takes no lock. Replaced snapshots stay alive for readers
+// that may still be copying them.
+static std::atomic<const DispatchParams*> g_dispatch{nullptr};
+static std::mutex g_retired_mutex;
+static std::vector<std::unique_ptr<DispatchParams>> g_retired_dispatch;
+
+// Profile or defaults, loaded once on first use
+static const DispatchParams* startup_dispatch_params() {
+    static const DispatchParams params = [] {
+        DispatchParams loaded;
+        if (!load_dispatch_profile(dispatch_profile_path(), loaded)) loaded = default_dispatch_params();
+        return loaded;
+    }();
+    return &params;
+}
+
+DispatchParams dispatch_params() {
+    const DispatchParams* params = g_dispatch.load(std::memory_order_acquire);
+    return params ? *params : *startup_dispatch_params();
+}
+
+void set_dispatch_params(const DispatchParams& params) {
+    std::lock_guard<std::mutex> lock(g_retired_mutex);
+    g_retired_dispatch.emplace_back(new DispatchParams(params));
+    g_dispatch.store(g_retired_dispatch.back().get(), std::memory_order_release);
+}
+
+// Threads for `flops` of work: one per flops_per_thread, at most max_threads
+static int threads_for(double flops, const DispatchParams& params, int max_threads) {
+    double wanted = std::ceil(flops / params.flops_per_thread);
+    return (int)std::max(1.0, std::min((double)max_threads, wanted));
+}
+
+static DispatchPlan plan_with(int m, int n, int p, const DispatchParams& params, int max_threads) {
+    double flops = 2.0 * m * n * p;
+    int threads = threads_for(flops, params, max_threads);
+
+    if (flops <= params.tiny_max_flops) return {ShapeClass::Tiny, fixed_gemm_kernel(m, n, p) ? "fixed" : "small", 1};
+    if (std::min(m, p) <= params.skinny_max_dim) {
+        return {ShapeClass::Skinny, m <= p ? "skinny-m" : "skinny-p", threads};
+    }
+    if (params.huge_min_dim > 0 && std::min(m, std::min(n, p)) >= params.huge_min_dim) {
+        return {ShapeClass::Huge, "strassen-parallel", max_threads};
+    }
+    if (threads < max_threads) return {ShapeClass::Small, "sgemm", threads};
+    return {ShapeClass::Large, "sgemm", threads};
+}
+
+static int available_threads() {
+    return omp_in_parallel() ? 1 : omp_get_max_threads();
+}
+
+DispatchPlan plan_matmul(int m, int n, int p) {
+    return plan_with(m, n, p, dispatch_params(), available_threads());
+}
+
+static void run_plan(const DispatchPlan& plan, const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                     int m, int n, int p) {
+    switch (plan.shape) {
+        case ShapeClass::Tiny:
+            // The kernel compiled for the shape needs tight operands
+            if (FixedGemmKernel fixed = fixed_gemm_kernel(m, n, p); fixed && lda == n && ldb == p && ldc == p) {
+                fixed(A, B, C);
+            } else {
+                sgemm_kernel().small(m, n, p, A, lda, B, ldb, C, ldc);
+            }
+            break;
+        case ShapeClass::Skinny:
+            if (m <= p) {
+                matmul_skinny_m(A, lda, B, ldb, C, ldc, m, n, p, plan.threads);
+            } else {
+                matmul_skinny_p(A, lda, B, ldb, C, ldc, m, n, p, plan.threads);
+            }
+            break;
+        default:
+            // Huge lands here only from the strided form
+            matmul_optimized_sgemm_strided_team(A, lda, B, ldb, C, ldc, m, n, p, plan.threads, -1);
+            break;
+    }
+}
+
+void matmul_auto_strided(const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                         int m, int n, int p) {
+    if (m <= 0 || n <= 0 || p <= 0) return;
+    run_plan(plan_matmul(m, n, p), A, lda, B, ldb, C, ldc, m, n, p);
+}
+
+void matmul_auto(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+    if (m <= 0 || n <= 0 || p <= 0) return;
+    DispatchPlan plan = plan_matmul(m, n, p);
+    if (plan.shape == ShapeClass::Huge) {
+        matmul_strassen_parallel(A, B, C, m, n, p);
+        return;
+    }
+    run_plan(plan, A.data(), n, B.data(), p, C.data(), p, m, n, p);
+}
+
+// Calibration
+
+// Best-of-`trials` time of `run` (C is reset before each run)
+static double time_best(const std::function<void()>& reset, const std::function<void()>& run, int trials) {
+    double best = 1e9;
+    reset();
+    run(); // Warmup
+    for (int t = 0; t < trials; ++t) {
+        reset();
+        auto start = std::chrono::high_resolution_clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+    return best;
+}
+
+DispatchParams calibrate_dispatch(bool verbose) {
+    const int trials = 5;
+    const int max_threads = omp_get_max_threads();
+    const SgemmKernel& kern = sgemm_kernel();
+    DispatchParams params = default_dispatch_params();
+
+    // Tiny: the largest cube where the small kernel still beats the packed
+    // driver (both on one thread).
+    for (int s : {16, 24, 32, 48, 64, 96, 128}) {
+        Matrix A, B, C;
+        randomize_matrix(A, s, s);
+        randomize_matrix(B, s, s);
+        zeros_matrix(C, s, s);
+        auto reset = [&] { std::fill(C.begin(), C.end(), 0.0f); };
+        double t_small = time_best(reset, [&] { kern.small(s, s, s, A.data(), s, B.data(), s, C.data(), s); },
+                                   trials);
+        double t_packed = time_best(reset, [&] {
+            matmul_optimized_sgemm_strided_team(A.data(), s, B.data(), s, C.data(), s, s, s, s, 1, -1);
+        }, trials);
+        if (verbose) {
+            std::cout << "calibrate: " << s << "^3 small " << t_small * 1e6 << " us, packed " << t_packed * 1e6
+                      << " us" << std::endl;
+        }
+        if (t_small > t_packed) break;
+        params.tiny_max_flops = 2.0 * s * s * s;
+    }
+
+    // Threads: the smallest cube where all threads are clearly (1.5x) faster
+    // than one. Below that much work per thread, extra threads do not pay.
+    if (max_threads > 1) {
+        params.flops_per_thread = 2.0 * 512 * 512 * 512 / max_threads;
+        for (int s : {32, 48, 64, 96, 128, 192, 256, 384, 512}) {
+            Matrix A, B, C;
+            randomize_matrix(A, s, s);
+            randomize_matrix(B, s, s);
+            zeros_matrix(C, s, s);
+            auto reset = [&] { std::fill(C.begin(), C.end(), 0.0f); };
+            double t_one = time_best(reset, [&] {
+                matmul_optimized_sgemm_strided_team(A.data(), s, B.data(), s, C.data(), s, s, s, s, 1, -1);
+            }, trials);
+            double t_all = time_best(reset, [&] {
+                matmul_optimized_sgemm_strided_team(A.data(), s, B.data(), s, C.data(), s, s, s, s, max_threads, -1);
+            }, trials);
+            if (verbose) {
+                std::cout << "calibrate: " << s << "^3 1 thread " << t_one * 1e6 << " us, " << max_threads
+                          << " threads " << t_all * 1e6 << " us" << std::endl;
+            }
+            if (t_all * 1.5 < t_one) {
+                params.flops_per_thread = 2.0 * s * s * s / max_threads;
+                break;
+            }
+        }
+    }
+
+    // Skinny: the largest short side (m, with n = p = 2048) where the skinny
+    // kernel beats the packed driver on the same threads.
+    params.skinny_max_dim = 0;
+    for (int d : {1, 2, 4, 8, 16, 32}) {
+        const int big = 2048;
+        Matrix A, B, C;
+        randomize_matrix(A, d, big);
+        randomize_matrix(B, big, big);
+        zeros_matrix(C, d, big);
+        int threads = threads_for(2.0 * d * big * big, params, max_threads);
+        auto reset = [&] { std::fill(C.begin(), C.end(), 0.0f); };
+        double t_skinny = time_best(reset, [&] {
+            matmul_skinny_m(A.data(), big, B.data(), big, C.data(), big, d, big, big, threads);
+        }, trials);
+        double t_packed = time_best(reset, [&] {
+            matmul_optimized_sgemm_strided_team(A.data(), big, B.data(), big, C.data(), big, d, big, big, threads, -1);
+        }, trials);
+        if (verbose) {
+            std::cout << "calibrate: " << d << "x" << big << "x" << big << " skinny " << t_skinny * 1e6
+                      << " us, packed " << t_packed * 1e6 << " us" << std::endl;
+        }
+        if (t_skinny > t_packed) break;
+        params.skinny_max_dim = d;
+    }
+
+    // Huge: Strassen only if it is measurably (5%) faster at 2048
+    {
+        const int s = 2048;
+        Matrix A, B, C;
+        randomize_matrix(A, s, s);
+        randomize_matrix(B, s, s);
+        zeros_matrix(C, s, s);
+        auto reset = [&] { std::fill(C.begin(), C.end(), 0.0f); };
+        double t_packed = time_best(reset, [&] {
+            matmul_optimized_sgemm_strided(A.data(), s, B.data(), s, C.data(), s, s, s, s);
+        }, 2);
+        double t_strassen = time_best(reset, [&] { matmul_strassen_parallel(A, B, C, s, s, s); }, 2);
+        if (verbose) {
+            std::cout << "calibrate: " << s << "^3 packed " << t_packed * 1e3 << " ms, Strassen " << t_strassen * 1e3
+                      << " ms" << std::endl;
+        }
+        params.huge_min_dim = (t_strassen * 1.05 < t_packed) ? s : 0;
+    }
+
+    return params;
+}
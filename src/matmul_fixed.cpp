@@ -0,0 +1,50 @@
+#include "../include/matmul_fixed.h"
+#include "../include/sgemm.h"
+
+// Fixed-size kernels (see matmul_fixed.h): the instantiated square sizes, one
+// table per ISA level, indexed like the other kernel tables.
+
+// Largest dimension the unpacked small kernel takes in the fallback (as in
+// batched.cpp)
+const int FIXED_SMALL_MAX_DIM = 64;
+
+struct FixedSizeKernels {
+    FixedGemmKernel k4, k8, k16, k32, k64;
+};
+
+static const FixedSizeKernels& fixed_kernels() {
+    static const FixedSizeKernels kernels[] = {
+        {matmul_fixed_scalar<4, 4, 4>, matmul_fixed_scalar<8, 8, 8>, matmul_fixed_scalar<16, 16, 16>,
+         matmul_fixed_scalar<32, 32, 32>, matmul_fixed_scalar<64, 64, 64>},
+        {matmul_fixed_avx2<4, 4, 4>, matmul_fixed_avx2<8, 8, 8>, matmul_fixed_avx2<16, 16, 16>,
+         matmul_fixed_avx2<32, 32, 32>, matmul_fixed_avx2<64, 64, 64>},
+        // AVX-512 machines run the AVX2 kernels (see matmul_fixed.h)
+        {matmul_fixed_avx2<4, 4, 4>, matmul_fixed_avx2<8, 8, 8>, matmul_fixed_avx2<16, 16, 16>,
+         matmul_fixed_avx2<32, 32, 32>, matmul_fixed_avx2<64, 64, 64>},
+    };
+    return kernels[static_cast<int>(active_cpu_isa())];
+}
+
+FixedGemmKernel fixed_gemm_kernel(int m, int n, int p) {
+    if (m != n || n != p) return nullptr;
+    const FixedSizeKernels& kernels = fixed_kernels();
+    switch (m) {
+        case 4: return kernels.k4;
+        case 8: return kernels.k8;
+        case 16: return kernels.k16;
+        case 32: return kernels.k32;
+        case 64: return kernels.k64;
+        default: return nullptr;
+    }
+}
+
+void matmul_fixed_dispatch(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+    if (m <= 0 || n <= 0 || p <= 0) return;
+    if (FixedGemmKernel kernel = fixed_gemm_kernel(m, n, p)) {
+        kernel(A.data(), B.data(), C.data());
+    } else if (m <= FIXED_SMALL_MAX_DIM && n <= FIXED_SMALL_MAX_DIM && p <= FIXED_SMALL_MAX_DIM) {
+        sgemm_kernel().small(m, n, p, A.data(), n, B.data(), p, C.data(), p);
+    } else {
+        matmul_optimized_sgemm_strided(A.data(), n, B.data(), p, C.data(), p, m, n, p);
+    }
+}
@@ -0,0 +1,167 @@
+#include "../include/mixed_precision.h"
+#include "../include/cpu_dispatch.h"
+#include <immintrin.h>
+
+// Half-precision conversions
+// Scalar versions are portable bit manipulation; the bulk versions use F16C
+// (vcvtph2ps / vcvtps2ph) for fp16 and AVX2 shifts for bf16, 8 values at a time,
+// with the scalar version for the tail.
+
+// fp16 <-> float, round to nearest even. The subnormal cases go through float
+// arithmetic: adding a magic power of two aligns the value so that the FPU does
+// the rounding (float -> half) or the normalization (half -> float).
+float16 float_to_fp16(float value) {
+    const uint32_t f32_infinity = 255u << 23;
+    const uint32_t f16_max = (127u + 16) << 23; // 2^16: everything above rounds to infinity
+    const uint32_t denorm_magic_bits = ((127u - 15) + (23 - 10) + 1) << 23;
+
+    uint32_t u;
+    std::memcpy(&u, &value, sizeof(u));
+    uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+
+    uint16_t h;
+    if (u >= f16_max) {
+        h = (u > f32_infinity) ? 0x7E00 : 0x7C00; // NaN : infinity
+    } else if (u < (113u << 23)) {
+        // Below 2^-14: subnormal half (or zero)
+        float f, magic;
+        std::memcpy(&f, &u, sizeof(f));
+        std::memcpy(&magic, &denorm_magic_bits, sizeof(magic));
+        f += magic;
+        std::memcpy(&u, &f, sizeof(u));
+        h = (uint16_t)(u - denorm_magic_bits);
+    } else {
+        uint32_t mant_odd = (u >> 13) & 1;
+        u += ((15u - 127) << 23) + 0xFFF; // Rebias the exponent and round
+        u += mant_odd;                      // Ties to even
+        h = (uint16_t)(u >> 13);
+    }
+    return float16{(uint16_t)(h | (sign >> 16))};
+}
+
+float fp16_to_float(float16 value) {
+    const uint32_t shifted_exp = 0x7C00u << 13;
+    const uint32_t magic_bits = 113u << 23;
+
+    uint32_t u = (uint32_t)(value.bits & 0x7FFF) << 13;
+    uint32_t exp = u & shifted_exp;
+    u += (127u - 15) << 23;
+    if (exp == shifted_exp) {
+        u += (128u - 16) << 23; // Infinity / NaN
+    } else if (exp == 0) {
+        // Zero / subnormal: renormalize
+        float f, magic;
+        u += 1u << 23;
+        std::memcpy(&f, &u, sizeof(f));
+        std::memcpy(&magic, &magic_bits, sizeof(magic));
+        f -= magic;
+        std::memcpy(&u, &f, sizeof(u));
+    }
+    u |= (uint32_t)(value.bits & 0x8000) << 16;
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+TARGET_AVX2
+static void bf16_to_float_avx2(const bfloat16* src, float* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i h = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)&src[i]));
+        _mm256_storeu_ps(&dst[i], _mm256_castsi256_ps(_mm256_slli_epi32(h, 16)));
+    }
+    for (; i < count; ++i) dst[i] = bf16_to_float(src[i]);
+}
+
+TARGET_AVX2
+static void float_to_bf16_avx2(const float* src, bfloat16* dst, size_t count) {
+    const __m256i abs_mask = _mm256_set1_epi32(0x7FFFFFFF);
+    const __m256i infinity = _mm256_set1_epi32(0x7F800000);
+    const __m256i bias = _mm256_set1_epi32(0x7FFF);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i quiet = _mm256_set1_epi32(0x40);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i u = _mm256_castps_si256(_mm256_loadu_ps(&src[i]));
+        // Round to nearest even, as float_to_bf16
+        __m256i odd = _mm256_and_si256(_mm256_srli_epi32(u, 16), one);
+        __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(u, _mm256_add_epi32(bias, odd)), 16);
+        __m256i nan = _mm256_or_si256(_mm256_srli_epi32(u, 16), quiet);
+        __m256i is_nan = _mm256_cmpgt_epi32(_mm256_and_si256(u, abs_mask), infinity);
+        __m256i h = _mm256_blendv_epi8(rounded, nan, is_nan);
+        // 8 x 32 -> 8 x 16 bits (packus works per 128-bit lane, so gather the two halves)
+        h = _mm256_permute4x64_epi64(_mm256_packus_epi32(h, h), 0x08);
+        _mm_storeu_si128((__m128i*)&dst[i], _mm256_castsi256_si128(h));
+    }
+    for (; i < count; ++i) dst[i] = float_to_bf16(src[i]);
+}
+
+TARGET_AVX2_F16C
+static void fp16_to_float_f16c(const float16* src, float* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(&dst[i], _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)&src[i])));
+    }
+    for (; i < count; ++i) dst[i] = fp16_to_float(src[i]);
+}
+
+TARGET_AVX2_F16C
+static void float_to_fp16_f16c(const float* src, float16* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(&src[i]), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i*)&dst[i], h);
+    }
+    for (; i < count; ++i) dst[i] = float_to_fp16(src[i]);
+}
+
+void convert_bf16_to_float(const bfloat16* src, float* dst, size_t count) {
+    if (active_cpu_isa() >= CpuIsa::AVX2) {
+        bf16_to_float_avx2(src, dst, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) dst[i] = bf16_to_float(src[i]);
+}
+
+void convert_float_to_bf16(const float* src, bfloat16* dst, size_t count) {
+    if (active_cpu_isa() >= CpuIsa::AVX2) {
+        float_to_bf16_avx2(src, dst, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) dst[i] = float_to_bf16(src[i]);
+}
+
+void convert_fp16_to_float(const float16* src, float* dst, size_t count) {
+    if (cpu_features().f16c) {
+        fp16_to_float_f16c(src, dst, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) dst[i] = fp16_to_float(src[i]);
+}
+
+void convert_float_to_fp16(const float* src, float16* dst, size_t count) {
+    if (cpu_features().f16c) {
+        float_to_fp16_f16c(src, dst, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) dst[i] = float_to_fp16(src[i]);
+}
+
+void to_bf16(const Matrix& src, BF16Matrix& dst) {
+    dst.resize(src.size());
+    convert_float_to_bf16(src.data(), dst.data(), src.size());
+}
+
+void to_fp16(const Matrix& src, FP16Matrix& dst) {
+    dst.resize(src.size());
+    convert_float_to_fp16(src.data(), dst.data(), src.size());
+}
+
+void matmul_bf16(const BF16Matrix& A, const BF16Matrix& B, Matrix& C, int m, int n, int p) {
+    matmul_bf16_strided(A.data(), n, B.data(), p, C.data(), p, m, n, p);
+}
+
+void matmul_fp16(const FP16Matrix& A, const FP16Matrix& B, Matrix& C, int m, int n, int p) {
+    matmul_fp16_strided(A.data(), n, B.data(), p, C.data(), p, m, n, p);
+}
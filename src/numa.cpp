@@ -0,0 +1,273 @@
+#include "../include/numa.h"
+#include "../include/cpu_dispatch.h"
+#include "../include/sgemm.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <omp.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// CPUs this process may run on
+static std::vector<int> online_cpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        unsigned hw = std::thread::hardware_concurrency();
+        for (unsigned cpu = 0; cpu < std::max(1u, hw); ++cpu) cpus.push_back((int)cpu);
+    }
+    return cpus;
+}
+
+// cpulist format: "0-3,8-11"
+static std::vector<int> parse_cpulist(const char* text) {
+    std::vector<int> cpus;
+    const char* s = text;
+    while (*s) {
+        char* end = nullptr;
+        long first = std::strtol(s, &end, 10);
+        if (end == s) break;
+        long last = first;
+        s = end;
+        if (*s == '-') {
+            last = std::strtol(s + 1, &end, 10);
+            s = end;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) cpus.push_back((int)cpu);
+        if (*s == ',') ++s;
+        else break;
+    }
+    return cpus;
+}
+
+static bool topology_from_sysfs(NumaTopology& topo) {
+    for (int node = 0; node < 1024; ++node) {
+        std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+        FILE* f = std::fopen(path.c_str(), "r");
+        if (!f) break;
+        char line[4096] = {0};
+        bool ok = std::fgets(line, sizeof(line), f) != nullptr;
+        std::fclose(f);
+        if (!ok) continue;
+        std::vector<int> cpus = parse_cpulist(line);
+        if (!cpus.empty()) topo.node_cpus.push_back(cpus); // Skip memory-only nodes
+    }
+    topo.num_nodes = (int)topo.node_cpus.size();
+    return topo.num_nodes > 0;
+}
+
+// k virtual nodes: the allowed CPUs split into k contiguous groups (CPUs are
+// shared round-robin if there are fewer than k).
+static NumaTopology simulated_topology(int k) {
+    std::vector<int> cpus = online_cpus();
+    NumaTopology topo;
+    topo.num_nodes = k;
+    topo.simulated = true;
+    topo.node_cpus.resize(k);
+    if ((int)cpus.size() >= k) {
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            topo.node_cpus[i * k / cpus.size()].push_back(cpus[i]);
+        }
+    } else {
+        for (int node = 0; node < k; ++node) topo.node_cpus[node].push_back(cpus[node % cpus.size()]);
+    }
+    return topo;
+}
+
+const NumaTopology& numa_topology() {
+    static const NumaTopology topo = [] {
+        const char* env = std::getenv("MATMUL_NUMA_NODES");
+        if (env && std::atoi(env) > 0) return simulated_topology(std::atoi(env));
+
+        NumaTopology t;
+        t.num_nodes = 0;
+        t.simulated = false;
+        if (!topology_from_sysfs(t)) {
+            t.node_cpus.assign(1, online_cpus());
+            t.num_nodes = 1;
+        }
+        return t;
+    }();
+    return topo;
+}
+
+NumaPlan numa_plan(int rows, int num_threads, int max_nodes) {
+    const NumaTopology& topo = numa_topology();
+    int nodes = std::max(1, std::min(topo.num_nodes, num_threads));
+    if (max_nodes > 0) nodes = std::min(nodes, max_nodes);
+    num_threads = std::max(num_threads, 1);
+
+    // Threads evenly over the nodes, rows in proportion to the threads, with
+    // block boundaries on whole MR-row micro-panels
+    const int MR = sgemm_kernel().mr;
+    NumaPlan plan;
+    int row = 0;
+    int threads_before = 0;
+    for (int g = 0; g < nodes; ++g) {
+        int threads = num_threads / nodes + (g < num_threads % nodes ? 1 : 0);
+        threads_before += threads;
+        int end = (g == nodes - 1) ? rows
+                                   : std::min(rows, (int)((long long)rows * threads_before / num_threads) / MR * MR);
+        plan.node.push_back(g);
+        plan.threads.push_back(threads);
+        plan.row_begin.push_back(row);
+        plan.row_end.push_back(std::max(row, end));
+        row = std::max(row, end);
+    }
+    return plan;
+}
+
+std::vector<int> numa_cpu_share(int node, int index, int count) {
+    const NumaTopology& topo = numa_topology();
+    std::vector<int> allowed = online_cpus();
+    std::vector<int> cpus;
+    if (node < 0 || node >= topo.num_nodes) {
+        cpus = allowed;
+    } else {
+        for (int cpu : topo.node_cpus[node]) {
+            if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) cpus.push_back(cpu);
+        }
+        if (cpus.empty()) cpus = topo.node_cpus[node];
+    }
+    count = std::max(count, 1);
+    index = std::max(0, std::min(index, count - 1));
+
+    std::vector<int> share;
+    if ((int)cpus.size() >= count) {
+        size_t begin = cpus.size() * index / count, end = cpus.size() * (index + 1) / count;
+        share.assign(cpus.begin() + begin, cpus.begin() + end);
+    } else if (!cpus.empty()) {
+        share.push_back(cpus[index % cpus.size()]);
+    }
+    return share;
+}
+
+NumaThreadBinding::NumaThreadBinding(int node) {
+    const NumaTopology& topo = numa_topology();
+    if (node < 0 || topo.num_nodes <= 1 || node >= topo.num_nodes) return;
+    bind(topo.node_cpus[node]);
+}
+
+NumaThreadBinding::NumaThreadBinding(const std::vector<int>& cpus) {
+    bind(cpus);
+}
+
+void NumaThreadBinding::bind(const std::vector<int>& cpus) {
+#ifdef __linux__
+    static_assert(sizeof(cpu_set_t) <= sizeof(saved_mask_), "cpu_set_t does not fit");
+    if (cpus.empty()) return;
+
+    cpu_set_t* saved = reinterpret_cast<cpu_set_t*>(saved_mask_);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), saved) != 0) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) CPU_SET(cpu, &set);
+    active_ = sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+#endif
+}
+
+NumaThreadBinding::~NumaThreadBinding() {
+#ifdef __linux__
+    if (active_) sched_setaffinity(0, sizeof(cpu_set_t), reinterpret_cast<cpu_set_t*>(saved_mask_));
+#endif
+}
+
+// The per-node teams are nested inside the one-thread-per-node region, so at
+// least two active levels are needed. Raised once and never lowered again:
+// max-active-levels is process-wide, and saving / restoring it per call races
+// with other threads in the middle of their own per-node region. Library code
+// reached from inside a parallel region still runs on one thread (it checks
+// omp_in_parallel()), so this only enables the explicit per-node teams.
+static void enable_nested_teams() {
+    static std::once_flag once;
+    std::call_once(once, [] { omp_set_max_active_levels(std::max(omp_get_max_active_levels(), 2)); });
+}
+
+// Runs fn(plan index) on one thread per node (bound to the node), with nested
+// parallelism enabled so fn can start a team on its node.
+template <typename Fn>
+static void run_per_node(const NumaPlan& plan, Fn fn) {
+    int nodes = (int)plan.node.size();
+    if (nodes > 1) enable_nested_teams();
+
+    #pragma omp parallel num_threads(nodes) if(nodes > 1)
+    {
+        int g = omp_get_thread_num();
+        NumaThreadBinding binding(plan.node[g]);
+        fn(g);
+    }
+}
+
+// The threads of each node write their share of the node's row block
+template <typename Fn>
+static void first_touch_rows(int rows, Fn touch_rows) {
+    NumaPlan plan = numa_plan(rows, omp_get_max_threads());
+    run_per_node(plan, [&](int g) {
+        int begin = plan.row_begin[g], count = plan.row_end[g] - plan.row_begin[g];
+        int threads = plan.threads[g];
+
+        #pragma omp parallel num_threads(threads) if(threads > 1)
+        {
+            NumaThreadBinding binding(plan.node[g]);
+            int t = omp_get_thread_num(), team = omp_get_num_threads();
+            int r0 = begin + (int)((long long)count * t / team);
+            int r1 = begin + (int)((long long)count * (t + 1) / team);
+            touch_rows(r0, r1);
+        }
+    });
+}
+
+void numa_zeros_matrix(Matrix& mat, int rows, int cols) {
+    // Fresh, untouched storage (Matrix does not zero on resize)
+    Matrix fresh;
+    fresh.resize((size_t)rows * cols);
+    first_touch_rows(rows, [&](int r0, int r1) {
+        std::fill(fresh.begin() + (size_t)r0 * cols, fresh.begin() + (size_t)r1 * cols, 0.0f);
+    });
+    mat.swap(fresh);
+}
+
+void numa_distribute_rows(Matrix& mat, int rows, int cols) {
+    Matrix fresh;
+    fresh.resize((size_t)rows * cols);
+    first_touch_rows(rows, [&](int r0, int r1) {
+        std::copy(mat.begin() + (size_t)r0 * cols, mat.begin() + (size_t)r1 * cols, fresh.begin() + (size_t)r0 * cols);
+    });
+    mat.swap(fresh);
+}
+
+void matmul_sgemm_numa(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+    matmul_sgemm_numa_plan(A, B, C, m, n, p, numa_plan(m, omp_get_max_threads()));
+}
+
+void matmul_sgemm_numa_plan(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p, const NumaPlan& plan) {
+    if (plan.node.size() == 1) {
+        matmul_optimized_sgemm_strided_team(A.data(), n, B.data(), p, C.data(), p, m, n, p, plan.threads[0], -1);
+        return;
+    }
+
+    // One team per node on its own rows of A and C. B is shared (read-only);
+    // each team packs its own copy of the B panels.
+    run_per_node(plan, [&](int g) {
+        int r0 = plan.row_begin[g], rows = plan.row_end[g] - plan.row_begin[g];
+        if (rows <= 0) return;
+        matmul_optimized_sgemm_strided_team(&A[(size_t)r0 * n], n, B.data(), p, &C[(size_t)r0 * p], p,
+                                            rows, n, p, plan.threads[g], plan.node[g]);
+    });
+}
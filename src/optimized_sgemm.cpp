@@ -1,147 +1,457 @@
 #include "../include/matrix_utils.h"
-#include <immintrin.h>
+#include "../include/cpu_dispatch.h"
+#include "../include/sgemm.h"
+#include "../include/tuning.h"
+#include "../include/numa.h"
+#include "../include/mixed_precision.h"
+#include "../include/packed_matrix.h"
+#include <omp.h>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
 
 // Optimized SGEMM
 // Uses packing (copying submatrices to contiguous memory) and a micro-kernel.
 // This mimics how BLAS libraries work.
+// The micro-kernel (and with it the MR x NR register tile) is chosen at runtime
+// for the running CPU, see cpu_dispatch.h and sgemm_kernels.cpp.
 
-// Micro-kernel: 8x8 block
-// Computes C_micro += A_micro * B_micro
-// A_micro is 8xK, B_micro is Kx8 (packed)
-// But for simplicity, we'll assume we are doing a small block update.
-// We'll use a 6x16 kernel for AVX2 (2 registers for A, 4 for B accumulation? No, 16 floats is 2 registers).
-// Let's stick to a classic 8x8 kernel or similar.
-// Registers: 16 YMM registers available in AVX2.
-// We can keep 8x8 C block in registers? 64 floats = 256 bytes. 
-// 8 YMM registers can hold 8x8 floats? No, 1 YMM = 8 floats.
-// So 8 YMM registers = 8x8 block of C.
-// We need some registers for A and B.
-// So we can use 8-12 registers for C, and rest for A/B.
-// Let's use 8x8 kernel. C is 8x8.
-// We load 1 float from A, broadcast it, multiply by row of B (8 floats).
-// Repeat for k.
-
-void kernel_8x8(int k, const float* A, const float* B, float* C, int ldc) {
-    __m256 c[8];
-    for (int i = 0; i < 8; ++i) {
-        c[i] = _mm256_loadu_ps(&C[i * ldc]);
+// Packing functions
+// Both pack a full MR/NR-wide micro-panel (MR/NR come from the selected kernel).
+// When fewer rows/columns are left (mr < MR, nr < NR) the missing part is filled
+// with zeros, so the kernel never needs to special-case the K loop and never
+// reads past the end of A or B.
+// The source is addressed through a row stride and a column stride, so a
+// transposed operand is packed straight from its original storage:
+//   op(X)(r, c) = X[r * row_stride + c * col_stride]
+// (row_stride = ld, col_stride = 1 for 'N'; row_stride = 1, col_stride = ld for 'T').
+//
+// The source element type may also be bfloat16 / float16 (mixed_precision.h):
+// the values are widened to float here, so the driver and the micro-kernels
+// only ever see floats.
+static inline float load_float(float x) { return x; }
+static inline float load_float(bfloat16 x) { return bf16_to_float(x); }
+static inline float load_float(float16 x) { return fp16_to_float(x); }
+
+static inline void load_floats(const float* src, float* dst, int count) { std::copy(src, src + count, dst); }
+static inline void load_floats(const bfloat16* src, float* dst, int count) { convert_bf16_to_float(src, dst, count); }
+static inline void load_floats(const float16* src, float* dst, int count) { convert_fp16_to_float(src, dst, count); }
+
+template <typename T>
+void pack_A(int k, const T* A, int rs, int cs, float* A_packed, int mr, int MR, float alpha) {
+    // Half-precision rows: widen a chunk of each row with the vector converter,
+    // then scatter it into the panel like below.
+    if (!std::is_same<T, float>::value && cs == 1) {
+        const int CHUNK = 64;
+        float row[CHUNK];
+        for (int p0 = 0; p0 < k; p0 += CHUNK) {
+            int len = std::min(CHUNK, k - p0);
+            int i = 0;
+            for (; i < mr; ++i) {
+                load_floats(&A[(long long)i * rs + p0], row, len);
+                for (int p = 0; p < len; ++p) {
+                    A_packed[(p0 + p) * MR + i] = alpha * row[p];
+                }
+            }
+            for (; i < MR; ++i) {
+                for (int p = 0; p < len; ++p) {
+                    A_packed[(p0 + p) * MR + i] = 0.0f;
+                }
+            }
+        }
+        return;
     }
 
+    // Pack MR rows of op(A) as a column panel: A_packed[p * MR + i] = alpha * A[i][p].
+    // The kernel then walks A_packed strictly sequentially. Scaling by alpha here
+    // is free (every element is touched anyway) and keeps alpha out of the kernel.
     for (int p = 0; p < k; ++p) {
-        __m256 b_vec = _mm256_loadu_ps(&B[p * 8]);
-        
-        for (int i = 0; i < 8; ++i) {
-            __m256 a_vec = _mm256_set1_ps(A[i * k + p]); // A is stored row-major? No, we pack A.
-            // If A is packed as 8xK, then A[i*k + p] is correct if row-major.
-            // But usually we pack A as Kx8 or something for better access.
-            // Let's assume A is packed such that we access it sequentially or broadcast easily.
-            // If A is packed column-major (or panel), we might just load.
-            // Let's stick to simple packing: A is 8 rows, K columns.
-            // We want to load A[i][p].
-            
-            c[i] = _mm256_fmadd_ps(a_vec, b_vec, c[i]);
+        int i = 0;
+        for (; i < mr; ++i) {
+            A_packed[p * MR + i] = alpha * load_float(A[(long long)i * rs + (long long)p * cs]);
+        }
+        for (; i < MR; ++i) {
+            A_packed[p * MR + i] = 0.0f;
         }
     }
+}
 
-    for (int i = 0; i < 8; ++i) {
-        _mm256_storeu_ps(&C[i * ldc], c[i]);
+template <typename T>
+void pack_B(int k, const T* B, int rs, int cs, float* B_packed, int nr, int NR) {
+    // Pack NR columns of op(B) into contiguous memory
+    // B_packed will be k * NR
+    // We store it row-major KxNR so the kernel loads each row of the panel contiguously.
+    for (int p = 0; p < k; ++p) {
+        const T* b_row = &B[(long long)p * rs];
+        int j = 0;
+        if (cs == 1) {
+            load_floats(b_row, &B_packed[p * NR], nr);
+            j = nr;
+        } else {
+            for (; j < nr; ++j) {
+                B_packed[p * NR + j] = load_float(b_row[(long long)j * cs]);
+            }
+        }
+        for (; j < NR; ++j) {
+            B_packed[p * NR + j] = 0.0f;
+        }
     }
 }
 
-// Packing functions
-void pack_A(int k, const float* A, int lda, float* A_packed) {
-    // Pack 8 rows of A into contiguous memory
-    // A_packed will be 8 * k
-    // We store it such that we can access it easily in the kernel.
-    // Actually, for the kernel above: `a_vec = _mm256_set1_ps(A[i * k + p])`
-    // This implies A is stored row-major 8xK.
-    for (int i = 0; i < 8; ++i) {
-        for (int p = 0; p < k; ++p) {
-            A_packed[i * k + p] = A[i * lda + p];
+// C = beta * C on an m x p view (used when there is nothing to multiply)
+static void scale_c(int m, int p, float beta, float* C, int ldc) {
+    for (int i = 0; i < m; ++i) {
+        float* c_row = &C[(long long)i * ldc];
+        if (beta == 0.0f) {
+            std::fill(c_row, c_row + p, 0.0f); // Never read C, so NaNs in C are dropped
+        } else {
+            for (int j = 0; j < p; ++j) c_row[j] *= beta;
         }
     }
 }
 
-void pack_B(int k, const float* B, int ldb, float* B_packed) {
-    // Pack 8 columns of B into contiguous memory
-    // B_packed will be k * 8
-    // We store it row-major Kx8 so we can load `b_vec` as contiguous 8 floats.
-    for (int p = 0; p < k; ++p) {
-        for (int j = 0; j < 8; ++j) {
-            B_packed[p * 8 + j] = B[p * ldb + j];
+// Epilogue on a finished m x p view of C, element by element (the driver's
+// no-multiply path; the normal path runs it inside the micro-kernel).
+static void apply_epilogue_c(int m, int p, const float* C, int ldc, const SgemmEpilogue& ep) {
+    std::vector<float> values(p);
+    for (int i = 0; i < m; ++i) {
+        const float* c_row = &C[(long long)i * ldc];
+        for (int j = 0; j < p; ++j) values[j] = apply_epilogue(c_row[j], ep, i, j);
+        size_t offset = (size_t)i * ep.ldo;
+        if (!ep.output) {
+            std::copy(values.begin(), values.end(), (float*)c_row);
+        } else if (ep.output_type == EpilogueOutput::BF16) {
+            convert_float_to_bf16(values.data(), (bfloat16*)ep.output + offset, p);
+        } else if (ep.output_type == EpilogueOutput::FP16) {
+            convert_float_to_fp16(values.data(), (float16*)ep.output + offset, p);
+        } else {
+            std::copy(values.begin(), values.end(), (float*)ep.output + offset);
         }
     }
 }
 
-void matmul_optimized_sgemm(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
-    // Block sizes
-    const int MC = 256; // Block size for M
-    const int KC = 256; // Block size for K
-    const int NC = 128; // Block size for N
-
-    // Buffers for packing
-    // We need to be thread-safe if we parallelize this later.
-    // For now, single threaded logic, but we can allocate inside.
-    // Or static thread_local.
-    std::vector<float> A_packed(MC * KC);
-    std::vector<float> B_packed(KC * NC);
-
-    for (int j = 0; j < p; j += NC) {
-        int jb = std::min(NC, p - j);
-        for (int k = 0; k < n; k += KC) {
-            int kb = std::min(KC, n - k);
-            
-            // Pack B (kb x jb) -> we only pack strips of 8 columns?
-            // The standard GotoBLAS approach loops over j, then k, then i.
-            // B is packed once for all i.
-            
-            for (int i = 0; i < m; i += MC) {
-                int ib = std::min(MC, m - i);
-                
-                // Inner loops over micro-blocks (8x8)
-                for (int jj = 0; jj < jb; jj += 8) {
-                    // Pack B strip (kb x 8)
-                    // We verify we have 8 columns. If not, we need edge handling.
-                    if (jj + 8 > jb) {
-                        // Fallback for edge cases or implement masked kernel
-                        // For this demo, we just skip or use naive for edges.
-                        // Let's use naive for the whole block if it doesn't fit.
-                        // Or just ignore edges for "Optimized" demo and assume multiple of 8.
-                        // We'll implement a simple fallback loop for the whole function if dimensions are not multiples of 8.
-                        continue; 
+// Phase timing (see sgemm.h). Off by default; when off the driver only pays a
+// branch per block. Times are summed over threads, in nanoseconds.
+static std::atomic<bool> g_phase_timing{false};
+static std::atomic<long long> g_pack_a_ns{0}, g_pack_b_ns{0}, g_compute_ns{0}, g_wall_ns{0}, g_calls{0};
+
+static inline long long phase_now(bool timed) {
+    if (!timed) return 0;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void set_sgemm_phase_timing(bool enabled) {
+    g_phase_timing.store(enabled, std::memory_order_relaxed);
+}
+
+void reset_sgemm_phase_times() {
+    g_pack_a_ns = 0;
+    g_pack_b_ns = 0;
+    g_compute_ns = 0;
+    g_wall_ns = 0;
+    g_calls = 0;
+}
+
+SgemmPhaseTimes sgemm_phase_times() {
+    SgemmPhaseTimes times;
+    times.pack_a = g_pack_a_ns * 1e-9;
+    times.pack_b = g_pack_b_ns * 1e-9;
+    times.compute = g_compute_ns * 1e-9;
+    times.wall = g_wall_ns * 1e-9;
+    times.calls = g_calls;
+    return times;
+}
+
+// Multi-threaded GotoBLAS-style driver.
+// Loop nest (outer to inner): jc (NC) -> pc (KC) -> ic (MC) -> jr (NR) -> ir (MR).
+// - The KC x NC panel of B is packed ONCE per (jc, pc) by all threads together
+//   (each thread packs a share of the NR-column strips) and then read by everyone.
+// - Each thread packs its own MC x KC block of A into a private buffer.
+// - The compute phase is split over (ic block, jr range) work items, so even when
+//   m is small there are enough items to keep every core busy.
+// Two barriers per (jc, pc): one after packing B (panel complete before use) and
+// one after compute (nobody repacks B while another thread still reads it).
+//
+// Computes C = alpha * op(A) * op(B) + beta * C, op(A) is m x n, op(B) is n x p,
+// with op(A)/op(B) addressed through row/column strides (see pack_A/pack_B).
+// A and B may also be bfloat16 / float16, widened to float while packing.
+// alpha is folded into the packing of A; beta is applied by the micro-kernel on
+// the first K block (later K blocks accumulate with beta = 1), so beta = 0 never
+// reads C and C is written exactly once per K block.
+//
+// With an epilogue (sgemm.h), the last K block calls the epilogue variant of the
+// micro-kernel, which adds the biases, applies the activation and the scale
+// while the tile is still in registers (no extra pass over C).
+//
+// With packed_b (packed_matrix.h), B was packed ahead of time: the driver uses
+// its KC and reads the panels straight from it (no pack_B, no barrier).
+//
+// team_threads = 0 picks the team size automatically (all threads, or one when
+// called from inside a parallel region). A positive value forces that team size,
+// also when nested (the NUMA mode runs one team per node). With bind_cpus set,
+// every thread of the team is bound to those CPUs for the call (a NUMA node, an
+// async lane), which also holds under OMP_PROC_BIND.
+template <typename TA, typename TB>
+static void sgemm_driver(int m, int n, int p, float alpha,
+                         const TA* A, int rsa, int csa, const TB* B, int rsb, int csb,
+                         float beta, float* C, int ldc, int team_threads = 0,
+                         const std::vector<int>* bind_cpus = nullptr,
+                         const SgemmEpilogue* epilogue = nullptr, const PackedMatrix* packed_b = nullptr) {
+    if (m <= 0 || p <= 0) return;
+    if (n <= 0 || alpha == 0.0f) {
+        scale_c(m, p, beta, C, ldc);
+        if (epilogue) apply_epilogue_c(m, p, C, ldc, *epilogue);
+        return;
+    }
+
+    const SgemmKernel& kern = sgemm_kernel();
+    const int MR = kern.mr;
+    const int NR = kern.nr;
+
+    // Block sizes, tuned per machine (see tuning.h). MC and NC are rounded to
+    // whole micro-panels so only the last block of the matrix can end in a
+    // partial panel.
+    const BlockingParams blocking = blocking_params();
+    const int MC = std::max(MR, blocking.mc / MR * MR); // Block size for M
+    const int KC = packed_b ? packed_b->kc() : std::max(1, blocking.kc); // Block size for K
+    const int NC = std::max(NR, blocking.nc / NR * NR); // Block size for N
+
+    // Called from inside a parallel region (batched GEMM, Strassen tasks): the
+    // nested region below only gets one thread, so block for one thread.
+    int num_threads = team_threads > 0 ? team_threads : (omp_in_parallel() ? 1 : omp_get_max_threads());
+
+    // Shrink MC so that there is at least one A block per thread (rounded to the
+    // MR-row micro-panel), otherwise mid-sized m leaves most threads idle.
+    int rows_per_thread = (m + num_threads - 1) / num_threads;
+    int mc = std::min(MC, std::max(MR, (rows_per_thread + MR - 1) / MR * MR));
+    int num_ic = (m + mc - 1) / mc;
+
+    // If there are still fewer A blocks than threads, also split the jr loop.
+    // Threads sharing an A block each pack their own copy (cheap next to compute).
+    int num_jr = std::max(1, std::min(num_threads / num_ic, NC / NR));
+
+    // Shared packed B panel (KC x NC), laid out as consecutive kb x NR strips.
+    // Packing buffers come from the calling thread's pool (aligned_buffer.h) and
+    // only ever grow, so back-to-back calls (e.g. a batch of small products) never
+    // go back to the allocator. In the NUMA mode the caller is the master of
+    // its node's team, so each node packs into its own (node-local) replica.
+    float* B_packed = packed_b ? nullptr : packing_buffer(PackSlot::B, (size_t)KC * NC);
+
+    const bool timed = g_phase_timing.load(std::memory_order_relaxed);
+    long long call_start = phase_now(timed);
+
+    #pragma omp parallel num_threads(num_threads) if(num_threads > 1)
+    {
+        NumaThreadBinding binding(bind_cpus ? *bind_cpus : std::vector<int>());
+        long long pack_a_ns = 0, pack_b_ns = 0, compute_ns = 0; // This thread's share
+
+        // Private packed A block (MC x KC), laid out as consecutive kb x MR column panels.
+        float* A_packed = packing_buffer(PackSlot::A, (size_t)mc * KC);
+
+        for (int j = 0; j < p; j += NC) {
+            int jb = std::min(NC, p - j);
+            int num_strips = (jb + NR - 1) / NR; // Last strip may be partial (zero-padded)
+
+            for (int k = 0; k < n; k += KC) {
+                int kb = std::min(KC, n - k);
+                float beta_k = (k == 0) ? beta : 1.0f;
+                bool last_k = (k + kb >= n);
+
+                // Pack B (kb x jb) cooperatively, one NR-column strip per iteration.
+                // A pre-packed B already has this panel in place.
+                const float* B_panel = packed_b ? packed_b->panel(k, j) : B_packed;
+                if (!packed_b) {
+                    long long t0 = phase_now(timed);
+                    #pragma omp for schedule(static) nowait
+                    for (int s = 0; s < num_strips; ++s) {
+                        int nr = std::min(NR, jb - s * NR);
+                        pack_B(kb, &B[(long long)k * rsb + (long long)(j + s * NR) * csb], rsb, csb,
+                               &B_packed[s * NR * kb], nr, NR);
                     }
-                    pack_B(kb, &B[(k * p) + (j + jj)], p, &B_packed[0]);
+                    pack_b_ns += phase_now(timed) - t0;
+                    // The whole panel is packed before anyone uses it.
+                    #pragma omp barrier
+                }
+
+                int strips_per_jr = (num_strips + num_jr - 1) / num_jr;
+
+                #pragma omp for collapse(2) schedule(dynamic)
+                for (int ic = 0; ic < num_ic; ++ic) {
+                    for (int jr = 0; jr < num_jr; ++jr) {
+                        int s_begin = jr * strips_per_jr;
+                        int s_end = std::min(num_strips, s_begin + strips_per_jr);
+                        if (s_begin >= s_end) continue;
 
-                    for (int ii = 0; ii < ib; ii += 8) {
-                        if (ii + 8 > ib) continue;
-                        
-                        // Pack A strip (8 x kb)
-                        pack_A(kb, &A[(i + ii) * n + k], n, &A_packed[0]);
+                        int i = ic * mc;
+                        int ib = std::min(mc, m - i);
+                        int num_panels = (ib + MR - 1) / MR; // Last panel may be partial (zero-padded)
 
-                        // Kernel
-                        kernel_8x8(kb, &A_packed[0], &B_packed[0], &C[(i + ii) * p + (j + jj)], p);
+                        // Pack A block (ib x kb) -> per-thread buffer
+                        long long t1 = phase_now(timed);
+                        for (int r = 0; r < num_panels; ++r) {
+                            int mr = std::min(MR, ib - r * MR);
+                            pack_A(kb, &A[(long long)(i + r * MR) * rsa + (long long)k * csa], rsa, csa,
+                                   &A_packed[r * MR * kb], mr, MR, alpha);
+                        }
+                        long long t2 = phase_now(timed);
+                        pack_a_ns += t2 - t1;
+
+                        // Inner loops over micro-blocks (MR x NR).
+                        // Border tiles pass mr/nr < MR/NR and take the masked store path.
+                        for (int s = s_begin; s < s_end; ++s) {
+                            int nr = std::min(NR, jb - s * NR);
+                            for (int r = 0; r < num_panels; ++r) {
+                                int mr = std::min(MR, ib - r * MR);
+                                float* c_tile = &C[(long long)(i + r * MR) * ldc + (j + s * NR)];
+                                if (epilogue && last_k) {
+                                    kern.kernel_epilogue(kb, &A_packed[r * MR * kb], &B_panel[s * NR * kb], c_tile,
+                                                         ldc, mr, nr, beta_k, *epilogue, i + r * MR, j + s * NR);
+                                } else {
+                                    kern.kernel(kb, &A_packed[r * MR * kb], &B_panel[s * NR * kb], c_tile, ldc,
+                                                mr, nr, beta_k);
+                                }
+                            }
+                        }
+                        compute_ns += phase_now(timed) - t2;
                     }
                 }
+                // Implicit barrier: compute is done before the next B panel overwrites this one.
             }
         }
+
+        if (timed) {
+            g_pack_a_ns += pack_a_ns;
+            g_pack_b_ns += pack_b_ns;
+            g_compute_ns += compute_ns;
+        }
     }
-    
-    // Handle edges (naive fallback for remaining elements)
-    // This is a "massive project" so we should handle it, but for brevity in the demo code:
-    // We will just run a cleanup pass or ensure inputs are multiples of 8 in benchmark.
-    // Let's add a cleanup pass using the naive implementation for the whole matrix?
-    // No, that's slow.
-    // We'll just say "Optimized (8x8 aligned)" and require multiples of 8 for peak perf.
-    // But to be correct, we should handle edges.
-    // Let's just leave it as is for the "Optimized" core, and maybe the benchmark will show 0 for edges if we don't handle them.
-    // Actually, let's just call naive for the whole thing if not multiple of 8, to ensure correctness.
-    if (m % 8 != 0 || n % 8 != 0 || p % 8 != 0) {
-        // Fallback
-        // We can't easily mix and match without complex logic.
-        // So we'll just run naive on the whole thing if not aligned.
-        // This is a valid strategy for a "demo" of the kernel.
-        matmul_naive(A, B, C, m, n, p);
+
+    if (timed) {
+        g_wall_ns += phase_now(timed) - call_start;
+        ++g_calls;
     }
 }
+
+// BLAS-style entry point (row-major): C = alpha * op(A) * op(B) + beta * C,
+// op(A) is m x k, op(B) is k x n. Transposes are handled inside the packing, so
+// transposed operands are never copied.
+void sgemm(char transA, char transB, int m, int n, int k, float alpha,
+           const float* A, int lda, const float* B, int ldb, float beta, float* C, int ldc) {
+    bool ta = (transA == 'T' || transA == 't' || transA == 'C' || transA == 'c');
+    bool tb = (transB == 'T' || transB == 't' || transB == 'C' || transB == 'c');
+    sgemm_driver(m, k, n, alpha,
+                 A, ta ? 1 : lda, ta ? lda : 1,
+                 B, tb ? 1 : ldb, tb ? ldb : 1,
+                 beta, C, ldc);
+}
+
+// sgemm followed by a fused epilogue (see sgemm.h)
+void sgemm_epilogue(char transA, char transB, int m, int n, int k, float alpha,
+                    const float* A, int lda, const float* B, int ldb, float beta, float* C, int ldc,
+                    const SgemmEpilogue& epilogue) {
+    bool ta = (transA == 'T' || transA == 't' || transA == 'C' || transA == 'c');
+    bool tb = (transB == 'T' || transB == 't' || transB == 'C' || transB == 'c');
+    sgemm_driver(m, k, n, alpha,
+                 A, ta ? 1 : lda, ta ? lda : 1,
+                 B, tb ? 1 : ldb, tb ? ldb : 1,
+                 beta, C, ldc, 0, nullptr, &epilogue);
+}
+
+// Strided form: C += A * B on row-major views with leading dimensions lda/ldb/ldc,
+// so callers (e.g. the Strassen leaves) can pass sub-matrices without copying.
+void matmul_optimized_sgemm_strided(const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                                    int m, int n, int p) {
+    sgemm_driver(m, n, p, 1.0f, A, lda, 1, B, ldb, 1, 1.0f, C, ldc);
+}
+
+// Same on an explicit team of num_threads threads bound to a NUMA node (see numa.h)
+void matmul_optimized_sgemm_strided_team(const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                                         int m, int n, int p, int num_threads, int numa_node) {
+    const NumaTopology& topo = numa_topology();
+    const std::vector<int>* cpus =
+        (numa_node >= 0 && topo.num_nodes > 1 && numa_node < topo.num_nodes) ? &topo.node_cpus[numa_node] : nullptr;
+    sgemm_driver(m, n, p, 1.0f, A, lda, 1, B, ldb, 1, 1.0f, C, ldc, num_threads, cpus);
+}
+
+// ... or bound to an explicit CPU set (async lanes)
+void matmul_optimized_sgemm_strided_team(const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                                         int m, int n, int p, int num_threads, const std::vector<int>& cpus) {
+    sgemm_driver(m, n, p, 1.0f, A, lda, 1, B, ldb, 1, 1.0f, C, ldc, num_threads, cpus.empty() ? nullptr : &cpus);
+}
+
+// Mixed precision (see mixed_precision.h): same driver, the half-precision
+// operands are widened to float while packing.
+void matmul_bf16_strided(const bfloat16* A, int lda, const bfloat16* B, int ldb, float* C, int ldc,
+                         int m, int n, int p) {
+    sgemm_driver(m, n, p, 1.0f, A, lda, 1, B, ldb, 1, 1.0f, C, ldc);
+}
+
+void matmul_fp16_strided(const float16* A, int lda, const float16* B, int ldb, float* C, int ldc,
+                         int m, int n, int p) {
+    sgemm_driver(m, n, p, 1.0f, A, lda, 1, B, ldb, 1, 1.0f, C, ldc);
+}
+
+void matmul_optimized_sgemm(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+    matmul_optimized_sgemm_strided(A.data(), n, B.data(), p, C.data(), p, m, n, p);
+}
+
+// Pre-packed B (see packed_matrix.h). Packing is the driver's pack_B, run for
+// every KC block and NR strip of the whole matrix, in parallel.
+bool PackedMatrix::pack(const float* B, int ldb, int rows, int cols, bool transposed) {
+    clear();
+    if (!B || rows <= 0 || cols <= 0) return false;
+
+    const SgemmKernel& kern = sgemm_kernel();
+    rows_ = rows;
+    cols_ = cols;
+    kc_ = std::max(1, blocking_params().kc);
+    nr_ = kern.nr;
+    kernel_ = kern.name;
+    data_.resize((size_t)rows * padded_cols());
+
+    const int rs = transposed ? 1 : ldb;
+    const int cs = transposed ? ldb : 1;
+    const int num_blocks = (rows + kc_ - 1) / kc_;
+    const int num_strips = padded_cols() / nr_;
+
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (int b = 0; b < num_blocks; ++b) {
+        for (int s = 0; s < num_strips; ++s) {
+            int k = b * kc_;
+            int j = s * nr_;
+            int kb = std::min(kc_, rows - k);
+            int nr = std::min(nr_, cols - j);
+            pack_B(kb, &B[(long long)k * rs + (long long)j * cs], rs, cs,
+                   data_.data() + (size_t)k * padded_cols() + (size_t)j * kb, nr, nr_);
+        }
+    }
+    return true;
+}
+
+bool PackedMatrix::matches_kernel() const {
+    const SgemmKernel& kern = sgemm_kernel();
+    return !empty() && nr_ == kern.nr && kernel_ == kern.name;
+}
+
+bool sgemm_prepacked(char transA, int m, float alpha, const float* A, int lda, const PackedMatrix& B,
+                     float beta, float* C, int ldc, const SgemmEpilogue* epilogue) {
+    if (!B.matches_kernel()) return false;
+    bool ta = (transA == 'T' || transA == 't' || transA == 'C' || transA == 'c');
+    sgemm_driver<float, float>(m, B.rows(), B.cols(), alpha,
+                               A, ta ? 1 : lda, ta ? lda : 1,
+                               nullptr, 0, 0,
+                               beta, C, ldc, 0, nullptr, epilogue, &B);
+    return true;
+}
+
+bool matmul_prepacked(const float* A, int lda, const PackedMatrix& B, float* C, int ldc, int m) {
+    return sgemm_prepacked('N', m, 1.0f, A, lda, B, 1.0f, C, ldc);
+}
+
+void matmul_optimized_sgemm_epilogue(const float* A, const float* B, float* C, int m, int n, int p,
+                                     const SgemmEpilogue& epilogue) {
+    sgemm_driver(m, n, p, 1.0f, A, n, 1, B, p, 1, 1.0f, C, p, 0, nullptr, &epilogue);
+}
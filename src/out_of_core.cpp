@@ -0,0 +1,286 @@
+#include "../include/out_of_core.h"
+#include "../include/sgemm.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MATMUL_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char MATRIX_FILE_MAGIC[8] = {'M', 'A', 'T', 'F', '3', '2', 0, 0};
+
+static MatrixFileHeader make_header(long long rows, long long cols) {
+    MatrixFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+    header.rows = (uint64_t)rows;
+    header.cols = (uint64_t)cols;
+    return header;
+}
+
+MappedMatrix::~MappedMatrix() {
+    close();
+}
+
+#ifdef MATMUL_HAVE_MMAP
+static size_t page_size() {
+    static const size_t size = (size_t)sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+bool MappedMatrix::create(const std::string& path, long long rows, long long cols) {
+    close();
+    if (rows <= 0 || cols <= 0) return false;
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    size_t bytes = MATRIX_FILE_HEADER_BYTES + (size_t)rows * cols * sizeof(float);
+    MatrixFileHeader header = make_header(rows, cols);
+    // ftruncate leaves a sparse file: the data reads as zeros and costs no I/O
+    if (ftruncate(fd, (off_t)bytes) != 0 ||
+        pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        ::close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    map_ = map;
+    map_bytes_ = bytes;
+    data_ = (float*)((char*)map + MATRIX_FILE_HEADER_BYTES);
+    rows_ = rows;
+    cols_ = cols;
+    writable_ = true;
+    return true;
+}
+
+bool MappedMatrix::open(const std::string& path, bool writable) {
+    close();
+    int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) return false;
+
+    MatrixFileHeader header;
+    struct stat st;
+    bool valid = pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                 std::memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.rows > 0 && header.cols > 0 && fstat(fd, &st) == 0;
+    size_t bytes = valid ? MATRIX_FILE_HEADER_BYTES + (size_t)(header.rows * header.cols * sizeof(float)) : 0;
+    if (!valid || (size_t)st.st_size < bytes) {
+        ::close(fd);
+        return false;
+    }
+
+    void* map = mmap(nullptr, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    map_ = map;
+    map_bytes_ = bytes;
+    data_ = (float*)((char*)map + MATRIX_FILE_HEADER_BYTES);
+    rows_ = (long long)header.rows;
+    cols_ = (long long)header.cols;
+    writable_ = writable;
+    return true;
+}
+
+void MappedMatrix::close() {
+    if (map_) munmap(map_, map_bytes_);
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    map_ = nullptr;
+    map_bytes_ = 0;
+    data_ = nullptr;
+    rows_ = cols_ = 0;
+    writable_ = false;
+}
+
+void MappedMatrix::prefetch(long long row, long long num_rows, long long col, long long num_cols) const {
+    if (!data_ || num_rows <= 0 || num_cols <= 0) return;
+    const size_t page = page_size();
+
+    // Full rows are one contiguous range; otherwise one range per row segment
+    bool contiguous = (col == 0 && num_cols == cols_);
+    long long segments = contiguous ? 1 : num_rows;
+    size_t segment_bytes = (contiguous ? (size_t)num_rows * cols_ : (size_t)num_cols) * sizeof(float);
+
+    // First queue readahead for the whole block, then fault it in page by page
+    // (by then most of it is on its way, so the reads overlap).
+    for (int pass = 0; pass < 2; ++pass) {
+        for (long long r = 0; r < segments; ++r) {
+            const char* begin = (const char*)(data_ + (row + r) * cols_ + col);
+            const char* end = begin + segment_bytes;
+            const char* aligned = (const char*)((uintptr_t)begin & ~(uintptr_t)(page - 1));
+            if (pass == 0) {
+                madvise((void*)aligned, (size_t)(end - aligned), MADV_WILLNEED);
+            } else {
+                volatile char sink = 0;
+                for (const char* addr = std::max(aligned, (const char*)map_); addr < end; addr += page) {
+                    sink += *(const volatile char*)addr;
+                }
+                (void)sink;
+            }
+        }
+    }
+}
+
+void MappedMatrix::write_back(long long row, long long num_rows) {
+    if (!data_ || !writable_ || num_rows <= 0) return;
+    size_t offset = MATRIX_FILE_HEADER_BYTES + (size_t)row * cols_ * sizeof(float);
+    size_t bytes = (size_t)num_rows * cols_ * sizeof(float);
+#ifdef __linux__
+    sync_file_range(fd_, (off_t)offset, (off_t)bytes, SYNC_FILE_RANGE_WRITE);
+#else
+    const size_t page = page_size();
+    size_t aligned = offset & ~(page - 1);
+    msync((char*)map_ + aligned, offset + bytes - aligned, MS_ASYNC);
+#endif
+}
+
+bool MappedMatrix::sync() {
+    if (!map_) return false;
+    return !writable_ || msync(map_, map_bytes_, MS_SYNC) == 0;
+}
+
+static size_t physical_memory_bytes() {
+    long pages = sysconf(_SC_PHYS_PAGES);
+    return pages > 0 ? (size_t)pages * page_size() : (size_t)4 << 30;
+}
+#else
+// No mmap: out-of-core mode not available
+bool MappedMatrix::create(const std::string&, long long, long long) { return false; }
+bool MappedMatrix::open(const std::string&, bool) { return false; }
+void MappedMatrix::close() {}
+void MappedMatrix::prefetch(long long, long long, long long, long long) const {}
+void MappedMatrix::write_back(long long, long long) {}
+bool MappedMatrix::sync() { return false; }
+
+static size_t physical_memory_bytes() {
+    return (size_t)4 << 30;
+}
+#endif
+
+bool write_matrix_file(const std::string& path, const Matrix& mat, int rows, int cols) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    MatrixFileHeader header = make_header(rows, cols);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)mat.data(), (std::streamsize)((size_t)rows * cols * sizeof(float)));
+    return (bool)out;
+}
+
+bool read_matrix_file(const std::string& path, Matrix& mat, int& rows, int& cols) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    MatrixFileHeader header;
+    if (!in.read((char*)&header, sizeof(header)) ||
+        std::memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.rows == 0 || header.cols == 0 || header.rows * header.cols > (uint64_t)INT_MAX) {
+        return false;
+    }
+    rows = (int)header.rows;
+    cols = (int)header.cols;
+    mat.resize((size_t)rows * cols);
+    return (bool)in.read((char*)mat.data(), (std::streamsize)(mat.size() * sizeof(float)));
+}
+
+static size_t streaming_budget(const StreamingOptions& options) {
+    if (options.memory_budget > 0) return options.memory_budget;
+    const char* env = std::getenv("MATMUL_OOC_BUDGET_MB");
+    if (env && std::atoll(env) > 0) return (size_t)std::atoll(env) << 20;
+    return physical_memory_bytes() / 4;
+}
+
+namespace {
+struct StreamStep {
+    long long i, j, k; // Origin of the A panel (i, k) and the B panel (k, j)
+    int ib, jb, kb;
+};
+}
+
+bool matmul_streaming(const MappedMatrix& A, const MappedMatrix& B, MappedMatrix& C,
+                      const StreamingOptions& options, StreamingStats* stats) {
+    const long long m = A.rows(), n = A.cols(), p = B.cols();
+    if (!A.is_open() || !B.is_open() || !C.is_open() || !C.writable()) return false;
+    if (B.rows() != n || C.rows() != m || C.cols() != p) return false;
+    // The in-memory driver takes int leading dimensions
+    if (n > INT_MAX || p > INT_MAX) return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Largest T (multiple of 256) with 12 T^2 bytes <= budget
+    long long tile = (long long)std::sqrt((double)streaming_budget(options) / 12.0) / 256 * 256;
+    tile = std::max(256LL, tile);
+    long long depth = tile / 2;
+
+    std::vector<StreamStep> steps;
+    for (long long j = 0; j < p; j += tile) {
+        for (long long i = 0; i < m; i += tile) {
+            for (long long k = 0; k < n; k += depth) {
+                steps.push_back({i, j, k, (int)std::min(tile, m - i), (int)std::min(tile, p - j),
+                                 (int)std::min(depth, n - k)});
+            }
+        }
+    }
+
+    // Panels of a step; the C tile is read when its K loop starts
+    auto prefetch_step = [&A, &B, &C](const StreamStep& s) {
+        A.prefetch(s.i, s.ib, s.k, s.kb);
+        B.prefetch(s.k, s.kb, s.j, s.jb);
+        if (s.k == 0) C.prefetch(s.i, s.ib, s.j, s.jb);
+    };
+
+    double io_wait = 0.0;
+    auto wait_for = [&io_wait](std::future<void>& pending) {
+        auto t0 = std::chrono::steady_clock::now();
+        pending.wait();
+        io_wait += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    };
+
+    std::future<void> pending;
+    if (options.prefetch && !steps.empty()) {
+        pending = std::async(std::launch::async, prefetch_step, steps[0]);
+    }
+
+    for (size_t t = 0; t < steps.size(); ++t) {
+        const StreamStep& s = steps[t];
+        if (pending.valid()) wait_for(pending);
+        // Read the next panels while this one is computed
+        if (options.prefetch && t + 1 < steps.size()) {
+            pending = std::async(std::launch::async, prefetch_step, steps[t + 1]);
+        }
+
+        matmul_optimized_sgemm_strided(A.data() + s.i * n + s.k, (int)n, B.data() + s.k * p + s.j, (int)p,
+                                       C.data() + s.i * p + s.j, (int)p, s.ib, s.kb, s.jb);
+
+        // C tile complete: start writing it back
+        if (s.k + s.kb == n) C.write_back(s.i, s.ib);
+    }
+    if (pending.valid()) wait_for(pending);
+
+    if (stats) {
+        stats->tile = (int)tile;
+        stats->depth = (int)depth;
+        stats->steps = (long long)steps.size();
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats->io_wait_seconds = io_wait;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#include "../include/packed_matrix.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+// File format: 64-byte header, then the packed panels (float32, native byte order)
+struct PackedFileHeader {
+    char magic[8];      // "MATPK32\0"
+    char kernel[32];    // Micro-kernel name, NUL-terminated
+    int32_t rows;
+    int32_t cols;
+    int32_t kc;
+    int32_t nr;
+    uint8_t reserved[8];
+};
+
+static const char PACKED_FILE_MAGIC[8] = {'M', 'A', 'T', 'P', 'K', '3', '2', 0};
+
+void PackedMatrix::clear() {
+    rows_ = cols_ = kc_ = nr_ = 0;
+    kernel_.clear();
+    data_.clear();
+}
+
+bool PackedMatrix::save(const std::string& path) const {
+    if (empty() || kernel_.size() >= sizeof(PackedFileHeader::kernel)) return false;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    PackedFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, PACKED_FILE_MAGIC, sizeof(header.magic));
+    std::memcpy(header.kernel, kernel_.c_str(), kernel_.size());
+    header.rows = rows_;
+    header.cols = cols_;
+    header.kc = kc_;
+    header.nr = nr_;
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)data_.data(), (std::streamsize)bytes());
+    return (bool)out;
+}
+
+bool PackedMatrix::load(const std::string& path) {
+    clear();
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    PackedFileHeader header;
+    if (!in.read((char*)&header, sizeof(header)) ||
+        std::memcmp(header.magic, PACKED_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.rows <= 0 || header.cols <= 0 || header.kc <= 0 || header.nr <= 0) {
+        return false;
+    }
+    header.kernel[sizeof(header.kernel) - 1] = 0;
+
+    rows_ = header.rows;
+    cols_ = header.cols;
+    kc_ = header.kc;
+    nr_ = header.nr;
+    kernel_ = header.kernel;
+    data_.resize((size_t)rows_ * padded_cols());
+    // Panels for another micro-kernel have the wrong strip width: reject them
+    // here rather than on first use.
+    if (!in.read((char*)data_.data(), (std::streamsize)bytes()) || !matches_kernel()) {
+        clear();
+        return false;
+    }
+    return true;
+}
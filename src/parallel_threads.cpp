@@ -1,40 +1,44 @@
 #include "../include/matrix_utils.h"
-#include <thread>
-#include <vector>
+#include "../include/thread_pool.h"
+#include <algorithm>
 
 // Multi-threaded Implementation using std::thread
-// Manually manages threads to parallelize the outer loop.
-void matmul_parallel_threads(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+// Runs on a persistent worker pool (thread_pool.h) instead of spawning and joining
+// fresh threads on every call, which for 128-512 sized products cost about as
+// much as the math itself.
+//
+// C is cut into 2-D tiles of TILE_M x TILE_N; each tile is one task and the pool
+// balances them with work stealing. Splitting columns too keeps every thread busy
+// when m is small or not divisible by the thread count.
+const int TILE_M = 32;
+const int TILE_N = 256;
+
+// num_threads: threads to use for this call (0 = whole pool). Never uses more
+// threads than there are tiles, so small products stay on few cores.
+void matmul_parallel_threads_n(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p, int num_threads) {
     // We assume C is zeroed.
-    
-    int num_threads = std::thread::hardware_concurrency();
-    if (num_threads == 0) num_threads = 4; // Fallback
+    if (m <= 0 || p <= 0) return;
 
-    std::vector<std::thread> threads;
-    int chunk_size = m / num_threads;
-    int remainder = m % num_threads;
+    int tiles_m = (m + TILE_M - 1) / TILE_M;
+    int tiles_n = (p + TILE_N - 1) / TILE_N;
 
-    int start_row = 0;
-    for (int t = 0; t < num_threads; ++t) {
-        int rows_for_thread = chunk_size + (t < remainder ? 1 : 0);
-        int end_row = start_row + rows_for_thread;
+    ThreadPool::global().parallel_for(tiles_m * tiles_n, [&](int tile) {
+        int i0 = (tile / tiles_n) * TILE_M;
+        int j0 = (tile % tiles_n) * TILE_N;
+        int i_max = std::min(i0 + TILE_M, m);
+        int j_max = std::min(j0 + TILE_N, p);
 
-        if (rows_for_thread > 0) {
-            threads.emplace_back([=, &A, &B, &C]() {
-                for (int i = start_row; i < end_row; ++i) {
-                    for (int k = 0; k < n; ++k) {
-                        float a_val = A[i * n + k];
-                        for (int j = 0; j < p; ++j) {
-                            C[i * p + j] += a_val * B[k * p + j];
-                        }
-                    }
+        for (int i = i0; i < i_max; ++i) {
+            for (int k = 0; k < n; ++k) {
+                float a_val = A[i * n + k];
+                for (int j = j0; j < j_max; ++j) {
+                    C[i * p + j] += a_val * B[k * p + j];
                 }
-            });
+            }
         }
-        start_row = end_row;
-    }
+    }, num_threads);
+}
 
-    for (auto& th : threads) {
-        if (th.joinable()) th.join();
-    }
+void matmul_parallel_threads(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+    matmul_parallel_threads_n(A, B, C, m, n, p, 0);
 }
@@ -0,0 +1,196 @@
+#include "../include/perf_counters.h"
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+const char* perf_event_name(PerfEvent event) {
+    switch (event) {
+        case PerfEvent::Cycles: return "cycles";
+        case PerfEvent::Instructions: return "instructions";
+        case PerfEvent::L1DMisses: return "L1D-misses";
+        case PerfEvent::LLCMisses: return "LLC-misses";
+        case PerfEvent::DTLBMisses: return "dTLB-misses";
+        case PerfEvent::FpScalar: return "fp-scalar";
+        case PerfEvent::FpPacked128: return "fp-128b";
+        case PerfEvent::FpPacked256: return "fp-256b";
+        case PerfEvent::FpPacked512: return "fp-512b";
+        default: return "?";
+    }
+}
+
+double PerfSample::fp_ops() const {
+    if (!has(PerfEvent::FpScalar) || !has(PerfEvent::FpPacked128) || !has(PerfEvent::FpPacked256)) return -1.0;
+    double ops = (double)(*this)[PerfEvent::FpScalar] + 4.0 * (*this)[PerfEvent::FpPacked128] +
+                 8.0 * (*this)[PerfEvent::FpPacked256];
+    if (has(PerfEvent::FpPacked512)) ops += 16.0 * (*this)[PerfEvent::FpPacked512];
+    return ops;
+}
+
+// The FP_ARITH_INST_RETIRED raw encodings are Intel-specific (Broadwell and later)
+static bool is_intel_cpu() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) return false;
+    char vendor[13];
+    std::memcpy(vendor, &ebx, 4);
+    std::memcpy(vendor + 4, &edx, 4);
+    std::memcpy(vendor + 8, &ecx, 4);
+    vendor[12] = 0;
+    return std::strcmp(vendor, "GenuineIntel") == 0;
+#else
+    return false;
+#endif
+}
+
+#ifdef __linux__
+static int open_event(PerfEvent event) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.inherit = 1;          // Also count threads created later
+    attr.exclude_kernel = 1;   // Allowed with perf_event_paranoid <= 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    auto cache_event = [](unsigned cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    };
+    // FP_ARITH_INST_RETIRED: event 0xC7, umask selects the width
+    auto fp_event = [](unsigned umask) { return 0xC7u | (umask << 8); };
+
+    switch (event) {
+        case PerfEvent::Cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfEvent::Instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfEvent::L1DMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache_event(PERF_COUNT_HW_CACHE_L1D);
+            break;
+        case PerfEvent::LLCMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache_event(PERF_COUNT_HW_CACHE_LL);
+            break;
+        case PerfEvent::DTLBMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache_event(PERF_COUNT_HW_CACHE_DTLB);
+            break;
+        case PerfEvent::FpScalar:
+        case PerfEvent::FpPacked128:
+        case PerfEvent::FpPacked256:
+        case PerfEvent::FpPacked512: {
+            if (!is_intel_cpu()) return -1;
+            static const unsigned umasks[] = {0x02, 0x08, 0x20, 0x80};
+            attr.type = PERF_TYPE_RAW;
+            attr.config = fp_event(umasks[(int)event - (int)PerfEvent::FpScalar]);
+            break;
+        }
+        default:
+            return -1;
+    }
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+PerfCounters::PerfCounters() {
+    for (int e = 0; e < (int)PerfEvent::Count; ++e) {
+#ifdef __linux__
+        fds_[e] = open_event((PerfEvent)e);
+#else
+        fds_[e] = -1;
+#endif
+    }
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int fd : fds_) {
+        if (fd >= 0) close(fd);
+    }
+#endif
+}
+
+bool PerfCounters::available() const {
+    for (int fd : fds_) {
+        if (fd >= 0) return true;
+    }
+    return false;
+}
+
+bool PerfCounters::available(PerfEvent event) const {
+    return fds_[(int)event] >= 0;
+}
+
+std::string PerfCounters::status() const {
+    std::string opened, missing;
+    for (int e = 0; e < (int)PerfEvent::Count; ++e) {
+        std::string& list = (fds_[e] >= 0) ? opened : missing;
+        if (!list.empty()) list += " ";
+        list += perf_event_name((PerfEvent)e);
+    }
+    if (opened.empty()) return "no hardware counters available";
+    return missing.empty() ? opened : opened + " (unavailable: " + missing + ")";
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+    for (int fd : fds_) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+PerfSample PerfCounters::stop() {
+    PerfSample sample;
+    for (int e = 0; e < (int)PerfEvent::Count; ++e) {
+        sample.values[e] = -1;
+#ifdef __linux__
+        int fd = fds_[e];
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        unsigned long long data[3]; // value, time enabled, time running
+        if (read(fd, data, sizeof(data)) != (ssize_t)sizeof(data)) continue;
+        // Scale up if the kernel multiplexed the event with others
+        if (data[2] == 0) continue;
+        sample.values[e] = (data[2] < data[1]) ? (long long)((double)data[0] * data[1] / data[2]) : (long long)data[0];
+#endif
+    }
+    return sample;
+}
+
+PerfReport make_perf_report(const PerfSample& sample, double flops, double peak_flops_per_cycle) {
+    PerfReport report = {-1.0, -1.0, -1.0, -1.0, -1.0};
+    double kflops = flops / 1000.0;
+    bool cycles = sample.has(PerfEvent::Cycles) && sample[PerfEvent::Cycles] > 0;
+
+    if (cycles && sample.has(PerfEvent::Instructions)) {
+        report.ipc = (double)sample[PerfEvent::Instructions] / sample[PerfEvent::Cycles];
+    }
+    if (sample.has(PerfEvent::L1DMisses)) report.l1d_miss_per_kflop = sample[PerfEvent::L1DMisses] / kflops;
+    if (sample.has(PerfEvent::LLCMisses)) report.llc_miss_per_kflop = sample[PerfEvent::LLCMisses] / kflops;
+    if (sample.has(PerfEvent::DTLBMisses)) report.dtlb_miss_per_kflop = sample[PerfEvent::DTLBMisses] / kflops;
+    if (cycles && peak_flops_per_cycle > 0) {
+        // Prefer the retired FP operations (includes wasted padding lanes), fall
+        // back to the algorithmic 2mnp
+        double ops = sample.fp_ops();
+        if (ops < 0) ops = flops;
+        report.fma_utilization = ops / (sample[PerfEvent::Cycles] * peak_flops_per_cycle);
+    }
+    return report;
+}
@@ -0,0 +1,623 @@
+#include "../include/cpu_dispatch.h"
+#include "../include/sgemm.h"
+#include "../include/mixed_precision.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+
+// SGEMM micro-kernels, one per ISA level (see cpu_dispatch.h).
+// All kernels share the same contract, so the packing and blocking driver in
+// optimized_sgemm.cpp is ISA-independent and only reads MR/NR from the descriptor:
+// - A panel: MR-wide column panel, A_packed[p * MR + i]
+// - B panel: NR-wide row panel, B_packed[p * NR + j]
+// - Both panels are zero-padded, C is updated as
+//   C[0:mr, 0:nr] = A_panel * B_panel + beta * C[0:mr, 0:nr], and C is not read when beta == 0.
+
+// How far ahead (in K steps) to prefetch the packed panels.
+const int PREFETCH_DIST = 8;
+
+// Fused epilogue (see sgemm.h)
+// Each kernel has an EPILOGUE template variant: after the K loop it adds the
+// biases, applies the activation and the scale to the accumulator registers and
+// stores the result, instead of a plain store. Float results are stored straight
+// from the registers; 16-bit outputs go through a row of the tile on the stack
+// and the (vectorized) converters of mixed_precision.h.
+
+// GELU, tanh form: x * (1 + tanh(u)) / 2 = x * sigmoid(2u) = x / (1 + exp(-2u))
+const float GELU_K0 = 0.7978845608f; // sqrt(2 / pi)
+const float GELU_K1 = 0.044715f;
+
+float apply_epilogue(float value, const SgemmEpilogue& ep, int row, int col) {
+    if (ep.row_bias) value += ep.row_bias[row];
+    if (ep.col_bias) value += ep.col_bias[col];
+    switch (ep.activation) {
+        case Activation::ReLU:
+            value = value > 0.0f ? value : 0.0f;
+            break;
+        case Activation::Clamp:
+            value = std::min(std::max(value, ep.clamp_min), ep.clamp_max);
+            break;
+        case Activation::GELU: {
+            float u = GELU_K0 * (value + GELU_K1 * value * value * value);
+            value = value / (1.0f + std::exp(-2.0f * u));
+            break;
+        }
+        default:
+            break;
+    }
+    return value * ep.scale;
+}
+
+// Stores `count` finished values of row `row` (columns col..) to the epilogue
+// destination: C (c_row) or the separate output, converted if needed.
+static void store_epilogue_row(const float* values, const SgemmEpilogue& ep, float* c_row, int row, int col,
+                               int count) {
+    if (!ep.output) {
+        std::copy(values, values + count, c_row);
+        return;
+    }
+    size_t offset = (size_t)row * ep.ldo + col;
+    switch (ep.output_type) {
+        case EpilogueOutput::BF16:
+            convert_float_to_bf16(values, (bfloat16*)ep.output + offset, count);
+            break;
+        case EpilogueOutput::FP16:
+            convert_float_to_fp16(values, (float16*)ep.output + offset, count);
+            break;
+        default:
+            std::copy(values, values + count, (float*)ep.output + offset);
+            break;
+    }
+}
+
+// Float destination of row i of the tile (C or the separate float output)
+static inline float* epilogue_float_row(const SgemmEpilogue& ep, float* C, int ldc, int row, int col, int i) {
+    return ep.output ? (float*)ep.output + (size_t)(row + i) * ep.ldo + col : &C[i * ldc];
+}
+
+// exp(x) for |x| <= 88: x = n ln2 + r, exp(r) by a degree-6 polynomial (Cephes
+// expf coefficients, ~1 ulp), times 2^n.
+TARGET_AVX2
+static inline __m256 exp_avx2(__m256 x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.3f)), _mm256_set1_ps(88.3f));
+    __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), r);
+    __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(1.3981999507e-3f));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(8.3334519073e-3f));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(4.1665795894e-2f));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(1.6666665459e-1f));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(5.0000001201e-1f));
+    y = _mm256_fmadd_ps(y, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+    // 2^n: n + 127 into the exponent field
+    __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(e));
+}
+
+TARGET_AVX2
+static inline __m256 activation_avx2(__m256 v, const SgemmEpilogue& ep) {
+    switch (ep.activation) {
+        case Activation::ReLU:
+            return _mm256_max_ps(v, _mm256_setzero_ps());
+        case Activation::Clamp:
+            return _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(ep.clamp_min)), _mm256_set1_ps(ep.clamp_max));
+        case Activation::GELU: {
+            __m256 v2 = _mm256_mul_ps(v, v);
+            __m256 u = _mm256_mul_ps(_mm256_mul_ps(v, _mm256_set1_ps(GELU_K0)),
+                                     _mm256_fmadd_ps(v2, _mm256_set1_ps(GELU_K1), _mm256_set1_ps(1.0f)));
+            __m256 e = exp_avx2(_mm256_mul_ps(u, _mm256_set1_ps(-2.0f)));
+            return _mm256_div_ps(v, _mm256_add_ps(_mm256_set1_ps(1.0f), e));
+        }
+        default:
+            return v;
+    }
+}
+
+// GCC 12 reports the _mm512_undefined_ps() inside the AVX-512 min/max/scalef
+// intrinsics as maybe-uninitialized once they are inlined (GCC bug 105593).
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+TARGET_AVX512
+static inline __m512 exp_avx512(__m512 x) {
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-87.3f)), _mm512_set1_ps(88.3f));
+    __m512 n = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693359375f), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(-2.12194440e-4f), r);
+    __m512 y = _mm512_set1_ps(1.9875691500e-4f);
+    y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(1.3981999507e-3f));
+    y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(8.3334519073e-3f));
+    y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(4.1665795894e-2f));
+    y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(1.6666665459e-1f));
+    y = _mm512_fmadd_ps(y, r, _mm512_set1_ps(5.0000001201e-1f));
+    y = _mm512_fmadd_ps(y, _mm512_mul_ps(r, r), _mm512_add_ps(r, _mm512_set1_ps(1.0f)));
+    return _mm512_scalef_ps(y, n); // y * 2^n
+}
+
+TARGET_AVX512
+static inline __m512 activation_avx512(__m512 v, const SgemmEpilogue& ep) {
+    switch (ep.activation) {
+        case Activation::ReLU:
+            return _mm512_max_ps(v, _mm512_setzero_ps());
+        case Activation::Clamp:
+            return _mm512_min_ps(_mm512_max_ps(v, _mm512_set1_ps(ep.clamp_min)), _mm512_set1_ps(ep.clamp_max));
+        case Activation::GELU: {
+            __m512 v2 = _mm512_mul_ps(v, v);
+            __m512 u = _mm512_mul_ps(_mm512_mul_ps(v, _mm512_set1_ps(GELU_K0)),
+                                     _mm512_fmadd_ps(v2, _mm512_set1_ps(GELU_K1), _mm512_set1_ps(1.0f)));
+            __m512 e = exp_avx512(_mm512_mul_ps(u, _mm512_set1_ps(-2.0f)));
+            return _mm512_div_ps(v, _mm512_add_ps(_mm512_set1_ps(1.0f), e));
+        }
+        default:
+            return v;
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Portable micro-kernel: 4x8 block
+// Plain C++ with fixed trip counts, so the compiler can keep the tile in
+// registers and vectorize it for the baseline ISA (SSE2 on x86-64).
+template <bool EPILOGUE>
+static inline void kernel_4x8_scalar_impl(int k, const float* A, const float* B, float* C, int ldc, int mr, int nr,
+                                          float beta, const SgemmEpilogue* ep, int row, int col) {
+    const int MR = 4, NR = 8;
+    float c[MR][NR] = {};
+
+    for (int p = 0; p < k; ++p) {
+        for (int i = 0; i < MR; ++i) {
+            float a_val = A[p * MR + i];
+            for (int j = 0; j < NR; ++j) {
+                c[i][j] += a_val * B[p * NR + j];
+            }
+        }
+    }
+
+    if (EPILOGUE) {
+        for (int i = 0; i < mr; ++i) {
+            float out[NR];
+            for (int j = 0; j < nr; ++j) {
+                float v = (beta == 0.0f) ? c[i][j] : c[i][j] + beta * C[i * ldc + j];
+                out[j] = apply_epilogue(v, *ep, row + i, col + j);
+            }
+            store_epilogue_row(out, *ep, &C[i * ldc], row + i, col, nr);
+        }
+        return;
+    }
+
+    for (int i = 0; i < mr; ++i) {
+        for (int j = 0; j < nr; ++j) {
+            C[i * ldc + j] = (beta == 0.0f) ? c[i][j] : c[i][j] + beta * C[i * ldc + j];
+        }
+    }
+}
+
+void kernel_4x8_scalar(int k, const float* A, const float* B, float* C, int ldc, int mr, int nr, float beta) {
+    kernel_4x8_scalar_impl<false>(k, A, B, C, ldc, mr, nr, beta, nullptr, 0, 0);
+}
+
+void kernel_4x8_scalar_epilogue(int k, const float* A, const float* B, float* C, int ldc, int mr, int nr, float beta,
+                                const SgemmEpilogue& ep, int row, int col) {
+    kernel_4x8_scalar_impl<true>(k, A, B, C, ldc, mr, nr, beta, &ep, row, col);
+}
+
+// Epilogue store of an MR x 16 AVX2 tile (acc + beta * C -> epilogue -> store)
+template <int MR>
+TARGET_AVX2
+static inline void epilogue_store_avx2(__m256 (&c)[MR][2], float* C, int ldc, int mr, int nr, float beta,
+                                       const SgemmEpilogue& ep, int row, int col) {
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i mask0 = _mm256_cmpgt_epi32(_mm256_set1_epi32(nr), lane);
+    const __m256i mask1 = _mm256_cmpgt_epi32(_mm256_set1_epi32(nr - 8), lane);
+    const __m256 beta_vec = _mm256_set1_ps(beta);
+    const __m256 scale = _mm256_set1_ps(ep.scale);
+    const bool float_out = !ep.output || ep.output_type == EpilogueOutput::Float;
+
+    __m256 col_bias0 = _mm256_setzero_ps(), col_bias1 = _mm256_setzero_ps();
+    if (ep.col_bias) {
+        col_bias0 = _mm256_maskload_ps(ep.col_bias + col, mask0);
+        col_bias1 = _mm256_maskload_ps(ep.col_bias + col + 8, mask1);
+    }
+
+    for (int i = 0; i < mr; ++i) {
+        float* c_row = &C[i * ldc];
+        __m256 v0 = c[i][0], v1 = c[i][1];
+        if (beta != 0.0f) {
+            v0 = _mm256_fmadd_ps(beta_vec, _mm256_maskload_ps(c_row, mask0), v0);
+            v1 = _mm256_fmadd_ps(beta_vec, _mm256_maskload_ps(c_row + 8, mask1), v1);
+        }
+        __m256 row_bias = _mm256_set1_ps(ep.row_bias ? ep.row_bias[row + i] : 0.0f);
+        v0 = _mm256_add_ps(v0, _mm256_add_ps(row_bias, col_bias0));
+        v1 = _mm256_add_ps(v1, _mm256_add_ps(row_bias, col_bias1));
+        v0 = _mm256_mul_ps(activation_avx2(v0, ep), scale);
+        v1 = _mm256_mul_ps(activation_avx2(v1, ep), scale);
+
+        if (float_out) {
+            float* out = epilogue_float_row(ep, C, ldc, row, col, i);
+            _mm256_maskstore_ps(out, mask0, v0);
+            _mm256_maskstore_ps(out + 8, mask1, v1);
+        } else {
+            alignas(32) float values[16];
+            _mm256_store_ps(values, v0);
+            _mm256_store_ps(values + 8, v1);
+            store_epilogue_row(values, ep, c_row, row + i, col, nr);
+        }
+    }
+}
+
+// AVX2 micro-kernel: 6x16 block (MR x NR)
+// Computes C_micro += A_micro * B_micro
+// Registers: 16 YMM registers available in AVX2, 1 YMM = 8 floats.
+// - 12 YMM hold the 6x16 C tile (6 rows x 2 registers per row).
+// - 2 YMM hold the current row of the B panel (16 floats).
+// - 1 YMM holds the broadcast A element.
+// That is 12 FMAs per 2 B loads + 6 broadcasts, enough to keep both FMA ports
+// busy (an 8x8 tile only has 8 independent accumulators, which is less than
+// FMA latency x throughput on Haswell/Zen).
+//
+// Packed layouts (see pack_A / pack_B):
+// - A panel: MR-wide column panel, A_packed[p * MR + i]. The 6 broadcasts for
+//   step p are consecutive floats, so they all come from the same cache line.
+// - B panel: NR-wide row panel, B_packed[p * NR + j].
+// Only the top-left mr x nr corner of the tile is valid (mr <= MR, nr <= NR).
+// The packed panels are zero-padded, so the FMA loop is identical; only the C
+// load/store is masked for border tiles: rows by count, columns with
+// _mm256_maskload_ps/_mm256_maskstore_ps.
+template <bool EPILOGUE>
+TARGET_AVX2
+static inline void kernel_6x16_impl(int k, const float* A, const float* B, float* C, int ldc, int mr, int nr,
+                                    float beta, const SgemmEpilogue* ep, int row, int col) {
+    const int MR = 6, NR = 16;
+
+    // Accumulators start from zero; C is only touched once, after the K loop.
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+    // Pull the C tile towards L1 while we are busy with the K loop.
+    for (int i = 0; i < mr; ++i) {
+        _mm_prefetch((const char*)&C[i * ldc], _MM_HINT_T0);
+        _mm_prefetch((const char*)&C[i * ldc + NR - 1], _MM_HINT_T0);
+    }
+
+    for (int p = 0; p < k; ++p) {
+        _mm_prefetch((const char*)&A[(p + PREFETCH_DIST) * MR], _MM_HINT_T0);
+        _mm_prefetch((const char*)&B[(p + PREFETCH_DIST) * NR], _MM_HINT_T0);
+
+        __m256 b0 = _mm256_loadu_ps(&B[p * NR]);
+        __m256 b1 = _mm256_loadu_ps(&B[p * NR + 8]);
+        const float* a = &A[p * MR];
+        __m256 a_vec;
+
+        a_vec = _mm256_broadcast_ss(&a[0]);
+        c00 = _mm256_fmadd_ps(a_vec, b0, c00); c01 = _mm256_fmadd_ps(a_vec, b1, c01);
+        a_vec = _mm256_broadcast_ss(&a[1]);
+        c10 = _mm256_fmadd_ps(a_vec, b0, c10); c11 = _mm256_fmadd_ps(a_vec, b1, c11);
+        a_vec = _mm256_broadcast_ss(&a[2]);
+        c20 = _mm256_fmadd_ps(a_vec, b0, c20); c21 = _mm256_fmadd_ps(a_vec, b1, c21);
+        a_vec = _mm256_broadcast_ss(&a[3]);
+        c30 = _mm256_fmadd_ps(a_vec, b0, c30); c31 = _mm256_fmadd_ps(a_vec, b1, c31);
+        a_vec = _mm256_broadcast_ss(&a[4]);
+        c40 = _mm256_fmadd_ps(a_vec, b0, c40); c41 = _mm256_fmadd_ps(a_vec, b1, c41);
+        a_vec = _mm256_broadcast_ss(&a[5]);
+        c50 = _mm256_fmadd_ps(a_vec, b0, c50); c51 = _mm256_fmadd_ps(a_vec, b1, c51);
+    }
+
+    __m256 c[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+
+    if (EPILOGUE) {
+        epilogue_store_avx2<MR>(c, C, ldc, mr, nr, beta, *ep, row, col);
+        return;
+    }
+
+    // C = acc + beta * C. beta == 0 never reads C; beta == 1 skips the multiply.
+    const __m256 beta_vec = _mm256_set1_ps(beta);
+    if (mr == MR && nr == NR) {
+        for (int i = 0; i < MR; ++i) {
+            float* row = &C[i * ldc];
+            if (beta == 0.0f) {
+                _mm256_storeu_ps(row, c[i][0]);
+                _mm256_storeu_ps(row + 8, c[i][1]);
+            } else if (beta == 1.0f) {
+                _mm256_storeu_ps(row, _mm256_add_ps(_mm256_loadu_ps(row), c[i][0]));
+                _mm256_storeu_ps(row + 8, _mm256_add_ps(_mm256_loadu_ps(row + 8), c[i][1]));
+            } else {
+                _mm256_storeu_ps(row, _mm256_fmadd_ps(beta_vec, _mm256_loadu_ps(row), c[i][0]));
+                _mm256_storeu_ps(row + 8, _mm256_fmadd_ps(beta_vec, _mm256_loadu_ps(row + 8), c[i][1]));
+            }
+        }
+        return;
+    }
+
+    // Border tile. Lane j is enabled when j < nr (mask lanes need the sign bit set)
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i mask0 = _mm256_cmpgt_epi32(_mm256_set1_epi32(nr), lane);
+    const __m256i mask1 = _mm256_cmpgt_epi32(_mm256_set1_epi32(nr - 8), lane);
+    for (int i = 0; i < mr; ++i) {
+        float* row = &C[i * ldc];
+        __m256 out0 = c[i][0], out1 = c[i][1];
+        if (beta != 0.0f) {
+            out0 = _mm256_fmadd_ps(beta_vec, _mm256_maskload_ps(row, mask0), out0);
+            out1 = _mm256_fmadd_ps(beta_vec, _mm256_maskload_ps(row + 8, mask1), out1);
+        }
+        _mm256_maskstore_ps(row, mask0, out0);
+        if (nr > 8) {
+            _mm256_maskstore_ps(row + 8, mask1, out1);
+        }
+    }
+}
+
+TARGET_AVX2
+void kernel_6x16(int k, const float* A, const float* B, float* C, int ldc, int mr, int nr, float beta) {
+    kernel_6x16_impl<false>(k, A, B, C, ldc, mr, nr, beta, nullptr, 0, 0);
+}
+
+TARGET_AVX2
+void kernel_6x16_epilogue(int k, const float* A, const float* B, float* C, int ldc, int mr, int nr, float beta,
+                          const SgemmEpilogue& ep, int row, int col) {
+    kernel_6x16_impl<true>(k, A, B, C, ldc, mr, nr, beta, &ep, row, col);
+}
+
+// Epilogue store of an MR x 32 AVX-512 tile
+template <int MR>
+TARGET_AVX512
+static inline void epilogue_store_avx512(__m512 (&c)[MR][2], float* C, int ldc, int mr, int nr, float beta,
+                                         const SgemmEpilogue& ep, int row, int col) {
+    __mmask16 mask0 = (nr >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << nr) - 1);
+    __mmask16 mask1 = (nr <= 16) ? (__mmask16)0 : (nr >= 32) ? (__mmask16)0xFFFF : (__mmask16)((1u << (nr - 16)) - 1);
+    const __m512 beta_vec = _mm512_set1_ps(beta);
+    const __m512 scale = _mm512_set1_ps(ep.scale);
+    const bool float_out = !ep.output || ep.output_type == EpilogueOutput::Float;
+
+    __m512 col_bias0 = _mm512_setzero_ps(), col_bias1 = _mm512_setzero_ps();
+    if (ep.col_bias) {
+        col_bias0 = _mm512_maskz_loadu_ps(mask0, ep.col_bias + col);
+        col_bias1 = _mm512_maskz_loadu_ps(mask1, ep.col_bias + col + 16);
+    }
+
+    for (int i = 0; i < mr; ++i) {
+        float* c_row = &C[i * ldc];
+        __m512 v0 = c[i][0], v1 = c[i][1];
+        if (beta != 0.0f) {
+            v0 = _mm512_fmadd_ps(beta_vec, _mm512_maskz_loadu_ps(mask0, c_row), v0);
+            v1 = _mm512_fmadd_ps(beta_vec, _mm512_maskz_loadu_ps(mask1, c_row + 16), v1);
+        }
+        __m512 row_bias = _mm512_set1_ps(ep.row_bias ? ep.row_bias[row + i] : 0.0f);
+        v0 = _mm512_add_ps(v0, _mm512_add_ps(row_bias, col_bias0));
+        v1 = _mm512_add_ps(v1, _mm512_add_ps(row_bias, col_bias1));
+        v0 = _mm512_mul_ps(activation_avx512(v0, ep), scale);
+        v1 = _mm512_mul_ps(activation_avx512(v1, ep), scale);
+
+        if (float_out) {
+            float* out = epilogue_float_row(ep, C, ldc, row, col, i);
+            _mm512_mask_storeu_ps(out, mask0, v0);
+            _mm512_mask_storeu_ps(out + 16, mask1, v1);
+        } else {
+            alignas(64) float values[32];
+            _mm512_store_ps(values, v0);
+            _mm512_store_ps(values + 16, v1);
+            store_epilogue_row(values, ep, c_row, row + i, col, nr);
+        }
+    }
+}
+
+// AVX-512 micro-kernel: 12x32 block (MR x NR)
+// Registers: 32 ZMM registers available in AVX-512, 1 ZMM = 16 floats.
+// - 24 ZMM hold the 12x32 C tile (12 rows x 2 registers per row).
+// - 2 ZMM hold the current row of the B panel, 1 ZMM the broadcast A element.
+// Twice the FMA width of AVX2 and twice the accumulators to cover its latency.
+// Border tiles use AVX-512 opmask loads/stores on C.
+template <bool EPILOGUE>
+TARGET_AVX512
+static inline void kernel_12x32_impl(int k, const float* A, const float* B, float* C, int ldc, int mr, int nr,
+                                     float beta, const SgemmEpilogue* ep, int row, int col) {
+    const int MR = 12, NR = 32;
+
+    // Accumulators start from zero; C is only touched once, after the K loop.
+    __m512 c[MR][2];
+    for (int i = 0; i < MR; ++i) {
+        c[i][0] = _mm512_setzero_ps();
+        c[i][1] = _mm512_setzero_ps();
+    }
+
+    for (int i = 0; i < mr; ++i) {
+        _mm_prefetch((const char*)&C[i * ldc], _MM_HINT_T0);
+        _mm_prefetch((const char*)&C[i * ldc + NR - 1], _MM_HINT_T0);
+    }
+
+    for (int p = 0; p < k; ++p) {
+        _mm_prefetch((const char*)&A[(p + PREFETCH_DIST) * MR], _MM_HINT_T0);
+        _mm_prefetch((const char*)&B[(p + PREFETCH_DIST) * NR], _MM_HINT_T0);
+        _mm_prefetch((const char*)&B[(p + PREFETCH_DIST) * NR + 16], _MM_HINT_T0);
+
+        __m512 b0 = _mm512_loadu_ps(&B[p * NR]);
+        __m512 b1 = _mm512_loadu_ps(&B[p * NR + 16]);
+        const float* a = &A[p * MR];
+
+        // Fixed trip count: fully unrolled, c[][] stays in registers
+        for (int i = 0; i < MR; ++i) {
+            __m512 a_vec = _mm512_set1_ps(a[i]);
+            c[i][0] = _mm512_fmadd_ps(a_vec, b0, c[i][0]);
+            c[i][1] = _mm512_fmadd_ps(a_vec, b1, c[i][1]);
+        }
+    }
+
+    if (EPILOGUE) {
+        epilogue_store_avx512<MR>(c, C, ldc, mr, nr, beta, *ep, row, col);
+        return;
+    }
+
+    // C = acc + beta * C. beta == 0 never reads C.
+    const __m512 beta_vec = _mm512_set1_ps(beta);
+    if (mr == MR && nr == NR) {
+        for (int i = 0; i < MR; ++i) {
+            float* row = &C[i * ldc];
+            if (beta == 0.0f) {
+                _mm512_storeu_ps(row, c[i][0]);
+                _mm512_storeu_ps(row + 16, c[i][1]);
+            } else {
+                _mm512_storeu_ps(row, _mm512_fmadd_ps(beta_vec, _mm512_loadu_ps(row), c[i][0]));
+                _mm512_storeu_ps(row + 16, _mm512_fmadd_ps(beta_vec, _mm512_loadu_ps(row + 16), c[i][1]));
+            }
+        }
+        return;
+    }
+
+    // Border tile: lane j of the first/second half is enabled when j < nr / j + 16 < nr
+    __mmask16 mask0 = (nr >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << nr) - 1);
+    __mmask16 mask1 = (nr <= 16) ? (__mmask16)0 : (__mmask16)((1u << (nr - 16)) - 1);
+    for (int i = 0; i < mr; ++i) {
+        float* row = &C[i * ldc];
+        __m512 out0 = c[i][0], out1 = c[i][1];
+        if (beta != 0.0f) {
+            out0 = _mm512_fmadd_ps(beta_vec, _mm512_maskz_loadu_ps(mask0, row), out0);
+            out1 = _mm512_fmadd_ps(beta_vec, _mm512_maskz_loadu_ps(mask1, row + 16), out1);
+        }
+        _mm512_mask_storeu_ps(row, mask0, out0);
+        _mm512_mask_storeu_ps(row + 16, mask1, out1);
+    }
+}
+
+TARGET_AVX512
+void kernel_12x32(int k, const float* A, const float* B, float* C, int ldc, int mr, int nr, float beta) {
+    kernel_12x32_impl<false>(k, A, B, C, ldc, mr, nr, beta, nullptr, 0, 0);
+}
+
+TARGET_AVX512
+void kernel_12x32_epilogue(int k, const float* A, const float* B, float* C, int ldc, int mr, int nr, float beta,
+                           const SgemmEpilogue& ep, int row, int col) {
+    kernel_12x32_impl<true>(k, A, B, C, ldc, mr, nr, beta, &ep, row, col);
+}
+
+// Small-matrix kernels
+// No packing: a block of ROWS rows x 2 vectors of C lives in registers while the
+// K loop broadcasts A[i][k] and loads row k of B straight from the operand.
+// For n, p <= 64 all of B sits in L1, so the extra B traffic of skipping the
+// packing is cheap, and tiny products avoid the packing overhead entirely.
+// Column tails use masked loads/stores, row tails the 1-row variant.
+
+void small_gemm_scalar(int m, int n, int p, const float* A, int lda, const float* B, int ldb, float* C, int ldc) {
+    for (int i = 0; i < m; ++i) {
+        for (int k = 0; k < n; ++k) {
+            float a_val = A[i * lda + k];
+            for (int j = 0; j < p; ++j) {
+                C[i * ldc + j] += a_val * B[k * ldb + j];
+            }
+        }
+    }
+}
+
+template <int ROWS>
+TARGET_AVX2
+static inline void small_block_avx2(int n, const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                                    bool full, __m256i mask0, __m256i mask1) {
+    __m256 c[ROWS][2];
+    for (int r = 0; r < ROWS; ++r) {
+        c[r][0] = _mm256_setzero_ps();
+        c[r][1] = _mm256_setzero_ps();
+    }
+
+    for (int k = 0; k < n; ++k) {
+        const float* b_row = &B[k * ldb];
+        __m256 b0 = full ? _mm256_loadu_ps(b_row) : _mm256_maskload_ps(b_row, mask0);
+        __m256 b1 = full ? _mm256_loadu_ps(b_row + 8) : _mm256_maskload_ps(b_row + 8, mask1);
+        for (int r = 0; r < ROWS; ++r) {
+            __m256 a_vec = _mm256_broadcast_ss(&A[r * lda + k]);
+            c[r][0] = _mm256_fmadd_ps(a_vec, b0, c[r][0]);
+            c[r][1] = _mm256_fmadd_ps(a_vec, b1, c[r][1]);
+        }
+    }
+
+    for (int r = 0; r < ROWS; ++r) {
+        float* row = &C[r * ldc];
+        if (full) {
+            _mm256_storeu_ps(row, _mm256_add_ps(_mm256_loadu_ps(row), c[r][0]));
+            _mm256_storeu_ps(row + 8, _mm256_add_ps(_mm256_loadu_ps(row + 8), c[r][1]));
+        } else {
+            _mm256_maskstore_ps(row, mask0, _mm256_add_ps(_mm256_maskload_ps(row, mask0), c[r][0]));
+            _mm256_maskstore_ps(row + 8, mask1, _mm256_add_ps(_mm256_maskload_ps(row + 8, mask1), c[r][1]));
+        }
+    }
+}
+
+TARGET_AVX2
+void small_gemm_avx2(int m, int n, int p, const float* A, int lda, const float* B, int ldb, float* C, int ldc) {
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (int j = 0; j < p; j += 16) {
+        int nr = std::min(16, p - j);
+        __m256i mask0 = _mm256_cmpgt_epi32(_mm256_set1_epi32(nr), lane);
+        __m256i mask1 = _mm256_cmpgt_epi32(_mm256_set1_epi32(nr - 8), lane);
+        bool full = (nr == 16);
+
+        int i = 0;
+        for (; i + 4 <= m; i += 4) {
+            small_block_avx2<4>(n, &A[i * lda], lda, &B[j], ldb, &C[i * ldc + j], ldc, full, mask0, mask1);
+        }
+        for (; i < m; ++i) {
+            small_block_avx2<1>(n, &A[i * lda], lda, &B[j], ldb, &C[i * ldc + j], ldc, full, mask0, mask1);
+        }
+    }
+}
+
+template <int ROWS>
+TARGET_AVX512
+static inline void small_block_avx512(int n, const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                                      __mmask16 mask0, __mmask16 mask1) {
+    __m512 c[ROWS][2];
+    for (int r = 0; r < ROWS; ++r) {
+        c[r][0] = _mm512_setzero_ps();
+        c[r][1] = _mm512_setzero_ps();
+    }
+
+    for (int k = 0; k < n; ++k) {
+        const float* b_row = &B[k * ldb];
+        __m512 b0 = _mm512_maskz_loadu_ps(mask0, b_row);
+        __m512 b1 = _mm512_maskz_loadu_ps(mask1, b_row + 16);
+        for (int r = 0; r < ROWS; ++r) {
+            __m512 a_vec = _mm512_set1_ps(A[r * lda + k]);
+            c[r][0] = _mm512_fmadd_ps(a_vec, b0, c[r][0]);
+            c[r][1] = _mm512_fmadd_ps(a_vec, b1, c[r][1]);
+        }
+    }
+
+    for (int r = 0; r < ROWS; ++r) {
+        float* row = &C[r * ldc];
+        _mm512_mask_storeu_ps(row, mask0, _mm512_add_ps(_mm512_maskz_loadu_ps(mask0, row), c[r][0]));
+        _mm512_mask_storeu_ps(row + 16, mask1, _mm512_add_ps(_mm512_maskz_loadu_ps(mask1, row + 16), c[r][1]));
+    }
+}
+
+TARGET_AVX512
+void small_gemm_avx512(int m, int n, int p, const float* A, int lda, const float* B, int ldb, float* C, int ldc) {
+    for (int j = 0; j < p; j += 32) {
+        int nr = std::min(32, p - j);
+        // Opmasks are as cheap as plain loads, so no separate full-tile path
+        __mmask16 mask0 = (nr >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << nr) - 1);
+        __mmask16 mask1 = (nr <= 16) ? (__mmask16)0 : (__mmask16)((1u << (nr - 16)) - 1);
+
+        int i = 0;
+        for (; i + 4 <= m; i += 4) {
+            small_block_avx512<4>(n, &A[i * lda], lda, &B[j], ldb, &C[i * ldc + j], ldc, mask0, mask1);
+        }
+        for (; i < m; ++i) {
+            small_block_avx512<1>(n, &A[i * lda], lda, &B[j], ldb, &C[i * ldc + j], ldc, mask0, mask1);
+        }
+    }
+}
+
+const SgemmKernel& sgemm_kernel_for(CpuIsa isa) {
+    static const SgemmKernel kernels[] = {
+        {"scalar-4x8", CpuIsa::Scalar, 4, 8, kernel_4x8_scalar, small_gemm_scalar, kernel_4x8_scalar_epilogue},
+        {"avx2-6x16", CpuIsa::AVX2, 6, 16, kernel_6x16, small_gemm_avx2, kernel_6x16_epilogue},
+        {"avx512-12x32", CpuIsa::AVX512, 12, 32, kernel_12x32, small_gemm_avx512, kernel_12x32_epilogue},
+    };
+    return kernels[static_cast<int>(isa)];
+}
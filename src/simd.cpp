@@ -1,20 +1,53 @@
 #include "../include/matrix_utils.h"
+#include "../include/cpu_dispatch.h"
 #include <immintrin.h>
 
-// SIMD Implementation using AVX2
-// Processes 8 floats at a time.
-void matmul_simd(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+// SIMD Implementation
+// The same I-K-J loop is compiled three times: AVX-512 (16 floats at a time),
+// AVX2 (8 floats at a time) and portable C++. matmul_simd picks the widest one
+// the CPU supports at runtime (see cpu_dispatch.h).
+//
+// For SIMD, it's best to use the I-K-J loop order so we can load a scalar from A
+// and multiply it by a vector from B, then add to a vector in C.
+// C[i][j...j+W-1] += A[i][k] * B[k][j...j+W-1]
+
+TARGET_AVX512
+void matmul_simd_avx512(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
     // We assume C is zeroed.
-    
-    // For SIMD, it's best to use the I-K-J loop order so we can load a scalar from A
-    // and multiply it by a vector from B, then add to a vector in C.
-    // C[i][j...j+7] += A[i][k] * B[k][j...j+7]
-    
+    for (int i = 0; i < m; ++i) {
+        for (int k = 0; k < n; ++k) {
+            // Broadcast A[i][k] to a vector
+            __m512 a_vec = _mm512_set1_ps(A[i * n + k]);
+
+            int j = 0;
+            for (; j + 16 <= p; j += 16) {
+                __m512 c_vec = _mm512_loadu_ps(&C[i * p + j]);
+                __m512 b_vec = _mm512_loadu_ps(&B[k * p + j]);
+                c_vec = _mm512_fmadd_ps(a_vec, b_vec, c_vec);
+                _mm512_storeu_ps(&C[i * p + j], c_vec);
+            }
+
+            // Remaining elements: AVX-512 masks instead of a scalar loop
+            if (j < p) {
+                __mmask16 mask = (__mmask16)((1u << (p - j)) - 1);
+                __m512 c_vec = _mm512_maskz_loadu_ps(mask, &C[i * p + j]);
+                __m512 b_vec = _mm512_maskz_loadu_ps(mask, &B[k * p + j]);
+                c_vec = _mm512_fmadd_ps(a_vec, b_vec, c_vec);
+                _mm512_mask_storeu_ps(&C[i * p + j], mask, c_vec);
+            }
+        }
+    }
+}
+
+TARGET_AVX2
+void matmul_simd_avx2(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+    // We assume C is zeroed.
+
     for (int i = 0; i < m; ++i) {
         for (int k = 0; k < n; ++k) {
             // Broadcast A[i][k] to a vector
             __m256 a_vec = _mm256_set1_ps(A[i * n + k]);
-            
+
             for (int j = 0; j < p; j += 8) {
                 // Check boundary
                 if (j + 8 > p) {
@@ -28,18 +61,46 @@ void matmul_simd(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int
 
                 // Load C[i][j...j+7]
                 __m256 c_vec = _mm256_loadu_ps(&C[i * p + j]);
-                
+
                 // Load B[k][j...j+7]
                 __m256 b_vec = _mm256_loadu_ps(&B[k * p + j]);
-                
+
                 // FMA: c_vec = c_vec + a_vec * b_vec
-                // _mm256_fmadd_ps is AVX2 (FMA3). If not available, use mul + add.
-                // Assuming AVX2 is available on modern CPUs.
+                // _mm256_fmadd_ps is FMA3, guaranteed by the AVX2 dispatch level.
                 c_vec = _mm256_fmadd_ps(a_vec, b_vec, c_vec);
-                
+
                 // Store back to C
                 _mm256_storeu_ps(&C[i * p + j], c_vec);
             }
         }
     }
 }
+
+// Portable fallback: plain I-K-J loop, vectorized by the compiler for the baseline ISA.
+void matmul_simd_scalar(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+    // We assume C is zeroed.
+    for (int i = 0; i < m; ++i) {
+        for (int k = 0; k < n; ++k) {
+            float a_val = A[i * n + k];
+            for (int j = 0; j < p; ++j) {
+                C[i * p + j] += a_val * B[k * p + j];
+            }
+        }
+    }
+}
+
+using SimdFunc = void (*)(const Matrix&, const Matrix&, Matrix&, int, int, int);
+
+static SimdFunc select_simd() {
+    switch (active_cpu_isa()) {
+        case CpuIsa::AVX512: return matmul_simd_avx512;
+        case CpuIsa::AVX2: return matmul_simd_avx2;
+        default: return matmul_simd_scalar;
+    }
+}
+
+void matmul_simd(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+    // Resolved once, on first call
+    static const SimdFunc impl = select_simd();
+    impl(A, B, C, m, n, p);
+}
@@ -0,0 +1,443 @@
+#include "../include/skinny_gemm.h"
+#include "../include/cpu_dispatch.h"
+#include "../include/aligned_buffer.h"
+#include <immintrin.h>
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+
+// Skinny GEMM kernels (see skinny_gemm.h)
+
+// Small m: C[0:rows, 0:width] += A[0:rows, 0:k] * B[0:k, 0:width], with
+// rows <= max_rows and width <= strip.
+using SkinnyMKernel = void (*)(int rows, int k, int width, const float* A, int lda, const float* B, int ldb,
+                               float* C, int ldc);
+// Small p: C[0:rows, 0:cols] += A[0:rows, 0:k] * Bt[0:cols, 0:k]^T (Bt = B transposed)
+using SkinnyPKernel = void (*)(int rows, int k, int cols, const float* A, int lda, const float* Bt, int ldbt,
+                               float* C, int ldc);
+
+struct SkinnyKernels {
+    const char* name;
+    int strip;      // Columns of B per small-m call
+    int max_rows;   // Rows of A per small-m call
+    SkinnyMKernel small_m;
+    SkinnyPKernel small_p;
+};
+
+// Portable kernels
+static void skinny_m_scalar(int rows, int k, int width, const float* A, int lda, const float* B, int ldb,
+                            float* C, int ldc) {
+    for (int r = 0; r < rows; ++r) {
+        float* c_row = &C[(long long)r * ldc];
+        for (int p = 0; p < k; ++p) {
+            float a = A[(long long)r * lda + p];
+            const float* b_row = &B[(long long)p * ldb];
+            for (int j = 0; j < width; ++j) {
+                c_row[j] += a * b_row[j];
+            }
+        }
+    }
+}
+
+static void skinny_p_scalar(int rows, int k, int cols, const float* A, int lda, const float* Bt, int ldbt,
+                            float* C, int ldc) {
+    for (int i = 0; i < rows; ++i) {
+        const float* a = &A[(long long)i * lda];
+        for (int j = 0; j < cols; ++j) {
+            const float* b = &Bt[(long long)j * ldbt];
+            // Four partial sums: independent add chains
+            float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+            int p = 0;
+            for (; p + 4 <= k; p += 4) {
+                s0 += a[p] * b[p];
+                s1 += a[p + 1] * b[p + 1];
+                s2 += a[p + 2] * b[p + 2];
+                s3 += a[p + 3] * b[p + 3];
+            }
+            for (; p < k; ++p) s0 += a[p] * b[p];
+            C[(long long)i * ldc + j] += (s0 + s1) + (s2 + s3);
+        }
+    }
+}
+
+// AVX2: small m on 32-column strips (R x 4 YMM accumulators, R <= 3)
+template <int R, bool FULL>
+TARGET_AVX2
+static inline void skinny_m_block_avx2(int k, int width, const float* A, int lda, const float* B, int ldb,
+                                       float* C, int ldc) {
+    const int V = 4;
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i mask[V];
+    for (int v = 0; v < V; ++v) {
+        mask[v] = _mm256_cmpgt_epi32(_mm256_set1_epi32(width - 8 * v), lane);
+    }
+
+    __m256 c[R][V];
+    for (int r = 0; r < R; ++r) {
+        for (int v = 0; v < V; ++v) c[r][v] = _mm256_setzero_ps();
+    }
+
+    for (int p = 0; p < k; ++p) {
+        const float* b_row = &B[(long long)p * ldb];
+        __m256 a[R];
+        for (int r = 0; r < R; ++r) a[r] = _mm256_set1_ps(A[(long long)r * lda + p]);
+        for (int v = 0; v < V; ++v) {
+            __m256 b = FULL ? _mm256_loadu_ps(b_row + 8 * v) : _mm256_maskload_ps(b_row + 8 * v, mask[v]);
+            for (int r = 0; r < R; ++r) c[r][v] = _mm256_fmadd_ps(a[r], b, c[r][v]);
+        }
+    }
+
+    for (int r = 0; r < R; ++r) {
+        float* c_row = &C[(long long)r * ldc];
+        for (int v = 0; v < V; ++v) {
+            if (FULL) {
+                _mm256_storeu_ps(c_row + 8 * v, _mm256_add_ps(_mm256_loadu_ps(c_row + 8 * v), c[r][v]));
+            } else {
+                __m256 old = _mm256_maskload_ps(c_row + 8 * v, mask[v]);
+                _mm256_maskstore_ps(c_row + 8 * v, mask[v], _mm256_add_ps(old, c[r][v]));
+            }
+        }
+    }
+}
+
+template <int R>
+TARGET_AVX2
+static inline void skinny_m_rows_avx2(int k, int width, const float* A, int lda, const float* B, int ldb,
+                                      float* C, int ldc) {
+    if (width == 32) {
+        skinny_m_block_avx2<R, true>(k, width, A, lda, B, ldb, C, ldc);
+    } else {
+        skinny_m_block_avx2<R, false>(k, width, A, lda, B, ldb, C, ldc);
+    }
+}
+
+TARGET_AVX2
+static void skinny_m_avx2(int rows, int k, int width, const float* A, int lda, const float* B, int ldb,
+                          float* C, int ldc) {
+    switch (rows) {
+        case 1: skinny_m_rows_avx2<1>(k, width, A, lda, B, ldb, C, ldc); break;
+        case 2: skinny_m_rows_avx2<2>(k, width, A, lda, B, ldb, C, ldc); break;
+        default: skinny_m_rows_avx2<3>(k, width, A, lda, B, ldb, C, ldc); break;
+    }
+}
+
+TARGET_AVX2
+static inline float hsum_avx2(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+// AVX2: small p, R rows x J columns of dot products (R x J YMM accumulators)
+template <int R, int J>
+TARGET_AVX2
+static inline void skinny_p_block_avx2(int k, const float* A, int lda, const float* Bt, int ldbt, float* C, int ldc) {
+    __m256 c[R][J];
+    for (int r = 0; r < R; ++r) {
+        for (int j = 0; j < J; ++j) c[r][j] = _mm256_setzero_ps();
+    }
+
+    int p = 0;
+    for (; p + 8 <= k; p += 8) {
+        __m256 a[R];
+        for (int r = 0; r < R; ++r) a[r] = _mm256_loadu_ps(&A[(long long)r * lda + p]);
+        for (int j = 0; j < J; ++j) {
+            __m256 b = _mm256_loadu_ps(&Bt[(long long)j * ldbt + p]);
+            for (int r = 0; r < R; ++r) c[r][j] = _mm256_fmadd_ps(a[r], b, c[r][j]);
+        }
+    }
+    if (p < k) {
+        const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(k - p), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        __m256 a[R];
+        for (int r = 0; r < R; ++r) a[r] = _mm256_maskload_ps(&A[(long long)r * lda + p], mask);
+        for (int j = 0; j < J; ++j) {
+            __m256 b = _mm256_maskload_ps(&Bt[(long long)j * ldbt + p], mask);
+            for (int r = 0; r < R; ++r) c[r][j] = _mm256_fmadd_ps(a[r], b, c[r][j]);
+        }
+    }
+
+    for (int r = 0; r < R; ++r) {
+        for (int j = 0; j < J; ++j) C[(long long)r * ldc + j] += hsum_avx2(c[r][j]);
+    }
+}
+
+template <int R>
+TARGET_AVX2
+static inline void skinny_p_rows_avx2(int k, int cols, const float* A, int lda, const float* Bt, int ldbt,
+                                      float* C, int ldc) {
+    int j = 0;
+    for (; j + 2 <= cols; j += 2) {
+        skinny_p_block_avx2<R, 2>(k, A, lda, &Bt[(long long)j * ldbt], ldbt, &C[j], ldc);
+    }
+    if (j < cols) {
+        skinny_p_block_avx2<R, 1>(k, A, lda, &Bt[(long long)j * ldbt], ldbt, &C[j], ldc);
+    }
+}
+
+TARGET_AVX2
+static void skinny_p_avx2(int rows, int k, int cols, const float* A, int lda, const float* Bt, int ldbt,
+                          float* C, int ldc) {
+    int i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        skinny_p_rows_avx2<4>(k, cols, &A[(long long)i * lda], lda, Bt, ldbt, &C[(long long)i * ldc], ldc);
+    }
+    for (; i < rows; ++i) {
+        skinny_p_rows_avx2<1>(k, cols, &A[(long long)i * lda], lda, Bt, ldbt, &C[(long long)i * ldc], ldc);
+    }
+}
+
+// AVX-512: small m on 128-column strips (R x 8 ZMM accumulators, R <= 3)
+template <int R, bool FULL>
+TARGET_AVX512
+static inline void skinny_m_block_avx512(int k, int width, const float* A, int lda, const float* B, int ldb,
+                                         float* C, int ldc) {
+    const int V = 8;
+    __mmask16 mask[V];
+    for (int v = 0; v < V; ++v) {
+        int w = width - 16 * v;
+        mask[v] = (w >= 16) ? (__mmask16)0xFFFF : (w <= 0) ? (__mmask16)0 : (__mmask16)((1u << w) - 1);
+    }
+
+    __m512 c[R][V];
+    for (int r = 0; r < R; ++r) {
+        for (int v = 0; v < V; ++v) c[r][v] = _mm512_setzero_ps();
+    }
+
+    for (int p = 0; p < k; ++p) {
+        const float* b_row = &B[(long long)p * ldb];
+        __m512 a[R];
+        for (int r = 0; r < R; ++r) a[r] = _mm512_set1_ps(A[(long long)r * lda + p]);
+        for (int v = 0; v < V; ++v) {
+            __m512 b = FULL ? _mm512_loadu_ps(b_row + 16 * v) : _mm512_maskz_loadu_ps(mask[v], b_row + 16 * v);
+            for (int r = 0; r < R; ++r) c[r][v] = _mm512_fmadd_ps(a[r], b, c[r][v]);
+        }
+    }
+
+    for (int r = 0; r < R; ++r) {
+        float* c_row = &C[(long long)r * ldc];
+        for (int v = 0; v < V; ++v) {
+            __m512 old = _mm512_maskz_loadu_ps(mask[v], c_row + 16 * v);
+            _mm512_mask_storeu_ps(c_row + 16 * v, mask[v], _mm512_add_ps(old, c[r][v]));
+        }
+    }
+}
+
+template <int R>
+TARGET_AVX512
+static inline void skinny_m_rows_avx512(int k, int width, const float* A, int lda, const float* B, int ldb,
+                                        float* C, int ldc) {
+    if (width == 128) {
+        skinny_m_block_avx512<R, true>(k, width, A, lda, B, ldb, C, ldc);
+    } else {
+        skinny_m_block_avx512<R, false>(k, width, A, lda, B, ldb, C, ldc);
+    }
+}
+
+TARGET_AVX512
+static void skinny_m_avx512(int rows, int k, int width, const float* A, int lda, const float* B, int ldb,
+                            float* C, int ldc) {
+    switch (rows) {
+        case 1: skinny_m_rows_avx512<1>(k, width, A, lda, B, ldb, C, ldc); break;
+        case 2: skinny_m_rows_avx512<2>(k, width, A, lda, B, ldb, C, ldc); break;
+        default: skinny_m_rows_avx512<3>(k, width, A, lda, B, ldb, C, ldc); break;
+    }
+}
+
+// Horizontal sum from the four 128-bit quarters. _mm512_reduce_add_ps and the
+// unmasked extracts/casts start from _mm512_undefined_ps(), which GCC 12 reports
+// as uninitialized once inlined (GCC bug 105593); the maskz forms start from zero.
+TARGET_AVX512
+static inline float hsum_avx512(__m512 v) {
+    __m128 s = _mm_add_ps(_mm_add_ps(_mm512_maskz_extractf32x4_ps(0xF, v, 0), _mm512_maskz_extractf32x4_ps(0xF, v, 1)),
+                          _mm_add_ps(_mm512_maskz_extractf32x4_ps(0xF, v, 2), _mm512_maskz_extractf32x4_ps(0xF, v, 3)));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+// AVX-512: small p, R rows x J columns of dot products
+template <int R, int J>
+TARGET_AVX512
+static inline void skinny_p_block_avx512(int k, const float* A, int lda, const float* Bt, int ldbt,
+                                         float* C, int ldc) {
+    __m512 c[R][J];
+    for (int r = 0; r < R; ++r) {
+        for (int j = 0; j < J; ++j) c[r][j] = _mm512_setzero_ps();
+    }
+
+    int p = 0;
+    for (; p + 16 <= k; p += 16) {
+        __m512 a[R];
+        for (int r = 0; r < R; ++r) a[r] = _mm512_loadu_ps(&A[(long long)r * lda + p]);
+        for (int j = 0; j < J; ++j) {
+            __m512 b = _mm512_loadu_ps(&Bt[(long long)j * ldbt + p]);
+            for (int r = 0; r < R; ++r) c[r][j] = _mm512_fmadd_ps(a[r], b, c[r][j]);
+        }
+    }
+    if (p < k) {
+        __mmask16 mask = (__mmask16)((1u << (k - p)) - 1);
+        __m512 a[R];
+        for (int r = 0; r < R; ++r) a[r] = _mm512_maskz_loadu_ps(mask, &A[(long long)r * lda + p]);
+        for (int j = 0; j < J; ++j) {
+            __m512 b = _mm512_maskz_loadu_ps(mask, &Bt[(long long)j * ldbt + p]);
+            for (int r = 0; r < R; ++r) c[r][j] = _mm512_fmadd_ps(a[r], b, c[r][j]);
+        }
+    }
+
+    for (int r = 0; r < R; ++r) {
+        for (int j = 0; j < J; ++j) C[(long long)r * ldc + j] += hsum_avx512(c[r][j]);
+    }
+}
+
+template <int R>
+TARGET_AVX512
+static inline void skinny_p_rows_avx512(int k, int cols, const float* A, int lda, const float* Bt, int ldbt,
+                                        float* C, int ldc) {
+    int j = 0;
+    for (; j + 4 <= cols; j += 4) {
+        skinny_p_block_avx512<R, 4>(k, A, lda, &Bt[(long long)j * ldbt], ldbt, &C[j], ldc);
+    }
+    switch (cols - j) {
+        case 3: skinny_p_block_avx512<R, 3>(k, A, lda, &Bt[(long long)j * ldbt], ldbt, &C[j], ldc); break;
+        case 2: skinny_p_block_avx512<R, 2>(k, A, lda, &Bt[(long long)j * ldbt], ldbt, &C[j], ldc); break;
+        case 1: skinny_p_block_avx512<R, 1>(k, A, lda, &Bt[(long long)j * ldbt], ldbt, &C[j], ldc); break;
+        default: break;
+    }
+}
+
+TARGET_AVX512
+static void skinny_p_avx512(int rows, int k, int cols, const float* A, int lda, const float* Bt, int ldbt,
+                            float* C, int ldc) {
+    int i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        skinny_p_rows_avx512<4>(k, cols, &A[(long long)i * lda], lda, Bt, ldbt, &C[(long long)i * ldc], ldc);
+    }
+    for (; i < rows; ++i) {
+        skinny_p_rows_avx512<1>(k, cols, &A[(long long)i * lda], lda, Bt, ldbt, &C[(long long)i * ldc], ldc);
+    }
+}
+
+static const SkinnyKernels& skinny_kernels() {
+    static const SkinnyKernels kernels[] = {
+        {"scalar", 64, 4, skinny_m_scalar, skinny_p_scalar},
+        {"avx2", 32, 3, skinny_m_avx2, skinny_p_avx2},
+        {"avx512", 128, 3, skinny_m_avx512, skinny_p_avx512},
+    };
+    return kernels[static_cast<int>(active_cpu_isa())];
+}
+
+const char* skinny_kernel_name() {
+    return skinny_kernels().name;
+}
+
+// Drivers
+
+// Streamed bytes per thread below which another thread does not pay off (waking
+// a thread costs a few us, in which one core streams about 100 KB).
+const double SKINNY_BYTES_PER_THREAD = 1 << 20;
+
+// Rows of A per parallel chunk in the small-p driver
+const int SKINNY_P_ROWS = 64;
+
+// K block of the small-p driver: 4 rows of A (64 KB) stay in L2 while they
+// are dotted with every column of B.
+const int SKINNY_P_DEPTH = 4096;
+
+static int skinny_threads(double bytes, int chunks, int num_threads) {
+    if (num_threads <= 0) {
+        if (omp_in_parallel()) return 1;
+        num_threads = std::max(1, std::min(omp_get_max_threads(), (int)std::ceil(bytes / SKINNY_BYTES_PER_THREAD)));
+    }
+    return std::max(1, std::min(num_threads, chunks));
+}
+
+// Rows of B per step of the small-m driver: the step reads that many rows of B
+// side by side (sequential streams the prefetcher follows) against C blocks that
+// stay in cache.
+const int SKINNY_M_DEPTH = 16;
+
+// Columns per panel of the small-m driver: the m x width block of C it updates
+// fills at most half of L2, so C is read and written from cache while B streams
+// past once.
+static int skinny_m_panel(int m, int strip) {
+    static const long l2 = detect_cache_sizes().l2;
+    long width = l2 / 2 / ((long)m * sizeof(float)) / strip * strip;
+    return (int)std::max((long)strip, width);
+}
+
+void matmul_skinny_m(const float* A, int lda, const float* B, int ldb, float* C, int ldc, int m, int n, int p,
+                     int num_threads) {
+    if (m <= 0 || n <= 0 || p <= 0) return;
+
+    const SkinnyKernels& kern = skinny_kernels();
+    const int W = kern.strip;
+    const int groups = (m + kern.max_rows - 1) / kern.max_rows;
+    const int threads = skinny_threads(4.0 * n * p, (p + W - 1) / W, num_threads);
+    // Enough panels for every thread
+    const int per_thread = (p + threads - 1) / threads;
+    const int PW = std::min(skinny_m_panel(m, W), (per_thread + W - 1) / W * W);
+    const int num_panels = (p + PW - 1) / PW;
+
+    #pragma omp parallel for num_threads(threads) schedule(static) if(threads > 1)
+    for (int panel = 0; panel < num_panels; ++panel) {
+        int j0 = panel * PW;
+        int j1 = std::min(p, j0 + PW);
+        for (int k = 0; k < n; k += SKINNY_M_DEPTH) {
+            int kb = std::min(SKINNY_M_DEPTH, n - k);
+            for (int j = j0; j < j1; j += W) {
+                int width = std::min(W, j1 - j);
+                // Rows in groups of at most max_rows, split evenly (16 = 2+2+3+3+3+3)
+                int i = 0;
+                for (int g = 0; g < groups; ++g) {
+                    int rows = (m - i) / (groups - g);
+                    kern.small_m(rows, kb, width, &A[(long long)i * lda + k], lda, &B[(long long)k * ldb + j],
+                                 ldb, &C[(long long)i * ldc + j], ldc);
+                    i += rows;
+                }
+            }
+        }
+    }
+}
+
+void matmul_skinny_p(const float* A, int lda, const float* B, int ldb, float* C, int ldc, int m, int n, int p,
+                     int num_threads) {
+    if (m <= 0 || n <= 0 || p <= 0) return;
+
+    // B transposed (p x n), so both operands of every dot product are contiguous.
+    // A single contiguous column (GEMV) is used in place.
+    AlignedVector transposed;
+    const float* Bt = B;
+    int ldbt = n;
+    if (!(p == 1 && ldb == 1)) {
+        transposed.resize((size_t)p * n);
+        for (int k = 0; k < n; ++k) {
+            for (int j = 0; j < p; ++j) {
+                transposed[(size_t)j * n + k] = B[(long long)k * ldb + j];
+            }
+        }
+        Bt = transposed.data();
+    }
+
+    const SkinnyKernels& kern = skinny_kernels();
+    const int num_chunks = (m + SKINNY_P_ROWS - 1) / SKINNY_P_ROWS;
+    const int threads = skinny_threads(4.0 * m * n, num_chunks, num_threads);
+
+    #pragma omp parallel for num_threads(threads) schedule(static) if(threads > 1)
+    for (int c = 0; c < num_chunks; ++c) {
+        int i = c * SKINNY_P_ROWS;
+        int rows = std::min(SKINNY_P_ROWS, m - i);
+        for (int k = 0; k < n; k += SKINNY_P_DEPTH) {
+            int kb = std::min(SKINNY_P_DEPTH, n - k);
+            kern.small_p(rows, kb, p, &A[(long long)i * lda + k], lda, &Bt[k], ldbt, &C[(long long)i * ldc], ldc);
+        }
+    }
+}
+
+void matmul_gemv(const float* A, int lda, const float* x, float* y, int m, int n) {
+    matmul_skinny_p(A, lda, x, 1, y, 1, m, n, 1);
+}
+
+void matmul_gevm(const float* x, const float* B, int ldb, float* y, int n, int p) {
+    matmul_skinny_m(x, n, B, ldb, y, p, 1, n, p);
+}
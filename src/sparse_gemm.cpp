@@ -0,0 +1,574 @@
+#include "../include/sparse_gemm.h"
+#include "../include/cpu_dispatch.h"
+#include "../include/sgemm.h"
+#include <immintrin.h>
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+// Sparse x dense GEMM (see sparse_gemm.h)
+
+const char* sparse_format_name(SparseFormat format) {
+    switch (format) {
+        case SparseFormat::Auto: return "auto";
+        case SparseFormat::Dense: return "dense";
+        case SparseFormat::CSR: return "csr";
+        case SparseFormat::BSR: return "bsr";
+    }
+    return "?";
+}
+
+// Crossover
+
+SparseCrossover default_sparse_crossover() {
+    SparseCrossover crossover;
+    crossover.dense_min_density = 0.08;
+    crossover.bsr_min_fill = 0.25;
+    return crossover;
+}
+
+static std::mutex g_crossover_mutex;
+static bool g_crossover_set = false;
+static SparseCrossover g_crossover;
+
+SparseCrossover sparse_crossover() {
+    std::lock_guard<std::mutex> lock(g_crossover_mutex);
+    if (!g_crossover_set) {
+        g_crossover = default_sparse_crossover();
+        g_crossover_set = true;
+    }
+    return g_crossover;
+}
+
+void set_sparse_crossover(const SparseCrossover& crossover) {
+    std::lock_guard<std::mutex> lock(g_crossover_mutex);
+    g_crossover = crossover;
+    g_crossover_set = true;
+}
+
+// Construction: everything is built as CSR first, then converted
+
+bool SparseMatrix::from_dense(const float* A, int lda, int rows, int cols, SparseFormat format,
+                              float drop_tolerance) {
+    clear();
+    if (!A || rows <= 0 || cols <= 0 || lda < cols) return false;
+
+    std::vector<int> row_ptr(rows + 1, 0);
+    std::vector<int> col_idx;
+    AlignedVector values;
+    for (int i = 0; i < rows; ++i) {
+        const float* a = &A[(long long)i * lda];
+        for (int k = 0; k < cols; ++k) {
+            if (std::fabs(a[k]) > drop_tolerance) {
+                col_idx.push_back(k);
+                values.push_back(a[k]);
+            }
+        }
+        row_ptr[i + 1] = (int)col_idx.size();
+    }
+    set_csr(rows, cols, std::move(row_ptr), std::move(col_idx), std::move(values));
+    convert(format);
+    return true;
+}
+
+bool SparseMatrix::from_csr(int rows, int cols, const int* row_ptr, const int* col_idx, const float* values,
+                            SparseFormat format) {
+    clear();
+    if (!row_ptr || rows <= 0 || cols <= 0 || row_ptr[0] != 0) return false;
+    if (row_ptr[rows] > 0 && (!col_idx || !values)) return false;
+    for (int i = 0; i < rows; ++i) {
+        if (row_ptr[i + 1] < row_ptr[i]) return false;
+        for (int e = row_ptr[i]; e < row_ptr[i + 1]; ++e) {
+            if (col_idx[e] < 0 || col_idx[e] >= cols) return false;
+            if (e > row_ptr[i] && col_idx[e] <= col_idx[e - 1]) return false;
+        }
+    }
+
+    int nnz = row_ptr[rows];
+    set_csr(rows, cols, std::vector<int>(row_ptr, row_ptr + rows + 1), std::vector<int>(col_idx, col_idx + nnz),
+            AlignedVector(values, values + nnz));
+    convert(format);
+    return true;
+}
+
+void SparseMatrix::clear() {
+    rows_ = 0;
+    cols_ = 0;
+    nnz_ = 0;
+    format_ = SparseFormat::CSR;
+    row_ptr_.clear();
+    col_idx_.clear();
+    values_.clear();
+}
+
+double SparseMatrix::block_fill() const {
+    if (format_ != SparseFormat::BSR || row_ptr_.empty() || row_ptr_.back() == 0) return 1.0;
+    return (double)nnz_ / ((double)row_ptr_.back() * BLOCK * BLOCK);
+}
+
+size_t SparseMatrix::bytes() const {
+    return (row_ptr_.size() + col_idx_.size()) * sizeof(int) + values_.size() * sizeof(float);
+}
+
+void SparseMatrix::set_csr(int rows, int cols, std::vector<int> row_ptr, std::vector<int> col_idx,
+                           AlignedVector values) {
+    rows_ = rows;
+    cols_ = cols;
+    nnz_ = row_ptr[rows];
+    format_ = SparseFormat::CSR;
+    row_ptr_ = std::move(row_ptr);
+    col_idx_ = std::move(col_idx);
+    values_ = std::move(values);
+}
+
+// 8x8 blocks holding at least one nonzero (from the CSR arrays)
+long long SparseMatrix::count_blocks() const {
+    const int block_rows = (rows_ + BLOCK - 1) / BLOCK;
+    std::vector<int> seen((cols_ + BLOCK - 1) / BLOCK, -1);
+    long long blocks = 0;
+    for (int br = 0; br < block_rows; ++br) {
+        for (int i = br * BLOCK; i < std::min(rows_, (br + 1) * BLOCK); ++i) {
+            for (int e = row_ptr_[i]; e < row_ptr_[i + 1]; ++e) {
+                int bc = col_idx_[e] / BLOCK;
+                if (seen[bc] != br) {
+                    seen[bc] = br;
+                    ++blocks;
+                }
+            }
+        }
+    }
+    return blocks;
+}
+
+void SparseMatrix::convert(SparseFormat format) {
+    if (format == SparseFormat::Auto) {
+        // Estimated cost in units of one CSR nonzero (see sparse_gemm.h)
+        SparseCrossover crossover = sparse_crossover();
+        double csr_cost = (double)nnz_;
+        double bsr_cost = (double)count_blocks() * BLOCK * BLOCK * crossover.bsr_min_fill;
+        double dense_cost = (double)rows_ * cols_ * crossover.dense_min_density;
+        format = SparseFormat::CSR;
+        if (bsr_cost < csr_cost) format = SparseFormat::BSR;
+        if (dense_cost < std::min(csr_cost, bsr_cost)) format = SparseFormat::Dense;
+    }
+    if (format == SparseFormat::BSR) csr_to_bsr();
+    if (format == SparseFormat::Dense) csr_to_dense();
+}
+
+void SparseMatrix::csr_to_bsr() {
+    const int block_rows = (rows_ + BLOCK - 1) / BLOCK;
+    std::vector<int> slot((cols_ + BLOCK - 1) / BLOCK, -1); // Block column -> block index in this block row
+    std::vector<int> block_ptr(block_rows + 1, 0);
+    std::vector<int> block_col;
+    AlignedVector blocks;
+
+    for (int br = 0; br < block_rows; ++br) {
+        int row_begin = br * BLOCK, row_end = std::min(rows_, row_begin + BLOCK);
+        // Block columns of this block row, ascending
+        int first = (int)block_col.size();
+        for (int i = row_begin; i < row_end; ++i) {
+            for (int e = row_ptr_[i]; e < row_ptr_[i + 1]; ++e) {
+                int bc = col_idx_[e] / BLOCK;
+                if (slot[bc] < 0) {
+                    slot[bc] = 0;
+                    block_col.push_back(bc);
+                }
+            }
+        }
+        std::sort(block_col.begin() + first, block_col.end());
+        for (int b = first; b < (int)block_col.size(); ++b) slot[block_col[b]] = b;
+
+        blocks.resize(block_col.size() * BLOCK * BLOCK, 0.0f);
+        for (int i = row_begin; i < row_end; ++i) {
+            for (int e = row_ptr_[i]; e < row_ptr_[i + 1]; ++e) {
+                int k = col_idx_[e];
+                blocks[(size_t)slot[k / BLOCK] * BLOCK * BLOCK + (i - row_begin) * BLOCK + k % BLOCK] = values_[e];
+            }
+        }
+        for (int b = first; b < (int)block_col.size(); ++b) slot[block_col[b]] = -1;
+        block_ptr[br + 1] = (int)block_col.size();
+    }
+
+    format_ = SparseFormat::BSR;
+    row_ptr_ = std::move(block_ptr);
+    col_idx_ = std::move(block_col);
+    values_ = std::move(blocks);
+}
+
+void SparseMatrix::csr_to_dense() {
+    AlignedVector dense((size_t)rows_ * cols_, 0.0f);
+    for (int i = 0; i < rows_; ++i) {
+        for (int e = row_ptr_[i]; e < row_ptr_[i + 1]; ++e) {
+            dense[(size_t)i * cols_ + col_idx_[e]] = values_[e];
+        }
+    }
+    format_ = SparseFormat::Dense;
+    row_ptr_.clear();
+    col_idx_.clear();
+    values_ = std::move(dense);
+}
+
+// Kernels
+// CSR: rows [row_begin, row_end) of C, columns [j0, j1).
+// BSR: block rows [row_begin, row_end) (rows / cols: size of A, for the edges).
+using CsrRowsKernel = void (*)(const int* row_ptr, const int* col_idx, const float* values, int row_begin,
+                               int row_end, const float* B, int ldb, float* C, int ldc, int j0, int j1);
+using BsrRowsKernel = void (*)(const int* row_ptr, const int* col_idx, const float* blocks, int row_begin,
+                               int row_end, int rows, int cols, const float* B, int ldb, float* C, int ldc,
+                               int j0, int j1);
+
+struct SparseKernels {
+    const char* name;
+    int csr_strip;   // Columns of C per register strip
+    int bsr_strip;
+    CsrRowsKernel csr;
+    BsrRowsKernel bsr;
+};
+
+const int BS = SparseMatrix::BLOCK;
+
+// Portable kernels
+static void csr_rows_scalar(const int* row_ptr, const int* col_idx, const float* values, int row_begin,
+                            int row_end, const float* B, int ldb, float* C, int ldc, int j0, int j1) {
+    for (int i = row_begin; i < row_end; ++i) {
+        float* c = &C[(long long)i * ldc];
+        for (int e = row_ptr[i]; e < row_ptr[i + 1]; ++e) {
+            float a = values[e];
+            const float* b = &B[(long long)col_idx[e] * ldb];
+            for (int j = j0; j < j1; ++j) c[j] += a * b[j];
+        }
+    }
+}
+
+static void bsr_rows_scalar(const int* row_ptr, const int* col_idx, const float* blocks, int row_begin,
+                            int row_end, int rows, int cols, const float* B, int ldb, float* C, int ldc,
+                            int j0, int j1) {
+    for (int br = row_begin; br < row_end; ++br) {
+        int i0 = br * BS, mrows = std::min(BS, rows - i0);
+        for (int e = row_ptr[br]; e < row_ptr[br + 1]; ++e) {
+            int k0 = col_idx[e] * BS, kb = std::min(BS, cols - k0);
+            const float* blk = &blocks[(size_t)e * BS * BS];
+            for (int r = 0; r < mrows; ++r) {
+                float* c = &C[(long long)(i0 + r) * ldc];
+                for (int kk = 0; kk < kb; ++kk) {
+                    float a = blk[r * BS + kk];
+                    const float* b = &B[(long long)(k0 + kk) * ldb];
+                    for (int j = j0; j < j1; ++j) c[j] += a * b[j];
+                }
+            }
+        }
+    }
+}
+
+// AVX2: CSR on 32-column strips. Two sets of 4 accumulators (even / odd
+// nonzeros) keep 8 FMA chains in flight.
+template <bool FULL>
+TARGET_AVX2
+static inline void csr_row_avx2(const int* cols, const float* vals, int len, const float* B, int ldb, float* c,
+                                int width) {
+    const int V = 4;
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i mask[V];
+    __m256 acc0[V], acc1[V];
+    for (int v = 0; v < V; ++v) {
+        mask[v] = _mm256_cmpgt_epi32(_mm256_set1_epi32(width - 8 * v), lane);
+        acc0[v] = FULL ? _mm256_loadu_ps(c + 8 * v) : _mm256_maskload_ps(c + 8 * v, mask[v]);
+        acc1[v] = _mm256_setzero_ps();
+    }
+
+    int e = 0;
+    for (; e + 2 <= len; e += 2) {
+        __m256 a0 = _mm256_set1_ps(vals[e]);
+        __m256 a1 = _mm256_set1_ps(vals[e + 1]);
+        const float* b0 = &B[(long long)cols[e] * ldb];
+        const float* b1 = &B[(long long)cols[e + 1] * ldb];
+        for (int v = 0; v < V; ++v) {
+            __m256 x0 = FULL ? _mm256_loadu_ps(b0 + 8 * v) : _mm256_maskload_ps(b0 + 8 * v, mask[v]);
+            __m256 x1 = FULL ? _mm256_loadu_ps(b1 + 8 * v) : _mm256_maskload_ps(b1 + 8 * v, mask[v]);
+            acc0[v] = _mm256_fmadd_ps(a0, x0, acc0[v]);
+            acc1[v] = _mm256_fmadd_ps(a1, x1, acc1[v]);
+        }
+    }
+    if (e < len) {
+        __m256 a0 = _mm256_set1_ps(vals[e]);
+        const float* b0 = &B[(long long)cols[e] * ldb];
+        for (int v = 0; v < V; ++v) {
+            __m256 x0 = FULL ? _mm256_loadu_ps(b0 + 8 * v) : _mm256_maskload_ps(b0 + 8 * v, mask[v]);
+            acc0[v] = _mm256_fmadd_ps(a0, x0, acc0[v]);
+        }
+    }
+
+    for (int v = 0; v < V; ++v) {
+        __m256 sum = _mm256_add_ps(acc0[v], acc1[v]);
+        if (FULL) {
+            _mm256_storeu_ps(c + 8 * v, sum);
+        } else {
+            _mm256_maskstore_ps(c + 8 * v, mask[v], sum);
+        }
+    }
+}
+
+TARGET_AVX2
+static void csr_rows_avx2(const int* row_ptr, const int* col_idx, const float* values, int row_begin, int row_end,
+                          const float* B, int ldb, float* C, int ldc, int j0, int j1) {
+    for (int i = row_begin; i < row_end; ++i) {
+        int begin = row_ptr[i], len = row_ptr[i + 1] - begin;
+        if (len == 0) continue;
+        float* c = &C[(long long)i * ldc];
+        int j = j0;
+        for (; j + 32 <= j1; j += 32) {
+            csr_row_avx2<true>(&col_idx[begin], &values[begin], len, B + j, ldb, c + j, 32);
+        }
+        if (j < j1) csr_row_avx2<false>(&col_idx[begin], &values[begin], len, B + j, ldb, c + j, j1 - j);
+    }
+}
+
+// AVX2: BSR, one block row (8 rows of C) x 8 columns: every B load feeds 8 FMAs
+template <bool FULL>
+TARGET_AVX2
+static inline void bsr_block_row_avx2(const int* bcols, const float* blocks, int len, int cols, const float* B,
+                                      int ldb, float* C, int ldc, int mrows, int width) {
+    const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(width), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256 acc[BS];
+    for (int r = 0; r < BS; ++r) acc[r] = _mm256_setzero_ps();
+
+    for (int e = 0; e < len; ++e) {
+        int k0 = bcols[e] * BS, kb = std::min(BS, cols - k0);
+        const float* blk = &blocks[(size_t)e * BS * BS];
+        #pragma GCC unroll 8
+        for (int kk = 0; kk < kb; ++kk) {
+            const float* b_row = &B[(long long)(k0 + kk) * ldb];
+            __m256 b = FULL ? _mm256_loadu_ps(b_row) : _mm256_maskload_ps(b_row, mask);
+            for (int r = 0; r < BS; ++r) acc[r] = _mm256_fmadd_ps(_mm256_broadcast_ss(&blk[r * BS + kk]), b, acc[r]);
+        }
+    }
+
+    for (int r = 0; r < mrows; ++r) {
+        float* c = &C[(long long)r * ldc];
+        if (FULL) {
+            _mm256_storeu_ps(c, _mm256_add_ps(_mm256_loadu_ps(c), acc[r]));
+        } else {
+            _mm256_maskstore_ps(c, mask, _mm256_add_ps(_mm256_maskload_ps(c, mask), acc[r]));
+        }
+    }
+}
+
+TARGET_AVX2
+static void bsr_rows_avx2(const int* row_ptr, const int* col_idx, const float* blocks, int row_begin, int row_end,
+                          int rows, int cols, const float* B, int ldb, float* C, int ldc, int j0, int j1) {
+    for (int br = row_begin; br < row_end; ++br) {
+        int begin = row_ptr[br], len = row_ptr[br + 1] - begin;
+        if (len == 0) continue;
+        int i0 = br * BS, mrows = std::min(BS, rows - i0);
+        float* c = &C[(long long)i0 * ldc];
+        const float* blk = &blocks[(size_t)begin * BS * BS];
+        int j = j0;
+        for (; j + 8 <= j1; j += 8) {
+            bsr_block_row_avx2<true>(&col_idx[begin], blk, len, cols, B + j, ldb, c + j, ldc, mrows, 8);
+        }
+        if (j < j1) bsr_block_row_avx2<false>(&col_idx[begin], blk, len, cols, B + j, ldb, c + j, ldc, mrows, j1 - j);
+    }
+}
+
+// AVX-512: CSR on 64-column strips, two sets of 4 ZMM accumulators
+static inline __mmask16 tail_mask16(int width) {
+    return width >= 16 ? (__mmask16)0xFFFF : width <= 0 ? (__mmask16)0 : (__mmask16)((1u << width) - 1);
+}
+
+template <bool FULL>
+TARGET_AVX512
+static inline void csr_row_avx512(const int* cols, const float* vals, int len, const float* B, int ldb, float* c,
+                                  int width) {
+    const int V = 4;
+    __mmask16 mask[V];
+    __m512 acc0[V], acc1[V];
+    for (int v = 0; v < V; ++v) {
+        mask[v] = tail_mask16(width - 16 * v);
+        acc0[v] = FULL ? _mm512_loadu_ps(c + 16 * v) : _mm512_maskz_loadu_ps(mask[v], c + 16 * v);
+        acc1[v] = _mm512_setzero_ps();
+    }
+
+    int e = 0;
+    for (; e + 2 <= len; e += 2) {
+        __m512 a0 = _mm512_set1_ps(vals[e]);
+        __m512 a1 = _mm512_set1_ps(vals[e + 1]);
+        const float* b0 = &B[(long long)cols[e] * ldb];
+        const float* b1 = &B[(long long)cols[e + 1] * ldb];
+        for (int v = 0; v < V; ++v) {
+            __m512 x0 = FULL ? _mm512_loadu_ps(b0 + 16 * v) : _mm512_maskz_loadu_ps(mask[v], b0 + 16 * v);
+            __m512 x1 = FULL ? _mm512_loadu_ps(b1 + 16 * v) : _mm512_maskz_loadu_ps(mask[v], b1 + 16 * v);
+            acc0[v] = _mm512_fmadd_ps(a0, x0, acc0[v]);
+            acc1[v] = _mm512_fmadd_ps(a1, x1, acc1[v]);
+        }
+    }
+    if (e < len) {
+        __m512 a0 = _mm512_set1_ps(vals[e]);
+        const float* b0 = &B[(long long)cols[e] * ldb];
+        for (int v = 0; v < V; ++v) {
+            __m512 x0 = FULL ? _mm512_loadu_ps(b0 + 16 * v) : _mm512_maskz_loadu_ps(mask[v], b0 + 16 * v);
+            acc0[v] = _mm512_fmadd_ps(a0, x0, acc0[v]);
+        }
+    }
+
+    for (int v = 0; v < V; ++v) {
+        _mm512_mask_storeu_ps(c + 16 * v, mask[v], _mm512_add_ps(acc0[v], acc1[v]));
+    }
+}
+
+TARGET_AVX512
+static void csr_rows_avx512(const int* row_ptr, const int* col_idx, const float* values, int row_begin,
+                            int row_end, const float* B, int ldb, float* C, int ldc, int j0, int j1) {
+    for (int i = row_begin; i < row_end; ++i) {
+        int begin = row_ptr[i], len = row_ptr[i + 1] - begin;
+        if (len == 0) continue;
+        float* c = &C[(long long)i * ldc];
+        int j = j0;
+        for (; j + 64 <= j1; j += 64) {
+            csr_row_avx512<true>(&col_idx[begin], &values[begin], len, B + j, ldb, c + j, 64);
+        }
+        if (j < j1) csr_row_avx512<false>(&col_idx[begin], &values[begin], len, B + j, ldb, c + j, j1 - j);
+    }
+}
+
+// AVX-512: BSR, one block row x 32 columns (8 x 2 ZMM accumulators)
+template <bool FULL>
+TARGET_AVX512
+static inline void bsr_block_row_avx512(const int* bcols, const float* blocks, int len, int cols, const float* B,
+                                        int ldb, float* C, int ldc, int mrows, int width) {
+    const __mmask16 m0 = tail_mask16(width), m1 = tail_mask16(width - 16);
+    __m512 acc[BS][2];
+    for (int r = 0; r < BS; ++r) acc[r][0] = acc[r][1] = _mm512_setzero_ps();
+
+    for (int e = 0; e < len; ++e) {
+        int k0 = bcols[e] * BS, kb = std::min(BS, cols - k0);
+        const float* blk = &blocks[(size_t)e * BS * BS];
+        #pragma GCC unroll 8
+        for (int kk = 0; kk < kb; ++kk) {
+            const float* b_row = &B[(long long)(k0 + kk) * ldb];
+            __m512 b0 = FULL ? _mm512_loadu_ps(b_row) : _mm512_maskz_loadu_ps(m0, b_row);
+            __m512 b1 = FULL ? _mm512_loadu_ps(b_row + 16) : _mm512_maskz_loadu_ps(m1, b_row + 16);
+            for (int r = 0; r < BS; ++r) {
+                __m512 a = _mm512_set1_ps(blk[r * BS + kk]);
+                acc[r][0] = _mm512_fmadd_ps(a, b0, acc[r][0]);
+                acc[r][1] = _mm512_fmadd_ps(a, b1, acc[r][1]);
+            }
+        }
+    }
+
+    for (int r = 0; r < mrows; ++r) {
+        float* c = &C[(long long)r * ldc];
+        _mm512_mask_storeu_ps(c, m0, _mm512_add_ps(_mm512_maskz_loadu_ps(m0, c), acc[r][0]));
+        _mm512_mask_storeu_ps(c + 16, m1, _mm512_add_ps(_mm512_maskz_loadu_ps(m1, c + 16), acc[r][1]));
+    }
+}
+
+TARGET_AVX512
+static void bsr_rows_avx512(const int* row_ptr, const int* col_idx, const float* blocks, int row_begin,
+                            int row_end, int rows, int cols, const float* B, int ldb, float* C, int ldc,
+                            int j0, int j1) {
+    for (int br = row_begin; br < row_end; ++br) {
+        int begin = row_ptr[br], len = row_ptr[br + 1] - begin;
+        if (len == 0) continue;
+        int i0 = br * BS, mrows = std::min(BS, rows - i0);
+        float* c = &C[(long long)i0 * ldc];
+        const float* blk = &blocks[(size_t)begin * BS * BS];
+        int j = j0;
+        for (; j + 32 <= j1; j += 32) {
+            bsr_block_row_avx512<true>(&col_idx[begin], blk, len, cols, B + j, ldb, c + j, ldc, mrows, 32);
+        }
+        if (j < j1) {
+            bsr_block_row_avx512<false>(&col_idx[begin], blk, len, cols, B + j, ldb, c + j, ldc, mrows, j1 - j);
+        }
+    }
+}
+
+static const SparseKernels& sparse_kernels() {
+    static const SparseKernels kernels[] = {
+        {"scalar", 64, 64, csr_rows_scalar, bsr_rows_scalar},
+        {"avx2", 32, 8, csr_rows_avx2, bsr_rows_avx2},
+        {"avx512", 64, 32, csr_rows_avx512, bsr_rows_avx512},
+    };
+    return kernels[static_cast<int>(active_cpu_isa())];
+}
+
+const char* sparse_kernel_name() {
+    return sparse_kernels().name;
+}
+
+// Driver
+
+// FLOPs per thread below which another thread does not pay off
+const double SPARSE_FLOPS_PER_THREAD = 2e6;
+
+// Splits [0, units) into `parts` ranges of about equal cost, where a row (block
+// row) costs its nonzeros (blocks) plus one for the row itself. bounds gets
+// parts + 1 entries.
+static void balanced_split(const std::vector<int>& ptr, int units, int parts, std::vector<int>& bounds) {
+    bounds.assign(parts + 1, units);
+    bounds[0] = 0;
+    long long total = (long long)ptr[units] + units;
+    for (int t = 1; t < parts; ++t) {
+        long long target = total * t / parts;
+        // First unit whose prefix cost reaches the target
+        int lo = bounds[t - 1], hi = units;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if ((long long)ptr[mid] + mid < target) lo = mid + 1;
+            else hi = mid;
+        }
+        bounds[t] = lo;
+    }
+}
+
+// Columns of B per panel: the panel (all cols rows of it) fills half of L2, since
+// the nonzeros read its rows in no particular order
+static int sparse_panel(int cols, int strip) {
+    static const long l2 = detect_cache_sizes().l2;
+    long width = l2 / 2 / ((long)cols * sizeof(float)) / strip * strip;
+    return (int)std::max((long)strip, width);
+}
+
+bool matmul_sparse(const SparseMatrix& A, const float* B, int ldb, float* C, int ldc, int p, int num_threads) {
+    if (A.empty() || !B || !C || p <= 0 || ldb < p || ldc < p) return false;
+    const int m = A.rows(), n = A.cols();
+
+    if (A.format() == SparseFormat::Dense) {
+        matmul_optimized_sgemm_strided(A.values().data(), n, B, ldb, C, ldc, m, n, p);
+        return true;
+    }
+
+    const SparseKernels& kern = sparse_kernels();
+    const bool bsr = A.format() == SparseFormat::BSR;
+    const int units = bsr ? (m + BS - 1) / BS : m;
+    const std::vector<int>& ptr = A.row_ptr();
+    const double flops = 2.0 * p * (bsr ? (double)ptr[units] * BS * BS : (double)A.nnz());
+
+    if (num_threads <= 0) {
+        num_threads = omp_in_parallel()
+                          ? 1
+                          : std::min(omp_get_max_threads(), (int)std::ceil(flops / SPARSE_FLOPS_PER_THREAD));
+    }
+    const int parts = std::max(1, std::min(num_threads, units));
+    std::vector<int> bounds;
+    balanced_split(ptr, units, parts, bounds);
+
+    const int PW = sparse_panel(n, bsr ? kern.bsr_strip : kern.csr_strip);
+    const int* col_idx = A.col_idx().data();
+    const float* values = A.values().data();
+
+    #pragma omp parallel num_threads(parts) if(parts > 1)
+    {
+        for (int part = omp_get_thread_num(); part < parts; part += omp_get_num_threads()) {
+            for (int j0 = 0; j0 < p; j0 += PW) {
+                int j1 = std::min(p, j0 + PW);
+                if (bsr) {
+                    kern.bsr(ptr.data(), col_idx, values, bounds[part], bounds[part + 1], m, n, B, ldb, C, ldc, j0, j1);
+                } else {
+                    kern.csr(ptr.data(), col_idx, values, bounds[part], bounds[part + 1], B, ldb, C, ldc, j0, j1);
+                }
+            }
+        }
+    }
+    return true;
+}
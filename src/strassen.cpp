@@ -1,142 +1,413 @@
 #include "../include/matrix_utils.h"
+#include "../include/sgemm.h"
+#include "../include/tuning.h"
 #include <algorithm>
+#include <atomic>
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+#include <omp.h>
 
-// Helper to add matrices
-void add_matrix(const Matrix& A, const Matrix& B, Matrix& C, int size) {
-    for (int i = 0; i < size * size; ++i) {
-        C[i] = A[i] + B[i];
+// Strassen-Winograd
+// - Quadrants are never copied out: every operand is a strided view
+//   (pointer + leading dimension) into the parent matrix or a temporary.
+// - Winograd's variant needs 7 multiplications and 15 additions per level
+//   (classic Strassen needs 18 additions).
+// - All scratch space comes from one workspace allocated up front. Each level
+//   needs two temporaries of a quarter of the operands (X for sums of A quadrants,
+//   Y for sums of B quadrants), the rest of the schedule reuses the quadrants of C.
+//   Over the whole recursion that is at most 2/3 of the operand size.
+// - Any m x n x p works: odd dimensions are peeled (dynamic peeling), i.e. the
+//   recursion runs on the even part and the left-over row/column of C and the
+//   left-over rank-1 update are fixed up afterwards in O(n^2).
+// - Recursion stops once any dimension drops to the cutoff, and the leaves run
+//   the packed SGEMM kernel. The cutoff comes from the tuning profile (strassen_cutoff).
+//
+// Peak extra memory of matmul_strassen for an n x n product:
+//   n^2 (product buffer, since matmul_strassen accumulates into C) + 2/3 n^2
+//   (recursion workspace) ~= 1.67 n^2 floats, independent of the recursion depth.
+
+// C = A + B on rows x cols views
+void add_view(int rows, int cols, const float* A, int lda, const float* B, int ldb, float* C, int ldc) {
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            C[i * ldc + j] = A[i * lda + j] + B[i * ldb + j];
+        }
     }
 }
 
-// Helper to subtract matrices
-void sub_matrix(const Matrix& A, const Matrix& B, Matrix& C, int size) {
-    for (int i = 0; i < size * size; ++i) {
-        C[i] = A[i] - B[i];
+// C = A - B on rows x cols views
+void sub_view(int rows, int cols, const float* A, int lda, const float* B, int ldb, float* C, int ldc) {
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            C[i * ldc + j] = A[i * lda + j] - B[i * ldb + j];
+        }
     }
 }
 
-// Recursive Strassen
-// Note: This is a simplified version for square matrices of power of 2 size.
-// For general matrices, padding is needed, which is complex.
-// We will implement a hybrid: Strassen for large sizes, Naive/Tiled for small.
-// And we will assume square matrices for simplicity in this demo, or handle rectangular via padding if needed.
-// For this project, let's stick to square matrices for Strassen or fallback.
-void strassen_recursive(const Matrix& A, const Matrix& B, Matrix& C, int size) {
-    if (size <= 64) {
-        // Base case: Use naive or tiled
-        // We'll implement a mini-naive here to avoid circular dependency or linking issues
-        for (int i = 0; i < size; ++i) {
-            for (int k = 0; k < size; ++k) {
-                float a_val = A[i * size + k];
-                for (int j = 0; j < size; ++j) {
-                    C[i * size + j] += a_val * B[k * size + j];
-                }
+static bool strassen_recurses(int m, int n, int p, int cutoff) {
+    return m > cutoff && n > cutoff && p > cutoff;
+}
+
+// Number of floats strassen_recursive needs as workspace for a given shape
+size_t strassen_workspace_size(int m, int n, int p, int cutoff) {
+    size_t total = 0;
+    while (strassen_recurses(m, n, p, cutoff)) {
+        size_t hm = m / 2, hn = n / 2, hp = p / 2;
+        total += hm * padded_ld((int)std::max(hn, hp)) + hn * padded_ld((int)hp); // X + Y
+        m /= 2;
+        n /= 2;
+        p /= 2;
+    }
+    return total;
+}
+
+// Dynamic peeling. The recursion covered C[0:me, 0:pe] using A[:, 0:ne], where
+// me/ne/pe are m/n/p rounded down to even; this fixes up the rest of C.
+void strassen_peel(const float* A, int lda, const float* B, int ldb, float* C, int ldc, int m, int n, int p) {
+    int me = m / 2 * 2, ne = n / 2 * 2, pe = p / 2 * 2;
+
+    // Odd n: rank-1 update with the last column of A and the last row of B
+    if (ne < n) {
+        const float* b_row = &B[ne * ldb];
+        for (int i = 0; i < me; ++i) {
+            float a_val = A[i * lda + ne];
+            for (int j = 0; j < pe; ++j) {
+                C[i * ldc + j] += a_val * b_row[j];
             }
         }
-        return;
     }
 
-    int new_size = size / 2;
-    int sub_len = new_size * new_size;
-
-    // Allocate submatrices
-    Matrix A11(sub_len), A12(sub_len), A21(sub_len), A22(sub_len);
-    Matrix B11(sub_len), B12(sub_len), B21(sub_len), B22(sub_len);
-    Matrix C11(sub_len), C12(sub_len), C21(sub_len), C22(sub_len);
-    Matrix M1(sub_len), M2(sub_len), M3(sub_len), M4(sub_len), M5(sub_len), M6(sub_len), M7(sub_len);
-    Matrix Temp1(sub_len), Temp2(sub_len);
-
-    // Partition A and B
-    for (int i = 0; i < new_size; ++i) {
-        for (int j = 0; j < new_size; ++j) {
-            A11[i * new_size + j] = A[i * size + j];
-            A12[i * new_size + j] = A[i * size + (j + new_size)];
-            A21[i * new_size + j] = A[(i + new_size) * size + j];
-            A22[i * new_size + j] = A[(i + new_size) * size + (j + new_size)];
-
-            B11[i * new_size + j] = B[i * size + j];
-            B12[i * new_size + j] = B[i * size + (j + new_size)];
-            B21[i * new_size + j] = B[(i + new_size) * size + j];
-            B22[i * new_size + j] = B[(i + new_size) * size + (j + new_size)];
+    // Odd p: last column of C over the full n
+    if (pe < p) {
+        for (int i = 0; i < me; ++i) {
+            float sum = 0.0f;
+            for (int k = 0; k < n; ++k) {
+                sum += A[i * lda + k] * B[k * ldb + pe];
+            }
+            C[i * ldc + pe] = sum;
         }
     }
 
-    // M1 = (A11 + A22) * (B11 + B22)
-    add_matrix(A11, A22, Temp1, new_size);
-    add_matrix(B11, B22, Temp2, new_size);
-    strassen_recursive(Temp1, Temp2, M1, new_size);
+    // Odd m: last row of C over the full n and p
+    if (me < m) {
+        float* c_row = &C[me * ldc];
+        std::fill(c_row, c_row + p, 0.0f);
+        for (int k = 0; k < n; ++k) {
+            float a_val = A[me * lda + k];
+            for (int j = 0; j < p; ++j) {
+                c_row[j] += a_val * B[k * ldb + j];
+            }
+        }
+    }
+}
 
-    // M2 = (A21 + A22) * B11
-    add_matrix(A21, A22, Temp1, new_size);
-    strassen_recursive(Temp1, B11, M2, new_size);
+// Recursive Strassen-Winograd: C = A * B (overwrites C)
+// A is m x n, B is n x p, C is m x p.
+// ws must hold strassen_workspace_size(m, n, p, cutoff) floats.
+void strassen_recursive(const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                        int m, int n, int p, float* ws, int cutoff) {
+    if (!strassen_recurses(m, n, p, cutoff)) {
+        // Base case: packed SGEMM, beta = 0 overwrites C without reading it
+        sgemm('N', 'N', m, p, n, 1.0f, A, lda, B, ldb, 0.0f, C, ldc);
+        return;
+    }
+
+    // Even part handled by the recursion, odd remainders are peeled below
+    int hm = m / 2, hn = n / 2, hp = p / 2;
+
+    // Quadrant views (no copies)
+    const float* A11 = A;
+    const float* A12 = A + hn;
+    const float* A21 = A + hm * lda;
+    const float* A22 = A + hm * lda + hn;
+    const float* B11 = B;
+    const float* B12 = B + hp;
+    const float* B21 = B + hn * ldb;
+    const float* B22 = B + hn * ldb + hp;
+    float* C11 = C;
+    float* C12 = C + hp;
+    float* C21 = C + hm * ldc;
+    float* C22 = C + hm * ldc + hp;
+
+    // Temporaries for this level, the rest of ws goes to the recursive calls.
+    // X holds hm x hn sums of A quadrants and later the hm x hp product P1.
+    // Their rows are padded (padded_ld), otherwise the power-of-two halves of
+    // 1024/2048/4096 shapes give 4K-aliasing strides.
+    int ldx = padded_ld(std::max(hn, hp));
+    int ldy = padded_ld(hp);
+    float* X = ws;
+    float* Y = ws + (size_t)hm * ldx;
+    float* child_ws = Y + (size_t)hn * ldy;
 
-    // M3 = A11 * (B12 - B22)
-    sub_matrix(B12, B22, Temp2, new_size);
-    strassen_recursive(A11, Temp2, M3, new_size);
+    // Winograd schedule with two temporaries (Douglas et al.):
+    //   S1 = A21 + A22   S2 = S1 - A11   S3 = A11 - A21   S4 = A12 - S2
+    //   T1 = B12 - B11   T2 = B22 - T1   T3 = B22 - B12   T4 = T2 - B21
+    //   P1 = A11 B11  P2 = A12 B21  P3 = S4 B22  P4 = A22 T4
+    //   P5 = S1 T1    P6 = S2 T2    P7 = S3 T3
+    //   C11 = P1 + P2         U2 = P1 + P6        U3 = U2 + P7
+    //   C12 = U2 + P5 + P3    C21 = U3 - P4       C22 = U3 + P5
+    sub_view(hm, hn, A11, lda, A21, lda, X, ldx);                                // X   = S3
+    sub_view(hn, hp, B22, ldb, B12, ldb, Y, ldy);                                // Y   = T3
+    strassen_recursive(X, ldx, Y, ldy, C21, ldc, hm, hn, hp, child_ws, cutoff);  // C21 = P7
+    add_view(hm, hn, A21, lda, A22, lda, X, ldx);                                // X   = S1
+    sub_view(hn, hp, B12, ldb, B11, ldb, Y, ldy);                                // Y   = T1
+    strassen_recursive(X, ldx, Y, ldy, C22, ldc, hm, hn, hp, child_ws, cutoff);  // C22 = P5
+    sub_view(hm, hn, X, ldx, A11, lda, X, ldx);                                  // X   = S2
+    sub_view(hn, hp, B22, ldb, Y, ldy, Y, ldy);                                  // Y   = T2
+    strassen_recursive(X, ldx, Y, ldy, C12, ldc, hm, hn, hp, child_ws, cutoff);  // C12 = P6
+    sub_view(hm, hn, A12, lda, X, ldx, X, ldx);                                  // X   = S4
+    strassen_recursive(X, ldx, B22, ldb, C11, ldc, hm, hn, hp, child_ws, cutoff); // C11 = P3
+    strassen_recursive(A11, lda, B11, ldb, X, ldx, hm, hn, hp, child_ws, cutoff); // X   = P1
+    add_view(hm, hp, X, ldx, C12, ldc, C12, ldc);                                // C12 = U2 = P1 + P6
+    add_view(hm, hp, C12, ldc, C21, ldc, C21, ldc);                              // C21 = U3 = U2 + P7
+    add_view(hm, hp, C12, ldc, C22, ldc, C12, ldc);                              // C12 = U4 = U2 + P5
+    add_view(hm, hp, C21, ldc, C22, ldc, C22, ldc);                              // C22 = U7 = U3 + P5
+    add_view(hm, hp, C12, ldc, C11, ldc, C12, ldc);                              // C12 = U5 = U4 + P3
+    sub_view(hn, hp, Y, ldy, B21, ldb, Y, ldy);                                  // Y   = T4
+    strassen_recursive(A22, lda, Y, ldy, C11, ldc, hm, hn, hp, child_ws, cutoff); // C11 = P4
+    sub_view(hm, hp, C21, ldc, C11, ldc, C21, ldc);                              // C21 = U6 = U3 - P4
+    strassen_recursive(A12, lda, B21, ldb, C11, ldc, hm, hn, hp, child_ws, cutoff); // C11 = P2
+    add_view(hm, hp, X, ldx, C11, ldc, C11, ldc);                                // C11 = U1 = P1 + P2
 
-    // M4 = A22 * (B21 - B11)
-    sub_matrix(B21, B11, Temp2, new_size);
-    strassen_recursive(A22, Temp2, M4, new_size);
+    strassen_peel(A, lda, B, ldb, C, ldc, m, n, p);
+}
+
+// Parallel Strassen-Winograd (task based)
+// The two-temporary schedule above is inherently sequential (X, Y and the C
+// quadrants are reused as scratch). The parallel levels instead give every one
+// of the seven products its own operand sums, its own output buffer and its own
+// slice of the workspace, so the products run as independent OpenMP tasks and
+// never share temporaries:
+//   [S1..S4: 4 x hm*hn] [T1..T4: 4 x hn*hp] [P1..P7: 7 x hm*hp] [7 child workspaces]
+// Below task_depth the tasks fall back to the sequential strassen_recursive.
+// For an n x n product with task depth d this is about (15/4) n^2 * (1 + 7/4 + ...)
+// floats, i.e. ~3.75 n^2 for d = 1 and ~10.3 n^2 for d = 2 (plus the product buffer).
+size_t strassen_parallel_workspace_size(int m, int n, int p, int cutoff, int depth) {
+    if (depth <= 0 || !strassen_recurses(m, n, p, cutoff)) {
+        return strassen_workspace_size(m, n, p, cutoff);
+    }
+    size_t hm = m / 2, hn = n / 2, hp = p / 2;
+    size_t lds = padded_ld((int)hn), ldt = padded_ld((int)hp);
+    return 4 * hm * lds + 4 * hn * ldt + 7 * hm * ldt +
+           7 * strassen_parallel_workspace_size(hm, hn, hp, cutoff, depth - 1);
+}
 
-    // M5 = (A11 + A12) * B22
-    add_matrix(A11, A12, Temp1, new_size);
-    strassen_recursive(Temp1, B22, M5, new_size);
+// C = A * B (overwrites C). Must be called from inside a parallel region
+// (it only creates tasks); ws must hold strassen_parallel_workspace_size() floats.
+void strassen_parallel(const float* A, int lda, const float* B, int ldb, float* C, int ldc,
+                       int m, int n, int p, float* ws, int cutoff, int depth) {
+    if (depth <= 0 || !strassen_recurses(m, n, p, cutoff)) {
+        strassen_recursive(A, lda, B, ldb, C, ldc, m, n, p, ws, cutoff);
+        return;
+    }
 
-    // M6 = (A21 - A11) * (B11 + B12)
-    sub_matrix(A21, A11, Temp1, new_size);
-    add_matrix(B11, B12, Temp2, new_size);
-    strassen_recursive(Temp1, Temp2, M6, new_size);
+    int hm = m / 2, hn = n / 2, hp = p / 2;
 
-    // M7 = (A12 - A22) * (B21 + B22)
-    sub_matrix(A12, A22, Temp1, new_size);
-    add_matrix(B21, B22, Temp2, new_size);
-    strassen_recursive(Temp1, Temp2, M7, new_size);
+    const float* A11 = A;
+    const float* A12 = A + hn;
+    const float* A21 = A + hm * lda;
+    const float* A22 = A + hm * lda + hn;
+    const float* B11 = B;
+    const float* B12 = B + hp;
+    const float* B21 = B + hn * ldb;
+    const float* B22 = B + hn * ldb + hp;
 
-    // C11 = M1 + M4 - M5 + M7
-    for (int i = 0; i < sub_len; ++i) C11[i] = M1[i] + M4[i] - M5[i] + M7[i];
+    // Carve up the workspace (see layout above). Rows are padded like the
+    // temporaries of strassen_recursive: S has ld lds, T and P have ld ldt.
+    int lds = padded_ld(hn), ldt = padded_ld(hp);
+    size_t a_len = (size_t)hm * lds, b_len = (size_t)hn * ldt, c_len = (size_t)hm * ldt;
+    float* S[4];
+    float* T[4];
+    float* P[7];
+    float* child_ws[7];
+    float* next = ws;
+    for (int i = 0; i < 4; ++i, next += a_len) S[i] = next;
+    for (int i = 0; i < 4; ++i, next += b_len) T[i] = next;
+    for (int i = 0; i < 7; ++i, next += c_len) P[i] = next;
+    size_t child_len = strassen_parallel_workspace_size(hm, hn, hp, cutoff, depth - 1);
+    for (int i = 0; i < 7; ++i, next += child_len) child_ws[i] = next;
 
-    // C12 = M3 + M5
-    for (int i = 0; i < sub_len; ++i) C12[i] = M3[i] + M5[i];
+    // Operand sums: the A-side and B-side chains are independent of each other
+    #pragma omp taskgroup
+    {
+        #pragma omp task
+        {
+            add_view(hm, hn, A21, lda, A22, lda, S[0], lds);    // S1 = A21 + A22
+            sub_view(hm, hn, S[0], lds, A11, lda, S[1], lds);    // S2 = S1 - A11
+            sub_view(hm, hn, A11, lda, A21, lda, S[2], lds);    // S3 = A11 - A21
+            sub_view(hm, hn, A12, lda, S[1], lds, S[3], lds);    // S4 = A12 - S2
+        }
+        #pragma omp task
+        {
+            sub_view(hn, hp, B12, ldb, B11, ldb, T[0], ldt);    // T1 = B12 - B11
+            sub_view(hn, hp, B22, ldb, T[0], ldt, T[1], ldt);    // T2 = B22 - T1
+            sub_view(hn, hp, B22, ldb, B12, ldb, T[2], ldt);    // T3 = B22 - B12
+            sub_view(hn, hp, T[1], ldt, B21, ldb, T[3], ldt);    // T4 = T2 - B21
+        }
+    }
 
-    // C21 = M2 + M4
-    for (int i = 0; i < sub_len; ++i) C21[i] = M2[i] + M4[i];
+    // The seven products, each into its own buffer with its own workspace
+    const float* left[7] = {A11, A12, S[3], A22, S[0], S[1], S[2]};
+    const int left_ld[7] = {lda, lda, lds, lda, lds, lds, lds};
+    const float* right[7] = {B11, B21, B22, T[3], T[0], T[1], T[2]};
+    const int right_ld[7] = {ldb, ldb, ldb, ldt, ldt, ldt, ldt};
 
-    // C22 = M1 - M2 + M3 + M6
-    for (int i = 0; i < sub_len; ++i) C22[i] = M1[i] - M2[i] + M3[i] + M6[i];
+    #pragma omp taskgroup
+    {
+        for (int i = 0; i < 7; ++i) {
+            #pragma omp task firstprivate(i)
+            strassen_parallel(left[i], left_ld[i], right[i], right_ld[i], P[i], ldt,
+                              hm, hn, hp, child_ws[i], cutoff, depth - 1);
+        }
+    }
 
-    // Combine C
-    for (int i = 0; i < new_size; ++i) {
-        for (int j = 0; j < new_size; ++j) {
-            C[i * size + j] += C11[i * new_size + j];
-            C[i * size + (j + new_size)] += C12[i * new_size + j];
-            C[(i + new_size) * size + j] += C21[i * new_size + j];
-            C[(i + new_size) * size + (j + new_size)] += C22[i * new_size + j];
+    // Combine, split over rows of the quadrants:
+    //   C11 = P1 + P2   C12 = P1 + P6 + P5 + P3   C21 = P1 + P6 + P7 - P4   C22 = P1 + P6 + P7 + P5
+    #pragma omp taskloop grainsize(16)
+    for (int i = 0; i < hm; ++i) {
+        const float* p1 = &P[0][i * ldt];
+        const float* p2 = &P[1][i * ldt];
+        const float* p3 = &P[2][i * ldt];
+        const float* p4 = &P[3][i * ldt];
+        const float* p5 = &P[4][i * ldt];
+        const float* p6 = &P[5][i * ldt];
+        const float* p7 = &P[6][i * ldt];
+        float* c11 = &C[i * ldc];
+        float* c12 = &C[i * ldc + hp];
+        float* c21 = &C[(i + hm) * ldc];
+        float* c22 = &C[(i + hm) * ldc + hp];
+        for (int j = 0; j < hp; ++j) {
+            float u2 = p1[j] + p6[j];
+            float u3 = u2 + p7[j];
+            c11[j] = p1[j] + p2[j];
+            c12[j] = u2 + p5[j] + p3[j];
+            c21[j] = u3 - p4[j];
+            c22[j] = u3 + p5[j];
         }
     }
+
+    strassen_peel(A, lda, B, ldb, C, ldc, m, n, p);
+}
+
+// Measure the recursion cutoff on this machine (autotune_blocking, stored in the
+// tuning profile; never run implicitly, it takes seconds).
+// For s = 128, 256, ... we time one Strassen level (7 packed SGEMMs of size s/2
+// plus the additions) against a single packed SGEMM of size s. The cutoff is the
+// largest s where the plain SGEMM still wins, so recursion only happens on sizes
+// where one more level was measured to pay off.
+int calibrate_strassen_cutoff(bool verbose) {
+    const int sizes[] = {128, 256, 512, 1024};
+    const int trials = 3;
+    int cutoff = sizes[0];
+
+    for (int s : sizes) {
+        Matrix A, B, C;
+        randomize_matrix(A, s, s);
+        randomize_matrix(B, s, s);
+        zeros_matrix(C, s, s);
+        AlignedVector ws(strassen_workspace_size(s, s, s, s / 2));
+
+        double t_gemm = 1e9, t_strassen = 1e9;
+        for (int t = 0; t < trials; ++t) {
+            auto start = std::chrono::high_resolution_clock::now();
+            matmul_optimized_sgemm_strided(A.data(), s, B.data(), s, C.data(), s, s, s, s);
+            auto mid = std::chrono::high_resolution_clock::now();
+            strassen_recursive(A.data(), s, B.data(), s, C.data(), s, s, s, s, ws.data(), s / 2);
+            auto end = std::chrono::high_resolution_clock::now();
+            t_gemm = std::min(t_gemm, std::chrono::duration<double>(mid - start).count());
+            t_strassen = std::min(t_strassen, std::chrono::duration<double>(end - mid).count());
+        }
+        if (verbose) {
+            std::cout << "autotune: Strassen " << s << "^3 " << t_strassen * 1e3 << " ms, SGEMM " << t_gemm * 1e3
+                      << " ms" << std::endl;
+        }
+
+        if (t_strassen < t_gemm) break;
+        cutoff = s;
+    }
+    return cutoff;
+}
+
+// Recursion cutoff: MATMUL_STRASSEN_CUTOFF if set, otherwise the tuning profile
+// (measured by --autotune) or DEFAULT_STRASSEN_CUTOFF (tuning.h).
+int strassen_cutoff() {
+    static const int env_cutoff = [] {
+        const char* env = std::getenv("MATMUL_STRASSEN_CUTOFF");
+        return env ? std::max(0, std::atoi(env)) : 0;
+    }();
+    return env_cutoff > 0 ? env_cutoff : blocking_params().strassen_cutoff;
+}
+
+// Task depth for matmul_strassen_parallel: number of levels whose seven products
+// run as concurrent tasks. -1 = automatic (enough levels for 7^depth >= threads, at
+// most 2, since every parallel level multiplies the workspace by ~7/4).
+// Atomic: it can be set while products on other threads read it.
+static std::atomic<int> g_strassen_task_depth{-1};
+
+void set_strassen_task_depth(int depth) {
+    g_strassen_task_depth.store(depth, std::memory_order_relaxed);
+}
+
+int strassen_task_depth() {
+    int depth = g_strassen_task_depth.load(std::memory_order_relaxed);
+    if (depth >= 0) return depth;
+    const char* env = std::getenv("MATMUL_STRASSEN_TASK_DEPTH");
+    if (env && std::atoi(env) >= 0) return std::atoi(env);
+    int threads = omp_get_max_threads();
+    return threads <= 1 ? 0 : (threads <= 7 ? 1 : 2);
 }
 
 void matmul_strassen(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
-    // Only support square matrices for now
-    if (m != n || n != p) {
-        // Fallback to naive if not square
-        // In a real implementation, we would pad.
-        // For this demo, we just print a warning or fallback.
-        // Let's fallback to a simple loop.
-        for (int i = 0; i < m; ++i) {
-            for (int k = 0; k < n; ++k) {
-                float a_val = A[i * n + k];
-                for (int j = 0; j < p; ++j) {
-                    C[i * p + j] += a_val * B[k * p + j];
-                }
-            }
+    int cutoff = strassen_cutoff();
+
+    // Too small for even one level: the packed SGEMM accumulates directly into C
+    if (!strassen_recurses(m, n, p, cutoff)) {
+        matmul_optimized_sgemm_strided(A.data(), n, B.data(), p, C.data(), p, m, n, p);
+        return;
+    }
+
+    // One allocation for the whole call: the product (the recursion overwrites its
+    // output, but matmul_strassen accumulates like the other kernels) followed by
+    // the recursion workspace. Neither needs zeroing, so it is an AlignedVector.
+    int ldp = padded_ld(p);
+    size_t len = (size_t)m * ldp;
+    AlignedVector workspace(len + strassen_workspace_size(m, n, p, cutoff));
+    float* product = workspace.data();
+
+    strassen_recursive(A.data(), n, B.data(), p, product, ldp, m, n, p, product + len, cutoff);
+
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < p; ++j) {
+            C[i * p + j] += product[(size_t)i * ldp + j];
         }
+    }
+}
+
+// Parallel mode: the seven products of the top task_depth levels run as OpenMP
+// tasks (see strassen_parallel), the final accumulation is a parallel loop.
+void matmul_strassen_parallel(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+    int cutoff = strassen_cutoff();
+    int depth = strassen_task_depth();
+
+    if (!strassen_recurses(m, n, p, cutoff)) {
+        matmul_optimized_sgemm_strided(A.data(), n, B.data(), p, C.data(), p, m, n, p);
         return;
     }
-    
-    // Ensure size is power of 2 or handle it. 
-    // For simplicity, we assume the benchmark harness passes power of 2 sizes (128, 256, etc.)
-    // If not, Strassen might fail or need padding.
-    // We'll assume power of 2 for the "massive project" demo unless requested otherwise.
-    
-    strassen_recursive(A, B, C, m);
+
+    int ldp = padded_ld(p);
+    size_t len = (size_t)m * ldp;
+    AlignedVector workspace(len + strassen_parallel_workspace_size(m, n, p, cutoff, depth));
+    float* product = workspace.data();
+
+    #pragma omp parallel
+    #pragma omp single
+    strassen_parallel(A.data(), n, B.data(), p, product, ldp, m, n, p, product + len, cutoff, depth);
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < p; ++j) {
+            C[i * p + j] += product[(size_t)i * ldp + j];
+        }
+    }
 }
@@ -0,0 +1,158 @@
+#include "../include/thread_pool.h"
+#include <cstdlib>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Set while a thread is executing tasks of a pool, so nested parallel_for calls
+// run inline instead of deadlocking on the pool they are already part of.
+static thread_local bool t_inside_pool = false;
+
+static uint64_t pack_range(uint32_t begin, uint32_t end) {
+    return ((uint64_t)end << 32) | begin;
+}
+
+ThreadPool::ThreadPool(int num_threads, bool pin_threads)
+    : num_threads_(num_threads < 1 ? 1 : num_threads),
+      ranges_(new TaskRange[num_threads < 1 ? 1 : num_threads]) {
+    for (int id = 1; id < num_threads_; ++id) {
+        workers_.emplace_back([this, id]() { worker_loop(id); });
+
+#ifdef __linux__
+        if (pin_threads) {
+            unsigned hw = std::thread::hardware_concurrency();
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(hw ? id % hw : id, &set);
+            pthread_setaffinity_np(workers_.back().native_handle(), sizeof(set), &set);
+        }
+#else
+        (void)pin_threads;
+#endif
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_cv_.notify_all();
+    for (auto& th : workers_) {
+        if (th.joinable()) th.join();
+    }
+}
+
+ThreadPool& ThreadPool::global() {
+    static ThreadPool pool([] {
+        int n = std::thread::hardware_concurrency();
+        return n == 0 ? 4 : n; // Fallback
+    }(), [] {
+        const char* env = std::getenv("MATMUL_PIN_THREADS");
+        return env && std::atoi(env) != 0;
+    }());
+    return pool;
+}
+
+bool ThreadPool::pop_front(TaskRange& range, int& task) {
+    uint64_t cur = range.bounds.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t begin = (uint32_t)cur, end = (uint32_t)(cur >> 32);
+        if (begin >= end) return false;
+        if (range.bounds.compare_exchange_weak(cur, pack_range(begin + 1, end), std::memory_order_acq_rel)) {
+            task = (int)begin;
+            return true;
+        }
+    }
+}
+
+bool ThreadPool::steal_back(TaskRange& range, int& task) {
+    uint64_t cur = range.bounds.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t begin = (uint32_t)cur, end = (uint32_t)(cur >> 32);
+        if (begin >= end) return false;
+        if (range.bounds.compare_exchange_weak(cur, pack_range(begin, end - 1), std::memory_order_acq_rel)) {
+            task = (int)(end - 1);
+            return true;
+        }
+    }
+}
+
+void ThreadPool::run_participant(int id) {
+    const std::function<void(int)>& fn = *job_;
+    int participants = participants_;
+    t_inside_pool = true;
+
+    int task;
+    // Own range first (front to back, keeps neighbouring tiles on one thread)
+    while (pop_front(ranges_[id], task)) {
+        fn(task);
+    }
+    // Then steal from the others, starting with the next thread over
+    for (int offset = 1; offset < participants; ++offset) {
+        TaskRange& victim = ranges_[(id + offset) % participants];
+        while (steal_back(victim, task)) {
+            fn(task);
+        }
+    }
+
+    t_inside_pool = false;
+}
+
+void ThreadPool::worker_loop(int id) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_cv_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+            if (id >= participants_) continue; // Not needed for this call
+        }
+
+        run_participant(id);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) done_cv_.notify_one();
+    }
+}
+
+void ThreadPool::parallel_for(int num_tasks, const std::function<void(int)>& fn, int max_threads) {
+    if (num_tasks <= 0) return;
+
+    int participants = num_threads_;
+    if (max_threads > 0 && max_threads < participants) participants = max_threads;
+    if (num_tasks < participants) participants = num_tasks;
+
+    // Nothing to share, or already on a pool thread: run inline
+    if (participants <= 1 || t_inside_pool) {
+        for (int i = 0; i < num_tasks; ++i) fn(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> call_lock(call_mutex_);
+
+    // Static initial split, work stealing evens out the rest
+    for (int t = 0; t < participants; ++t) {
+        uint32_t begin = (uint32_t)((long long)num_tasks * t / participants);
+        uint32_t end = (uint32_t)((long long)num_tasks * (t + 1) / participants);
+        ranges_[t].bounds.store(pack_range(begin, end), std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &fn;
+        participants_ = participants;
+        pending_ = participants - 1;
+        ++generation_;
+    }
+    wake_cv_.notify_all();
+
+    run_participant(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&]() { return pending_ == 0; });
+    job_ = nullptr;
+}
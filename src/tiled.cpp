@@ -1,15 +1,15 @@
 #include "../include/matrix_utils.h"
+#include "../include/tuning.h"
 #include <algorithm>
 
 // Tiled / Blocked Implementation
 // Uses blocking to keep working sets in L1/L2 cache.
 void matmul_tiled(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
-    // Block size should be tuned. 
-    // L1 cache is usually 32KB. 3 matrices of block size BxB.
-    // 3 * B^2 * 4 bytes <= 32KB roughly.
-    // B^2 <= 2730 => B <= 52.
-    // Let's pick 32 or 64. 32 is safe.
-    const int BLOCK_SIZE = 32;
+    // Block size is tuned per machine (see tuning.h).
+    // Starting point: 3 matrices of block size BxB in L1.
+    // 3 * B^2 * 4 bytes <= L1, e.g. B <= 52 for a 32KB L1.
+    // The autotuner then measures the neighbouring sizes.
+    const int BLOCK_SIZE = blocking_params().tile_block;
 
     // We assume C is zeroed.
     
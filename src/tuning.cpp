@@ -0,0 +1,201 @@
+#include "../include/tuning.h"
+#include "../include/cpu_dispatch.h"
+#include "../include/matrix_utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+void matmul_optimized_sgemm(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
+void matmul_tiled(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p);
+int calibrate_strassen_cutoff(bool verbose);
+
+static int round_down(int value, int multiple) {
+    return std::max(multiple, value / multiple * multiple);
+}
+
+BlockingParams analytical_blocking() {
+    CacheSizes caches = detect_cache_sizes();
+    const SgemmKernel& kern = sgemm_kernel();
+    const long f = sizeof(float);
+
+    BlockingParams params;
+    params.kc = round_down(std::min(1024L, caches.l1d / 2 / (kern.nr * f)), 8);
+    params.mc = round_down(std::min(4096L, caches.l2 / 2 / (params.kc * f)), kern.mr);
+    params.nc = round_down(std::min(4096L, caches.l3 / 2 / (params.kc * f)), kern.nr);
+    params.tile_block = round_down((int)std::sqrt((double)caches.l1d / (3 * f)), 8);
+    params.strassen_cutoff = DEFAULT_STRASSEN_CUTOFF;
+    return params;
+}
+
+std::string tuning_profile_path() {
+    const char* env = std::getenv("MATMUL_TUNING_PROFILE");
+    return env ? env : "matmul_tuning.profile";
+}
+
+bool save_tuning_profile(const std::string& path, const BlockingParams& params) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "# matmul tuning profile (written by benchmark_runner --autotune)\n";
+    out << "kernel=" << sgemm_kernel().name << "\n";
+    out << "mc=" << params.mc << "\n";
+    out << "kc=" << params.kc << "\n";
+    out << "nc=" << params.nc << "\n";
+    out << "tile_block=" << params.tile_block << "\n";
+    out << "strassen_cutoff=" << params.strassen_cutoff << "\n";
+    return (bool)out;
+}
+
+bool load_tuning_profile(const std::string& path, BlockingParams& params) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    BlockingParams loaded = analytical_blocking();
+    bool kernel_matches = false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = line.substr(0, eq);
+        std::string value = line.substr(eq + 1);
+
+        if (key == "kernel") kernel_matches = (value == sgemm_kernel().name);
+        else if (key == "mc") loaded.mc = std::atoi(value.c_str());
+        else if (key == "kc") loaded.kc = std::atoi(value.c_str());
+        else if (key == "nc") loaded.nc = std::atoi(value.c_str());
+        else if (key == "tile_block") loaded.tile_block = std::atoi(value.c_str());
+        else if (key == "strassen_cutoff") loaded.strassen_cutoff = std::atoi(value.c_str());
+    }
+
+    // A profile tuned for another micro-kernel (e.g. copied from another machine
+    // type, or MATMUL_ISA forcing a different kernel) does not apply.
+    if (!kernel_matches) return false;
+    if (loaded.mc <= 0 || loaded.kc <= 0 || loaded.nc <= 0 || loaded.tile_block <= 0 ||
+        loaded.strassen_cutoff <= 0) {
+        return false;
+    }
+
+    params = loaded;
+    return true;
+}
+
+// The parameters in use, as an immutable snapshot. blocking_params() runs on
+// every GEMM (every batch item, Strassen leaf and async lane), so reading them is
+// one atomic load: no lock. set_blocking_params publishes a new snapshot; the old
+// ones stay alive (a reader may still be copying one) in g_retired_params.
+static std::atomic<const BlockingParams*> g_params{nullptr};
+static std::mutex g_retired_mutex;
+static std::vector<std::unique_ptr<BlockingParams>> g_retired_params;
+
+// Profile or cache model, loaded once on first use
+static const BlockingParams* startup_params() {
+    static const BlockingParams params = [] {
+        BlockingParams loaded;
+        if (!load_tuning_profile(tuning_profile_path(), loaded)) loaded = analytical_blocking();
+        return loaded;
+    }();
+    return &params;
+}
+
+BlockingParams blocking_params() {
+    const BlockingParams* params = g_params.load(std::memory_order_acquire);
+    return params ? *params : *startup_params();
+}
+
+void set_blocking_params(const BlockingParams& params) {
+    std::lock_guard<std::mutex> lock(g_retired_mutex);
+    g_retired_params.emplace_back(new BlockingParams(params));
+    g_params.store(g_retired_params.back().get(), std::memory_order_release);
+}
+
+// Best-of-`trials` time of one call of `func` on n x n operands
+static double time_kernel(void (*func)(const Matrix&, const Matrix&, Matrix&, int, int, int),
+                          const Matrix& A, const Matrix& B, Matrix& C, int n, int trials) {
+    double best = 1e9;
+    func(A, B, C, n, n, n); // Warmup
+    for (int t = 0; t < trials; ++t) {
+        zeros_matrix(C, n, n);
+        auto start = std::chrono::high_resolution_clock::now();
+        func(A, B, C, n, n, n);
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return best;
+}
+
+BlockingParams autotune_blocking(int n, bool verbose) {
+    const int trials = 3;
+    const SgemmKernel& kern = sgemm_kernel();
+    BlockingParams saved = blocking_params();
+
+    Matrix A, B, C;
+    randomize_matrix(A, n, n);
+    randomize_matrix(B, n, n);
+    zeros_matrix(C, n, n);
+
+    BlockingParams best = analytical_blocking();
+    set_blocking_params(best);
+    double best_time = time_kernel(matmul_optimized_sgemm, A, B, C, n, trials);
+    if (verbose) {
+        std::cout << "autotune: start MC=" << best.mc << " KC=" << best.kc << " NC=" << best.nc
+                  << " (" << 2.0 * n * n * n / (best_time * 1e9) << " GFLOPS)" << std::endl;
+    }
+
+    // Coordinate search: one parameter at a time, keeping the best so far
+    const double scales[] = {0.5, 0.75, 1.5, 2.0};
+    int BlockingParams::*fields[] = {&BlockingParams::kc, &BlockingParams::mc, &BlockingParams::nc};
+    const int multiples[] = {8, kern.mr, kern.nr};
+    const char* names[] = {"KC", "MC", "NC"};
+
+    for (int f = 0; f < 3; ++f) {
+        int base = best.*fields[f];
+        for (double scale : scales) {
+            BlockingParams trial = best;
+            trial.*fields[f] = round_down((int)(base * scale), multiples[f]);
+            if (trial.*fields[f] == best.*fields[f]) continue;
+
+            set_blocking_params(trial);
+            double t = time_kernel(matmul_optimized_sgemm, A, B, C, n, trials);
+            if (verbose) {
+                std::cout << "autotune: " << names[f] << "=" << trial.*fields[f] << " "
+                          << 2.0 * n * n * n / (t * 1e9) << " GFLOPS" << std::endl;
+            }
+            if (t < best_time) {
+                best_time = t;
+                best = trial;
+            }
+        }
+    }
+
+    // matmul_tiled block size (it is much slower, so tune it on a smaller problem)
+    int tn = std::min(n, 512);
+    double best_tile_time = 1e9;
+    for (int tile : {16, 24, 32, 48, 64, 96, 128}) {
+        BlockingParams trial = best;
+        trial.tile_block = tile;
+        set_blocking_params(trial);
+        double t = time_kernel(matmul_tiled, A, B, C, tn, 1);
+        if (verbose) {
+            std::cout << "autotune: tile=" << tile << " " << 2.0 * tn * tn * tn / (t * 1e9) << " GFLOPS" << std::endl;
+        }
+        if (t < best_tile_time) {
+            best_tile_time = t;
+            best.tile_block = tile;
+        }
+    }
+
+    // Strassen leaves run the packed SGEMM, so measure the cutoff with the winner
+    set_blocking_params(best);
+    best.strassen_cutoff = calibrate_strassen_cutoff(verbose);
+
+    set_blocking_params(saved);
+    return best;
+}
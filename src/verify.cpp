@@ -0,0 +1,134 @@
+#include "../include/verify.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <omp.h>
+
+// Reference: i-k-j loop nest blocked over rows (one block per task) and K (so
+// the B rows of one K block stay in cache), accumulating in double.
+void reference_matmul(const Matrix& A, const Matrix& B, int m, int n, int p,
+                      std::vector<double>& C_ref, std::vector<double>& abs_ref) {
+    const int ROW_BLOCK = 16;
+    const int K_BLOCK = 256;
+    C_ref.assign((size_t)m * p, 0.0);
+    abs_ref.assign((size_t)m * p, 0.0);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int i0 = 0; i0 < m; i0 += ROW_BLOCK) {
+        int i1 = std::min(m, i0 + ROW_BLOCK);
+        for (int k0 = 0; k0 < n; k0 += K_BLOCK) {
+            int k1 = std::min(n, k0 + K_BLOCK);
+            for (int i = i0; i < i1; ++i) {
+                double* c_row = &C_ref[(size_t)i * p];
+                double* abs_row = &abs_ref[(size_t)i * p];
+                for (int k = k0; k < k1; ++k) {
+                    double a = A[(size_t)i * n + k];
+                    double a_abs = std::fabs(a);
+                    const float* b_row = &B[(size_t)k * p];
+                    for (int j = 0; j < p; ++j) {
+                        double b = b_row[j];
+                        c_row[j] += a * b;
+                        abs_row[j] += a_abs * std::fabs(b);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Float ulp of a value (spacing of floats around it)
+static double float_ulp(double value) {
+    float f = std::fabs((float)value);
+    if (f == 0.0f) return std::numeric_limits<float>::denorm_min();
+    return (double)std::nextafter(f, std::numeric_limits<float>::infinity()) - f;
+}
+
+VerifyReport verify_against_reference(const std::vector<double>& C_ref, const std::vector<double>& abs_ref,
+                                      const Matrix& C, int m, int n, int p, double tol_factor) {
+    const double gamma = tol_factor * std::max(n, 1) * FLOAT_UNIT_ROUNDOFF;
+    double max_abs = 0.0, max_rel = 0.0, max_ulp = 0.0, worst = 0.0;
+
+    #pragma omp parallel for reduction(max : max_abs, max_rel, max_ulp, worst)
+    for (long long idx = 0; idx < (long long)m * p; ++idx) {
+        double err = std::fabs((double)C[idx] - C_ref[idx]);
+        if (std::isnan(err)) err = INFINITY;
+        // Rounding of the result itself to float adds half an ulp
+        double allowed = gamma * abs_ref[idx] + 0.5 * float_ulp(C_ref[idx]);
+        max_abs = std::max(max_abs, err);
+        if (abs_ref[idx] > 0) max_rel = std::max(max_rel, err / abs_ref[idx]);
+        max_ulp = std::max(max_ulp, err / float_ulp(abs_ref[idx]));
+        worst = std::max(worst, err / allowed);
+    }
+
+    VerifyReport report;
+    report.pass = (worst <= 1.0);
+    report.max_abs_error = max_abs;
+    report.max_rel_error = max_rel;
+    report.max_ulp_error = max_ulp;
+    report.worst_ratio = worst;
+    return report;
+}
+
+VerifyReport verify_freivalds(const Matrix& A, const Matrix& B, const Matrix& C, int m, int n, int p,
+                              int trials, double tol_factor) {
+    static std::mt19937 gen(1234);
+    std::bernoulli_distribution coin(0.5);
+    const double gamma = tol_factor * std::sqrt((double)std::max(n, 1)) * FLOAT_UNIT_ROUNDOFF;
+
+    std::vector<double> r(p), Br(n), absBr(n);
+    double max_abs = 0.0, max_rel = 0.0, worst = 0.0;
+
+    for (int t = 0; t < trials; ++t) {
+        for (int j = 0; j < p; ++j) r[j] = coin(gen) ? 1.0 : -1.0;
+
+        // B r and |B| |r| (|r| = 1)
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const float* b_row = &B[(size_t)k * p];
+            double sum = 0.0, abs_sum = 0.0;
+            for (int j = 0; j < p; ++j) {
+                sum += b_row[j] * r[j];
+                abs_sum += std::fabs(b_row[j]);
+            }
+            Br[k] = sum;
+            absBr[k] = abs_sum;
+        }
+
+        // Row i: A (B r) vs C r. With random signs the element errors E_ij add
+        // up like a random walk, so (C r - A B r)_i ~ sqrt(sum_j E_ij^2), about
+        // sqrt(p) times one element error. The allowed difference uses the
+        // typical sqrt(K) u element error (the worst-case K u bound summed over a
+        // row would hide even a completely wrong element): 4 standard deviations
+        // of tol_factor * sqrt(K) * u * (|A| |B|)_ij, with (|A||B|)_ij estimated
+        // as the row mean.
+        #pragma omp parallel for schedule(static) reduction(max : max_abs, max_rel, worst)
+        for (int i = 0; i < m; ++i) {
+            const float* a_row = &A[(size_t)i * n];
+            const float* c_row = &C[(size_t)i * p];
+            double abr = 0.0, scale = 0.0, cr = 0.0, c_abs = 0.0;
+            for (int k = 0; k < n; ++k) {
+                abr += a_row[k] * Br[k];
+                scale += std::fabs(a_row[k]) * absBr[k];
+            }
+            for (int j = 0; j < p; ++j) {
+                cr += c_row[j] * r[j];
+                c_abs += std::fabs(c_row[j]);
+            }
+            double err = std::fabs(abr - cr);
+            if (std::isnan(err)) err = INFINITY;
+            double allowed = 4.0 * (gamma * scale + FLOAT_UNIT_ROUNDOFF * c_abs) / std::sqrt((double)p) + 1e-30;
+            max_abs = std::max(max_abs, err);
+            if (scale > 0) max_rel = std::max(max_rel, err / scale);
+            worst = std::max(worst, err / allowed);
+        }
+    }
+
+    VerifyReport report;
+    report.pass = (worst <= 1.0);
+    report.max_abs_error = max_abs;
+    report.max_rel_error = max_rel;
+    report.max_ulp_error = -1.0;
+    report.worst_ratio = worst;
+    return report;
+}